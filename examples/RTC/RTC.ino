@@ -0,0 +1,72 @@
+/*
+ * A DS3231 real-time clock chip as a time source. At boot the time comes from the RTC
+ * straight away, network or not, and every time NTP answers the RTC is set right again.
+ * (The DS3231 only tells whole seconds, so it is only good to half a second: NTP is better
+ * when it's there.)
+ */
+
+#include <ezTime.h>
+#include <WiFi.h>
+#include <Wire.h>
+
+#define DS3231_ADDRESS	0x68
+
+class DS3231Source : public ezTimeSource {
+	public:
+		bool getTime(time_t &t, unsigned long &measured_at) {
+			Wire.beginTransmission(DS3231_ADDRESS);
+			Wire.write(0);
+			if (Wire.endTransmission() != 0 || Wire.requestFrom(DS3231_ADDRESS, 7) != 7) return false;
+			uint8_t r[7];
+			for (int n = 0; n < 7; n++) r[n] = Wire.read();
+			measured_at = millis() - 500;			// somewhere in this second
+			if (bcd(r[6]) < 20) return false;		// starts at 2000 after it lost power
+			t = makeTime(bcd(r[2] & 0x3F), bcd(r[1]), bcd(r[0]), bcd(r[4]), bcd(r[5] & 0x1F), 2000 + bcd(r[6]));
+			return true;
+		}
+
+		uint16_t precision() { return 500; }
+
+		bool setTime(const time_t t, const unsigned long measured_at) {
+			// Writing the seconds restarts the chip's second, so wait for a whole one
+			delay(1000 - (millis() - measured_at) % 1000);
+			tmElements_t tm;
+			breakTime(t + (millis() - measured_at + 500) / 1000, tm);
+			Wire.beginTransmission(DS3231_ADDRESS);
+			Wire.write(0);
+			Wire.write(dec(tm.Second));
+			Wire.write(dec(tm.Minute));
+			Wire.write(dec(tm.Hour));
+			Wire.write(tm.Wday);
+			Wire.write(dec(tm.Day));
+			Wire.write(dec(tm.Month));
+			Wire.write(dec(tm.Year - 30));
+			return Wire.endTransmission() == 0;
+		}
+
+	private:
+		uint8_t bcd(const uint8_t b) { return (b >> 4) * 10 + (b & 0x0F); }
+		uint8_t dec(const uint8_t d) { return (d / 10) << 4 | d % 10; }
+};
+
+DS3231Source rtc;
+
+void setup() {
+
+	Serial.begin(115200);
+	while (!Serial) { ; }		// wait for Serial port to connect. Needed for native USB port only
+	Wire.begin();
+	addTimeSource(rtc);
+	WiFi.begin("your-ssid", "your-password");
+
+	events();					// the time comes from the RTC if the network isn't up yet
+
+	Serial.println();
+	Serial.println("UTC: " + UTC.dateTime());
+	setDebug(INFO);
+
+}
+
+void loop() {
+	events();
+}
@@ -0,0 +1,181 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "HostShim.h"
+
+#include <malloc.h>
+#include <new>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+	bool _simulated_clock = false;
+	uint32_t _simulated_millis = 0;
+	uint64_t _real_start_us = 0;
+	uint64_t _skipped_us = 0;
+
+	uint64_t monotonicMicros() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		uint64_t us = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+		if (!_real_start_us) _real_start_us = us;
+		return us - _real_start_us + _skipped_us;
+	}
+
+	unsigned long _random_state = 1;
+	unsigned long _eeprom_cell_writes[HOST_EEPROM_SIZE];
+
+}
+
+namespace host {
+
+	unsigned long allocations = 0;
+	size_t heap_bytes = 0;
+	unsigned long eeprom_reads = 0;
+	unsigned long eeprom_writes = 0;
+	bool network_connected = true;
+
+	void setMillis(const uint32_t ms) {
+		_simulated_clock = true;
+		_simulated_millis = ms;
+	}
+
+	void advanceMillis(const uint32_t ms) { _simulated_millis += ms; }
+
+	unsigned long eepromCellWrites(const int address) {
+		if (address < 0 || address >= HOST_EEPROM_SIZE) return 0;
+		return _eeprom_cell_writes[address];
+	}
+
+	void useRealMillis() { _simulated_clock = false; }
+
+	void skipMillis(const uint32_t ms) { _skipped_us += ms * 1000ULL; }
+
+	void setNetwork(const bool connected) { network_connected = connected; }
+}
+
+uint32_t millis() {
+	if (_simulated_clock) return _simulated_millis;
+	return monotonicMicros() / 1000;
+}
+
+uint32_t micros() {
+	if (_simulated_clock) return _simulated_millis * 1000UL;
+	return monotonicMicros();
+}
+
+void delay(const uint32_t ms) {
+	if (_simulated_clock) {
+		_simulated_millis += ms;
+		return;
+	}
+	usleep(ms * 1000UL);
+}
+
+void yield() {}
+
+// Same xorshift on every host, so simulations are reproducible from randomSeed()
+long random(long howbig) {
+	if (howbig <= 0) return 0;
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return (_random_state & 0x7FFFFFFF) % howbig;
+}
+
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig) return howsmall;
+	return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) { if (seed) _random_state = seed; }
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+	fputc(c, stdout);
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() { memset(_data, 0xFF, sizeof(_data)); }
+
+uint8_t EEPROMClass::read(const int address) {
+	host::eeprom_reads++;
+	if (address < 0 || address >= HOST_EEPROM_SIZE) return 0;
+	return _data[address];
+}
+
+void EEPROMClass::write(const int address, const uint8_t value) {
+	host::eeprom_writes++;
+	if (address < 0 || address >= HOST_EEPROM_SIZE) return;
+	_eeprom_cell_writes[address]++;
+	_data[address] = value;
+}
+
+void EEPROMClass::update(const int address, const uint8_t value) {
+	if (read(address) != value) write(address, value);
+}
+
+// Count every allocation in the process so the benchmarks can report allocations/op and the
+// heap in use: Strings, operator new and ezTime's own malloc() and calloc() all end up here.
+// glibc's own functions do the work.
+extern "C" {
+
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *p, size_t size);
+	void __libc_free(void *p);
+
+	void *malloc(size_t size) {
+		void *p = __libc_malloc(size);
+		if (p) {
+			host::allocations++;
+			host::heap_bytes += malloc_usable_size(p);
+		}
+		return p;
+	}
+
+	void *calloc(size_t count, size_t size) {
+		void *p = __libc_calloc(count, size);
+		if (p) {
+			host::allocations++;
+			host::heap_bytes += malloc_usable_size(p);
+		}
+		return p;
+	}
+
+	void *realloc(void *p, size_t size) {
+		size_t old_size = p ? malloc_usable_size(p) : 0;
+		void *q = __libc_realloc(p, size);
+		if (q) {
+			host::allocations++;
+			host::heap_bytes += malloc_usable_size(q) - old_size;
+		} else if (!size) {
+			host::heap_bytes -= old_size;
+		}
+		return q;
+	}
+
+	void free(void *p) {
+		if (p) host::heap_bytes -= malloc_usable_size(p);
+		__libc_free(p);
+	}
+
+}
+
+void * operator new(size_t size) {
+	void *p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void * operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
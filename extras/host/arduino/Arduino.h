@@ -0,0 +1,53 @@
+/*
+ * Host (Linux) stand-in for the Arduino core. Only what ezTime and its host tools use
+ * is provided. See extras/host/README.md
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>		// before ezTime.h, so it sees __time_t_defined
+
+#include "WString.h"
+#include "Print.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)	(*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)		(*(const void * const *)(addr))
+
+uint32_t millis();
+uint32_t micros();
+void delay(const uint32_t ms);
+void yield();
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+
+class HardwareSerial : public Print {
+	public:
+		void begin(unsigned long baud) { (void)baud; }
+		operator bool() { return true; }
+		size_t write(uint8_t c);
+		size_t write(const uint8_t *buffer, size_t size);
+		using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // _HOST_ARDUINO_H_
@@ -0,0 +1,27 @@
+#ifndef _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_EEPROM_SIZE	4096
+
+// Behaves like the AVR EEPROM library: fixed size, no begin()/commit() needed. Erased
+// cells read 0xFF. Every access is counted in host::eeprom_reads / host::eeprom_writes.
+class EEPROMClass {
+	public:
+		EEPROMClass();
+		uint8_t read(const int address);
+		void write(const int address, const uint8_t value);
+		void update(const int address, const uint8_t value);
+		uint16_t length() { return HOST_EEPROM_SIZE; }
+		void begin(const size_t size) { (void)size; }
+		bool commit() { return true; }
+		void end() {}
+	private:
+		uint8_t _data[HOST_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // _HOST_EEPROM_H_
@@ -0,0 +1,32 @@
+/*
+ * The host's own clock as an ezTime time source, so host builds do not have to wait for NTP:
+ *
+ *   host::ClockSource host_clock;
+ *   addTimeSource(host_clock);
+ *
+ * It is as good as whatever keeps the host's clock right, which is taken to be a millisecond.
+ */
+
+#ifndef _HOST_CLOCK_H_
+#define _HOST_CLOCK_H_
+
+#include <Arduino.h>
+#include <ezTime.h>
+#include <time.h>
+
+namespace host {
+
+	class ClockSource : public ezTimeSource {
+		public:
+			bool getTime(time_t &t, unsigned long &measured_at) {
+				struct timespec now;
+				if (clock_gettime(CLOCK_REALTIME, &now)) return false;
+				t = now.tv_sec;
+				measured_at = millis() - now.tv_nsec / 1000000;
+				return true;
+			}
+			uint16_t precision() { return 1; }
+	};
+}
+
+#endif // _HOST_CLOCK_H_
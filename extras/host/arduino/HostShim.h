@@ -0,0 +1,40 @@
+/*
+ * Controls that only exist in the host build of the Arduino shim: a settable clock and
+ * in-process UDP servers for tests and simulations, and counters that the benchmark suite
+ * reports per operation.
+ */
+
+#ifndef _HOST_SHIM_H_
+#define _HOST_SHIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace host {
+
+	extern unsigned long allocations;		// heap allocations, by anything in the process
+	extern size_t heap_bytes;				// heap in use right now, as malloc() rounds it up
+	extern unsigned long eeprom_reads;
+	extern unsigned long eeprom_writes;
+	extern unsigned long dns_lookups;		// WiFi.hostByName() calls
+	unsigned long eepromCellWrites(const int address);	// writes to one EEPROM byte, for wear
+
+	void setMillis(const uint32_t ms);		// switches millis() to a simulated clock
+	void advanceMillis(const uint32_t ms);
+	void useRealMillis();					// back to the monotonic system clock (default)
+	void skipMillis(const uint32_t ms);		// moves that clock forward, for waits a test does not need to sit out
+	void setNetwork(const bool connected);	// what WiFi.status() reports, default connected
+
+	// Packets sent to 'port' on any host go to 'responder' instead of the network, without
+	// looking up the name. It gets the address sent to (network byte order, 0 if sent to a
+	// name), puts the answer in 'reply' and returns its length, which parsePacket() then has
+	// waiting; 0 means no answer. NULL removes it.
+	typedef size_t (*udpResponder_t)(const uint32_t to, const uint8_t *packet, const size_t len, uint8_t *reply, const size_t max_len);
+	void setUdpResponder(const uint16_t port, udpResponder_t responder);
+
+	// Adds an address ("10.0.0.1") for 'name' that WiFi.hostByName() gives without asking real
+	// DNS. A name with several gives the next one every time, like a pool's round-robin DNS.
+	void addHost(const char *name, const char *address);
+}
+
+#endif // _HOST_SHIM_H_
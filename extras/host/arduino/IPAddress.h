@@ -0,0 +1,26 @@
+#ifndef _HOST_IPADDRESS_H_
+#define _HOST_IPADDRESS_H_
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+	public:
+		IPAddress() : _address(0) {}
+		IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _bytes[0] = a; _bytes[1] = b; _bytes[2] = c; _bytes[3] = d; }
+		IPAddress(uint32_t address) : _address(address) {}	// network byte order, like the Arduino core
+		operator uint32_t() const { return _address; }
+		uint8_t operator [] (int index) const { return _bytes[index]; }
+		uint8_t & operator [] (int index) { return _bytes[index]; }
+		bool operator == (const IPAddress &rhs) const { return _address == rhs._address; }
+		bool operator != (const IPAddress &rhs) const { return _address != rhs._address; }
+		String toString() const;
+	private:
+		union {
+			uint8_t _bytes[4];
+			uint32_t _address;
+		};
+};
+
+#endif // _HOST_IPADDRESS_H_
@@ -0,0 +1,40 @@
+#include "Print.h"
+
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+	size_t n = 0;
+	while (size--) n += write(*buffer++);
+	return n;
+}
+
+size_t Print::write(const char *str) {
+	if (!str) return 0;
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::printSigned(long long n, int base) {
+	if (base == DEC && n < 0) return printNumber(0ULL - n, true, base);
+	return printNumber(n, false, base);
+}
+
+size_t Print::printNumber(unsigned long long n, bool negative, int base) {
+	char buf[2 + 8 * sizeof(unsigned long long)];
+	char *p = buf + sizeof(buf) - 1;
+	*p = 0;
+	if (base < 2) base = DEC;
+	do {
+		uint8_t digit = n % base;
+		*--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+		n /= base;
+	} while (n);
+	if (negative) *--p = '-';
+	return write(p);
+}
+
+size_t Print::print(double n, int digits /* = 2 */) {
+	char buf[40];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return write(buf);
+}
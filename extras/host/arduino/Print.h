@@ -0,0 +1,44 @@
+#ifndef _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size);
+		size_t write(const char *str);
+
+		size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+		size_t print(const String &str) { return write((const uint8_t *)str.c_str(), str.length()); }
+		size_t print(const char *str) { return write(str); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(unsigned char n, int base = DEC) { return printNumber(n, false, base); }
+		size_t print(int n, int base = DEC) { return printSigned(n, base); }
+		size_t print(unsigned int n, int base = DEC) { return printNumber(n, false, base); }
+		size_t print(long n, int base = DEC) { return printSigned(n, base); }
+		size_t print(unsigned long n, int base = DEC) { return printNumber(n, false, base); }
+		size_t print(long long n, int base = DEC) { return printSigned(n, base); }
+		size_t print(unsigned long long n, int base = DEC) { return printNumber(n, false, base); }
+		size_t print(double n, int digits = 2);
+
+		size_t println() { return write("\r\n"); }
+		template <typename T> size_t println(const T &value) { size_t n = print(value); return n + println(); }
+		template <typename T> size_t println(const T &value, int base) { size_t n = print(value, base); return n + println(); }
+
+	private:
+		size_t printSigned(long long n, int base);
+		size_t printNumber(unsigned long long n, bool negative, int base);
+};
+
+#endif // _HOST_PRINT_H_
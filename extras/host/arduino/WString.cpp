@@ -0,0 +1,202 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+String::String(const char *cstr /* = "" */) {
+	invalidate();
+	if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const String &str) {
+	invalidate();
+	*this = str;
+}
+
+String::String(String &&rval) {
+	invalidate();
+	move(rval);
+}
+
+String::String(const __FlashStringHelper *str) {
+	invalidate();
+	*this = str;
+}
+
+String::String(char c) {
+	invalidate();
+	copy(&c, 1);
+}
+
+String::String(unsigned char value, unsigned char base /* = 10 */) { invalidate(); setNumber(value, false, base); }
+String::String(unsigned int value, unsigned char base /* = 10 */) { invalidate(); setNumber(value, false, base); }
+String::String(unsigned long value, unsigned char base /* = 10 */) { invalidate(); setNumber(value, false, base); }
+String::String(unsigned long long value, unsigned char base /* = 10 */) { invalidate(); setNumber(value, false, base); }
+String::String(int value, unsigned char base /* = 10 */) { invalidate(); setNumber(value < 0 ? 0ULL - value : value, value < 0, base); }
+String::String(long value, unsigned char base /* = 10 */) { invalidate(); setNumber(value < 0 ? 0ULL - value : value, value < 0, base); }
+String::String(long long value, unsigned char base /* = 10 */) { invalidate(); setNumber(value < 0 ? 0ULL - value : value, value < 0, base); }
+
+String::~String() { free(_buffer); }
+
+void String::invalidate() {
+	_buffer = NULL;
+	_capacity = 0;
+	_len = 0;
+}
+
+bool String::changeBuffer(unsigned int size) {
+	char *newbuffer = (char *)realloc(_buffer, size + 1);
+	if (!newbuffer) return false;
+	_buffer = newbuffer;
+	_capacity = size;
+	return true;
+}
+
+bool String::reserve(unsigned int size) {
+	if (_buffer && _capacity >= size) return true;
+	if (!changeBuffer(size)) return false;
+	if (_len == 0) _buffer[0] = 0;
+	return true;
+}
+
+void String::copy(const char *cstr, unsigned int length) {
+	if (!reserve(length)) {
+		free(_buffer);
+		invalidate();
+		return;
+	}
+	_len = length;
+	memmove(_buffer, cstr, length);
+	_buffer[_len] = 0;
+}
+
+void String::move(String &rhs) {
+	free(_buffer);
+	_buffer = rhs._buffer;
+	_capacity = rhs._capacity;
+	_len = rhs._len;
+	rhs.invalidate();
+}
+
+void String::setNumber(unsigned long long value, bool negative, unsigned char base) {
+	char buf[2 + 8 * sizeof(unsigned long long)];
+	char *p = buf + sizeof(buf) - 1;
+	*p = 0;
+	if (base < 2) base = 10;
+	do {
+		uint8_t digit = value % base;
+		*--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+		value /= base;
+	} while (value);
+	if (negative) *--p = '-';
+	copy(p, strlen(p));
+}
+
+String & String::operator = (const String &rhs) {
+	if (this == &rhs) return *this;
+	if (rhs._buffer) {
+		copy(rhs._buffer, rhs._len);
+	} else {
+		free(_buffer);
+		invalidate();
+	}
+	return *this;
+}
+
+String & String::operator = (String &&rval) {
+	if (this != &rval) move(rval);
+	return *this;
+}
+
+String & String::operator = (const char *cstr) {
+	if (cstr) {
+		copy(cstr, strlen(cstr));
+	} else {
+		free(_buffer);
+		invalidate();
+	}
+	return *this;
+}
+
+String & String::operator = (const __FlashStringHelper *str) { return *this = (const char *)str; }
+
+bool String::concat(const char *cstr, unsigned int length) {
+	if (!cstr) return false;
+	if (length == 0) return true;
+	unsigned int newlen = _len + length;
+	if (!reserve(newlen)) return false;
+	memmove(_buffer + _len, cstr, length);
+	_len = newlen;
+	_buffer[_len] = 0;
+	return true;
+}
+
+bool String::concat(const char *cstr) {
+	if (!cstr) return false;
+	return concat(cstr, strlen(cstr));
+}
+
+bool String::equals(const char *cstr) const {
+	if (!cstr) cstr = "";
+	return strcmp(c_str(), cstr) == 0;
+}
+
+char & String::operator [] (unsigned int index) {
+	static char dummy_writable_char;
+	if (index >= _len || !_buffer) {
+		dummy_writable_char = 0;
+		return dummy_writable_char;
+	}
+	return _buffer[index];
+}
+
+int String::indexOf(char ch, unsigned int from /* = 0 */) const {
+	if (from >= _len) return -1;
+	const char *found = (const char *)memchr(_buffer + from, ch, _len - from);
+	return found ? found - _buffer : -1;
+}
+
+int String::indexOf(const char *cstr, unsigned int from /* = 0 */) const {
+	if (from >= _len || !cstr) return -1;
+	const char *found = strstr(_buffer + from, cstr);
+	return found ? found - _buffer : -1;
+}
+
+int String::indexOf(const String &str, unsigned int from /* = 0 */) const { return indexOf(str.c_str(), from); }
+
+String String::substring(unsigned int from, unsigned int to) const {
+	if (from > to) {
+		unsigned int tmp = from;
+		from = to;
+		to = tmp;
+	}
+	String out;
+	if (from >= _len) return out;
+	if (to > _len) to = _len;
+	out.copy(_buffer + from, to - from);
+	return out;
+}
+
+void String::toUpperCase() { for (unsigned int n = 0; n < _len; n++) _buffer[n] = toupper((unsigned char)_buffer[n]); }
+
+void String::toLowerCase() { for (unsigned int n = 0; n < _len; n++) _buffer[n] = tolower((unsigned char)_buffer[n]); }
+
+void String::trim() {
+	if (!_buffer || _len == 0) return;
+	char *begin = _buffer;
+	while (isspace((unsigned char)*begin)) begin++;
+	char *end = _buffer + _len - 1;
+	while (end >= begin && isspace((unsigned char)*end)) end--;
+	_len = end + 1 - begin;
+	if (begin > _buffer) memmove(_buffer, begin, _len);
+	_buffer[_len] = 0;
+}
+
+long String::toInt() const { return _buffer ? atol(_buffer) : 0; }
+
+String operator + (const String &lhs, const String &rhs) { String out(lhs); out += rhs; return out; }
+String operator + (const String &lhs, const char *rhs) { String out(lhs); out += rhs; return out; }
+String operator + (const char *lhs, const String &rhs) { String out(lhs); out += rhs; return out; }
+String operator + (const String &lhs, char rhs) { String out(lhs); out += rhs; return out; }
+String operator + (const String &lhs, const __FlashStringHelper *rhs) { String out(lhs); out += rhs; return out; }
@@ -0,0 +1,91 @@
+/*
+ * Minimal stand-in for the Arduino core String class, just enough to compile and run
+ * ezTime on a Linux host. Buffers are managed with malloc/realloc like the real thing,
+ * so the number of heap allocations per operation is comparable to what a device does.
+ */
+
+#ifndef _HOST_WSTRING_H_
+#define _HOST_WSTRING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String {
+
+	public:
+		String(const char *cstr = "");
+		String(const String &str);
+		String(String &&rval);
+		String(const __FlashStringHelper *str);
+		explicit String(char c);
+		explicit String(unsigned char value, unsigned char base = 10);
+		explicit String(int value, unsigned char base = 10);
+		explicit String(unsigned int value, unsigned char base = 10);
+		explicit String(long value, unsigned char base = 10);
+		explicit String(unsigned long value, unsigned char base = 10);
+		explicit String(long long value, unsigned char base = 10);
+		explicit String(unsigned long long value, unsigned char base = 10);
+		~String();
+
+		String & operator = (const String &rhs);
+		String & operator = (String &&rval);
+		String & operator = (const char *cstr);
+		String & operator = (const __FlashStringHelper *str);
+
+		bool reserve(unsigned int size);
+		unsigned int length() const { return _len; }
+		const char *c_str() const { return _buffer ? _buffer : ""; }
+
+		bool concat(const char *cstr, unsigned int length);
+		bool concat(const String &str) { return concat(str.c_str(), str._len); }
+		bool concat(const char *cstr);
+		bool concat(char c) { return concat(&c, 1); }
+		String & operator += (const String &rhs) { concat(rhs); return *this; }
+		String & operator += (const char *cstr) { concat(cstr); return *this; }
+		String & operator += (const __FlashStringHelper *str) { concat((const char *)str); return *this; }
+		String & operator += (char c) { concat(c); return *this; }
+
+		bool equals(const char *cstr) const;
+		bool equals(const String &str) const { return equals(str.c_str()); }
+		bool operator == (const String &rhs) const { return equals(rhs); }
+		bool operator == (const char *cstr) const { return equals(cstr); }
+		bool operator != (const String &rhs) const { return !equals(rhs); }
+		bool operator != (const char *cstr) const { return !equals(cstr); }
+
+		char charAt(unsigned int index) const { return index < _len ? _buffer[index] : 0; }
+		void setCharAt(unsigned int index, char c) { if (index < _len) _buffer[index] = c; }
+		char operator [] (unsigned int index) const { return charAt(index); }
+		char & operator [] (unsigned int index);
+
+		int indexOf(char ch, unsigned int from = 0) const;
+		int indexOf(const String &str, unsigned int from = 0) const;
+		int indexOf(const char *cstr, unsigned int from = 0) const;
+		String substring(unsigned int from) const { return substring(from, _len); }
+		String substring(unsigned int from, unsigned int to) const;
+
+		void toUpperCase();
+		void toLowerCase();
+		void trim();
+		long toInt() const;
+
+	private:
+		char *_buffer;
+		unsigned int _capacity;
+		unsigned int _len;
+		void invalidate();
+		bool changeBuffer(unsigned int size);
+		void copy(const char *cstr, unsigned int length);
+		void move(String &rhs);
+		void setNumber(unsigned long long value, bool negative, unsigned char base);
+};
+
+String operator + (const String &lhs, const String &rhs);
+String operator + (const String &lhs, const char *rhs);
+String operator + (const char *lhs, const String &rhs);
+String operator + (const String &lhs, char rhs);
+String operator + (const String &lhs, const __FlashStringHelper *rhs);
+
+#endif // _HOST_WSTRING_H_
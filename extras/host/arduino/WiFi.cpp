@@ -0,0 +1,184 @@
+#include "HostShim.h"
+#include "WiFi.h"
+#include "WiFiUdp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace host {
+	extern bool network_connected;
+
+	unsigned long dns_lookups = 0;
+
+	std::map<uint16_t, udpResponder_t> udp_responders;
+	std::map<std::string, std::vector<uint32_t> > hosts;
+	std::map<std::string, size_t> host_turns;
+
+	void setUdpResponder(const uint16_t port, udpResponder_t responder) {
+		if (responder) {
+			udp_responders[port] = responder;
+		} else {
+			udp_responders.erase(port);
+		}
+	}
+
+	udpResponder_t udpResponder(const uint16_t port) {
+		auto it = udp_responders.find(port);
+		return it == udp_responders.end() ? NULL : it->second;
+	}
+
+	void addHost(const char *name, const char *address) {
+		struct in_addr addr;
+		if (inet_pton(AF_INET, address, &addr) == 1) hosts[name].push_back(addr.s_addr);
+	}
+}
+
+String IPAddress::toString() const {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+	return String(buf);
+}
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::status() { return host::network_connected ? WL_CONNECTED : WL_DISCONNECTED; }
+
+int WiFiClass::hostByName(const char *host, IPAddress &result) {
+	host::dns_lookups++;
+	auto fake = host::hosts.find(host);
+	if (fake != host::hosts.end()) {
+		result = IPAddress(fake->second[host::host_turns[host]++ % fake->second.size()]);
+		return 1;
+	}
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) return 0;
+	result = IPAddress((uint32_t)((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr);
+	freeaddrinfo(res);
+	return 1;
+}
+
+WiFiUDP::WiFiUDP() {
+	_fd = -1;
+	_dest_port = _remote_port = 0;
+	_tx_len = _rx_len = _rx_pos = _responded = 0;
+}
+
+WiFiUDP::~WiFiUDP() { stop(); }
+
+bool WiFiUDP::open(uint16_t port) {
+	_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (_fd < 0) return false;
+	int one = 1;
+	setsockopt(_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		addr.sin_port = 0;
+		if (errno != EADDRINUSE || bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			stop();
+			return false;
+		}
+	}
+	fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+	return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+	stop();
+	return open(port) ? 1 : 0;
+}
+
+void WiFiUDP::stop() {
+	if (_fd >= 0) close(_fd);
+	_fd = -1;
+	_rx_len = _rx_pos = _responded = 0;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port) {
+	IPAddress ip;
+	if (!host::udpResponder(port) && !WiFi.hostByName(host, ip)) return 0;
+	return beginPacket(ip, port);
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+	if (_fd < 0 && !open(0)) return 0;
+	_dest_ip = ip;
+	_dest_port = port;
+	_tx_len = 0;
+	return 1;
+}
+
+size_t WiFiUDP::write(uint8_t c) { return write(&c, 1); }
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+	if (size > sizeof(_tx) - _tx_len) size = sizeof(_tx) - _tx_len;
+	memcpy(_tx + _tx_len, buffer, size);
+	_tx_len += size;
+	return size;
+}
+
+int WiFiUDP::endPacket() {
+	if (_fd < 0) return 0;
+	host::udpResponder_t responder = host::udpResponder(_dest_port);
+	if (responder) {
+		_responded = responder((uint32_t)_dest_ip, _tx, _tx_len, _rx, sizeof(_rx));
+		_remote_ip = _dest_ip;
+		_remote_port = _dest_port;
+		_tx_len = 0;
+		return 1;
+	}
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = (uint32_t)_dest_ip;
+	addr.sin_port = htons(_dest_port);
+	ssize_t sent = sendto(_fd, _tx, _tx_len, 0, (struct sockaddr *)&addr, sizeof(addr));
+	_tx_len = 0;
+	return sent >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+	if (_fd < 0) return 0;
+	if (_responded) {
+		_rx_len = _responded;
+		_rx_pos = 0;
+		_responded = 0;
+		return _rx_len;
+	}
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	ssize_t len = recvfrom(_fd, _rx, sizeof(_rx), 0, (struct sockaddr *)&addr, &addrlen);
+	if (len <= 0) return 0;
+	_remote_ip = IPAddress((uint32_t)addr.sin_addr.s_addr);
+	_remote_port = ntohs(addr.sin_port);
+	_rx_len = len;
+	_rx_pos = 0;
+	return len;
+}
+
+int WiFiUDP::read() {
+	if (_rx_pos >= _rx_len) return -1;
+	return _rx[_rx_pos++];
+}
+
+int WiFiUDP::read(unsigned char *buffer, size_t len) {
+	if (len > (size_t)available()) len = available();
+	memcpy(buffer, _rx + _rx_pos, len);
+	_rx_pos += len;
+	return len;
+}
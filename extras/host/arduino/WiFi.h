@@ -0,0 +1,22 @@
+#ifndef _HOST_WIFI_H_
+#define _HOST_WIFI_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+	WL_IDLE_STATUS = 0,
+	WL_CONNECTED = 3,
+	WL_DISCONNECTED = 6
+} wl_status_t;
+
+// The host "interface" is always up unless host::setNetwork(false) was called.
+class WiFiClass {
+	public:
+		wl_status_t status();
+		int hostByName(const char *host, IPAddress &result);
+};
+
+extern WiFiClass WiFi;
+
+#endif // _HOST_WIFI_H_
@@ -0,0 +1,43 @@
+#ifndef _HOST_WIFIUDP_H_
+#define _HOST_WIFIUDP_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#define HOST_UDP_MAX_PACKET		1472
+
+// WiFiUDP on top of a non-blocking BSD socket. If begin() asks for a port that is taken
+// (e.g. a local timezoned stand-in already sits on 2342) an ephemeral port is used,
+// which is what a device behind NAT looks like to a server anyway. Ports that have a
+// host::setUdpResponder() are answered in-process.
+class WiFiUDP : public Print {
+	public:
+		WiFiUDP();
+		~WiFiUDP();
+		uint8_t begin(uint16_t port);
+		void stop();
+		void flush() {}
+		int beginPacket(const char *host, uint16_t port);
+		int beginPacket(IPAddress ip, uint16_t port);
+		int endPacket();
+		size_t write(uint8_t c);
+		size_t write(const uint8_t *buffer, size_t size);
+		using Print::write;
+		int parsePacket();
+		int available() { return _rx_len - _rx_pos; }
+		int read();
+		int read(unsigned char *buffer, size_t len);
+		int read(char *buffer, size_t len) { return read((unsigned char *)buffer, len); }
+		IPAddress remoteIP() { return _remote_ip; }
+		uint16_t remotePort() { return _remote_port; }
+	private:
+		int _fd;
+		IPAddress _dest_ip, _remote_ip;
+		uint16_t _dest_port, _remote_port;
+		uint8_t _tx[HOST_UDP_MAX_PACKET], _rx[HOST_UDP_MAX_PACKET];
+		uint16_t _tx_len, _rx_len, _rx_pos;
+		uint16_t _responded;		// length of an answer from a host::setUdpResponder() responder
+		bool open(uint16_t port);
+};
+
+#endif // _HOST_WIFIUDP_H_
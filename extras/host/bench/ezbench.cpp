@@ -0,0 +1,361 @@
+/*
+ * ezbench - micro-benchmarks for the ezTime hot paths, run on a Linux host.
+ *
+ *   ezbench [--quick] [filter]
+ *
+ * Every benchmark is run for roughly a quarter second (or a handful of iterations with
+ * --quick) and reported as nanoseconds and heap allocations per operation. Only names
+ * containing 'filter' are run if given. What Timezones take up, in the object and on the
+ * heap, is reported first: build it as ezbench_fixed to see that with EZTIME_FIXED_STRINGS.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+	typedef void (*benchFunction_t)(const uint32_t i);
+
+	struct benchmark_t {
+		const char *name;
+		benchFunction_t function;
+	};
+
+	Timezone berlin;
+	Timezone sydney;
+	Timezone history;							// Berlin with its TZif transitions, if the host has them
+	const time_t base_time = 1530000000;		// June 2018, DST in Berlin
+	volatile uint32_t sink;
+
+	// Walks through 2018-2024 in uneven steps so we hit every month, weekday and hour
+	inline time_t sample(const uint32_t i) { return base_time + (i % 50000) * 4567UL; }
+
+	void benchTzTimeToLocal(const uint32_t i) { sink = berlin.tzTime(sample(i), UTC_TIME); }
+	void benchTzTimeToUTC(const uint32_t i) { sink = berlin.tzTime(sample(i), LOCAL_TIME); }
+	void benchTzTimeSouthern(const uint32_t i) { sink = sydney.tzTime(sample(i), UTC_TIME); }
+	void benchTzTimeUTC(const uint32_t i) { sink = UTC.tzTime(sample(i), UTC_TIME); }
+	void benchTzTimeHistory(const uint32_t i) { sink = history.tzTime(sample(i), UTC_TIME); }
+	void benchTzTimeHistoryRandom(const uint32_t i) { sink = history.tzTime(i * 2654435761UL % 2000000000UL, UTC_TIME); }
+	void benchTzTimeValidUntil(const uint32_t i) {
+		String tzname;
+		bool is_dst;
+		int16_t offset;
+		time_t valid_until;
+		sink = berlin.tzTime(sample(i), UTC_TIME, tzname, is_dst, offset, valid_until) + valid_until;
+	}
+
+	// A batch converter that only asks again when the offset it has stops being valid
+	void benchTzTimeWindowed(const uint32_t i) {
+		static time_t valid_from = 0, valid_until = 0;
+		static int16_t offset = 0;
+		time_t t = sample(i);
+		if (t < valid_from || t >= valid_until) {
+			String tzname;
+			bool is_dst;
+			valid_from = t;
+			berlin.tzTime(t, UTC_TIME, tzname, is_dst, offset, valid_until);
+		}
+		sink = t - offset * 60;
+	}
+
+	void benchNextTransition(const uint32_t i) { sink = berlin.nextTransition(sample(i), UTC_TIME); }
+	void benchPrevTransition(const uint32_t i) { sink = berlin.prevTransition(sample(i), UTC_TIME); }
+	void benchIsDST(const uint32_t i) { sink = berlin.isDST(sample(i), UTC_TIME); }
+	void benchGetOffset(const uint32_t i) { sink = berlin.getOffset(sample(i), UTC_TIME); }
+
+	void benchBreakTime(const uint32_t i) {
+		tmElements_t tm;
+		breakTime(sample(i), tm);
+		sink = tm.Day;
+	}
+
+	void benchMakeTime(const uint32_t i) { sink = makeTime(i % 24, i % 60, i % 60, i % 28 + 1, i % 12 + 1, 2018 + i % 7); }
+
+	void benchMakeTimeElements(const uint32_t i) {
+		tmElements_t tm;
+		tm.Hour = i % 24; tm.Minute = i % 60; tm.Second = i % 60;
+		tm.Day = i % 28 + 1; tm.Month = i % 12 + 1; tm.Year = 48 + i % 7;
+		sink = makeTime(tm);
+	}
+
+	void benchMakeOrdinalTime(const uint32_t i) { sink = makeOrdinalTime(2, 0, 0, i % 5 + 1, i % 7 + 1, i % 12 + 1, 2018 + i % 7); }
+
+	void benchWeekISO(const uint32_t i) { sink = berlin.weekISO(sample(i), UTC_TIME); }
+	void benchYearISO(const uint32_t i) { sink = berlin.yearISO(sample(i), UTC_TIME); }
+	void benchDayOfYear(const uint32_t i) { sink = berlin.dayOfYear(sample(i), UTC_TIME); }
+	void benchEvents(const uint32_t i) { (void)i; events(); }
+
+	// Samples to add up per local hour, day, week or month: 1000 of them every 15 minutes over
+	// the start of DST in March 2018, per operation. The scalar way converts and takes apart
+	// every one of them, localBuckets() does the whole array.
+	const size_t BUCKET_SAMPLES = 1000;
+	time_t bucket_samples[BUCKET_SAMPLES];
+	time_t bucket_keys[BUCKET_SAMPLES];
+
+	void fillBucketSamples() {
+		for (size_t n = 0; n < BUCKET_SAMPLES; n++) bucket_samples[n] = 1521504000 + n * 900;
+	}
+
+	template <ezBucket_t bucket> void benchBucketsScalar(const uint32_t i) {
+		(void)i;
+		for (size_t n = 0; n < BUCKET_SAMPLES; n++) {
+			tmElements_t tm;
+			breakTime(berlin.tzTime(bucket_samples[n], UTC_TIME), tm);
+			if (bucket == BUCKET_HOUR) tm.Minute = tm.Second = 0;
+			if (bucket != BUCKET_HOUR) tm.Hour = tm.Minute = tm.Second = 0;
+			if (bucket == BUCKET_MONTH) tm.Day = 1;
+			bucket_keys[n] = makeTime(tm);
+			if (bucket == BUCKET_WEEK) bucket_keys[n] -= (tm.Wday + 5) % 7 * SECS_PER_DAY;
+		}
+		sink = bucket_keys[i % BUCKET_SAMPLES];
+	}
+
+	template <ezBucket_t bucket> void benchBucketsBatch(const uint32_t i) {
+		berlin.localBuckets(bucket_samples, bucket_keys, BUCKET_SAMPLES, bucket);
+		sink = bucket_keys[i % BUCKET_SAMPLES];
+	}
+
+	// Reading a zone back from the EEPROM cache, like at boot
+	Timezone cached;
+	void benchSetCacheAddress(const uint32_t i) { (void)i; sink = cached.setCache(0); }
+	void benchSetCacheRegion(const uint32_t i) { sink = cached.setCache(i % 2 ? "home" : "work"); }
+
+	// Answers setLocation() from the same process, to fill the cache
+	size_t timezoned(const uint32_t, const uint8_t *packet, const size_t len, uint8_t *reply, const size_t max_len) {
+		const char *answer = (len && packet[0] == 'A') ? "OK America/Argentina/Buenos_Aires <-03>3" : "OK Europe/Berlin CET-1CEST,M3.5.0,M10.5.0/3";
+		size_t size = strlen(answer);
+		if (size > max_len) return 0;
+		memcpy(reply, answer, size);
+		return size;
+	}
+
+	void fillCache() {
+		host::setUdpResponder(TIMEZONED_REMOTE_PORT, timezoned);
+		Timezone tz;
+		tz.setCache(0);
+		tz.setLocation("Berlin");
+		setCacheRegion(100, 4 * EEPROM_SLOT_LEN);
+		Timezone home, work;
+		home.setCache("home");
+		host::skipMillis(TIMEZONED_MIN_GAP);		// no need to sit out the gap left between questions
+		home.setLocation("Berlin");
+		work.setCache("work");
+		host::skipMillis(TIMEZONED_MIN_GAP);
+		work.setLocation("Argentina");
+		host::setUdpResponder(TIMEZONED_REMOTE_PORT, NULL);
+	}
+
+	#ifdef EZTIME_TZDB
+		Timezone lookup;
+		const char *lookup_names[] = { "Europe/Berlin", "america/new_york", "Pacific/Chatham", "Asia/Kolkata" };
+		void benchSetLocationTZDB(const uint32_t i) { sink = lookup.setLocation(lookup_names[i % 4]); }
+	#endif
+
+	#define DATETIME_BENCH(FORMAT) \
+		void benchDateTime_##FORMAT(const uint32_t i) { sink = berlin.dateTime(sample(i), UTC_TIME, FORMAT).length(); }
+
+	DATETIME_BENCH(ATOM)
+	DATETIME_BENCH(COOKIE)
+	DATETIME_BENCH(ISO8601)
+	DATETIME_BENCH(RFC822)
+	DATETIME_BENCH(RFC850)
+	DATETIME_BENCH(RFC1036)
+	DATETIME_BENCH(RFC1123)
+	DATETIME_BENCH(RFC2822)
+	DATETIME_BENCH(RFC3339)
+	DATETIME_BENCH(RFC3339_EXT)
+	DATETIME_BENCH(RSS)
+	DATETIME_BENCH(W3C)
+	DATETIME_BENCH(ISO8601_YWD)
+
+	// Into a buffer, no String at all
+	char datetime_buffer[64];
+	void benchDateTimeBuffer(const uint32_t i) { sink = berlin.dateTime(datetime_buffer, sizeof(datetime_buffer), sample(i), UTC_TIME, ISO8601); }
+
+	// A world clock of eight zones, one at a time and with ezt::localTimes()
+	const char *world_rules[] = {
+		"PST8PDT,M3.2.0,M11.1.0", "EST5EDT,M3.2.0,M11.1.0", "<-03>3", "GMT0BST,M3.5.0/1,M10.5.0",
+		"CET-1CEST,M3.5.0,M10.5.0/3", "IST-5:30", "JST-9", "AEST-10AEDT,M10.1.0,M4.1.0/3"
+	};
+	const uint8_t WORLD_ZONES = sizeof(world_rules) / sizeof(world_rules[0]);
+	Timezone world[WORLD_ZONES];
+	Timezone *world_zones[WORLD_ZONES];
+	ezLocalTime_t world_times[WORLD_ZONES];
+
+	void benchWorldClockDateTime(const uint32_t i) {
+		for (uint8_t n = 0; n < WORLD_ZONES; n++) {
+			sink = world[n].dateTime(datetime_buffer, sizeof(datetime_buffer), sample(i), UTC_TIME, "H:i:s T");
+		}
+	}
+
+	void benchWorldClockLocalTimes(const uint32_t i) {
+		localTimes(world_zones, world_times, WORLD_ZONES, sample(i));
+		for (uint8_t n = 0; n < WORLD_ZONES; n++) {
+			sink = world[n].dateTime(datetime_buffer, sizeof(datetime_buffer), world_times[n], "H:i:s T");
+		}
+	}
+
+	const benchmark_t benchmarks[] = {
+		{ "tzTime/utc_to_local",		benchTzTimeToLocal },
+		{ "tzTime/local_to_utc",		benchTzTimeToUTC },
+		{ "tzTime/southern",			benchTzTimeSouthern },
+		{ "tzTime/utc_zone",			benchTzTimeUTC },
+		{ "tzTime/history",				benchTzTimeHistory },
+		{ "tzTime/history_random",		benchTzTimeHistoryRandom },
+		{ "tzTime/valid_until",			benchTzTimeValidUntil },
+		{ "tzTime/windowed",			benchTzTimeWindowed },
+		{ "nextTransition",				benchNextTransition },
+		{ "prevTransition",				benchPrevTransition },
+		{ "isDST",						benchIsDST },
+		{ "getOffset",					benchGetOffset },
+		{ "breakTime",					benchBreakTime },
+		{ "makeTime/fields",			benchMakeTime },
+		{ "makeTime/tmElements",		benchMakeTimeElements },
+		{ "makeOrdinalTime",			benchMakeOrdinalTime },
+		{ "dateTime/ATOM",				benchDateTime_ATOM },
+		{ "dateTime/COOKIE",			benchDateTime_COOKIE },
+		{ "dateTime/ISO8601",			benchDateTime_ISO8601 },
+		{ "dateTime/RFC822",			benchDateTime_RFC822 },
+		{ "dateTime/RFC850",			benchDateTime_RFC850 },
+		{ "dateTime/RFC1036",			benchDateTime_RFC1036 },
+		{ "dateTime/RFC1123",			benchDateTime_RFC1123 },
+		{ "dateTime/RFC2822",			benchDateTime_RFC2822 },
+		{ "dateTime/RFC3339",			benchDateTime_RFC3339 },
+		{ "dateTime/RFC3339_EXT",		benchDateTime_RFC3339_EXT },
+		{ "dateTime/RSS",				benchDateTime_RSS },
+		{ "dateTime/W3C",				benchDateTime_W3C },
+		{ "dateTime/ISO8601_YWD",		benchDateTime_ISO8601_YWD },
+		{ "dateTime/buffer",			benchDateTimeBuffer },
+		{ "worldClock/dateTime",		benchWorldClockDateTime },
+		{ "worldClock/localTimes",		benchWorldClockLocalTimes },
+		{ "weekISO",					benchWeekISO },
+		{ "yearISO",					benchYearISO },
+		{ "dayOfYear",					benchDayOfYear },
+		{ "events",						benchEvents },
+		{ "buckets/hour/scalar",		benchBucketsScalar<BUCKET_HOUR> },
+		{ "buckets/hour/batch",			benchBucketsBatch<BUCKET_HOUR> },
+		{ "buckets/day/scalar",			benchBucketsScalar<BUCKET_DAY> },
+		{ "buckets/day/batch",			benchBucketsBatch<BUCKET_DAY> },
+		{ "buckets/week/scalar",		benchBucketsScalar<BUCKET_WEEK> },
+		{ "buckets/week/batch",			benchBucketsBatch<BUCKET_WEEK> },
+		{ "buckets/month/scalar",		benchBucketsScalar<BUCKET_MONTH> },
+		{ "buckets/month/batch",		benchBucketsBatch<BUCKET_MONTH> },
+		{ "setCache/address",			benchSetCacheAddress },
+		{ "setCache/region",			benchSetCacheRegion },
+		#ifdef EZTIME_TZDB
+			{ "setLocation/tzdb",		benchSetLocationTZDB },
+		#endif
+	};
+
+	double elapsedNs(std::chrono::steady_clock::time_point since) {
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - since).count();
+	}
+
+	void loadHistory(const char *path) {
+		std::ifstream file(path, std::ios::binary);
+		std::vector<uint8_t> tzif((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (tzif.empty() || !history.setTZif(tzif.data(), tzif.size())) {
+			fprintf(stderr, "%s not loaded, tzTime/history* use the POSIX rule\n", path);
+			history.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		}
+	}
+
+	void setBerlin(Timezone &tz) {
+		#ifdef EZTIME_TZDB
+			tz.setLocation("Europe/Berlin");
+		#else
+			tz.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		#endif
+	}
+
+	// Timezones in the same zone share its rule, so the heap grows with the number of zones
+	// rather than with the number of Timezones (unless built with EZTIME_FIXED_STRINGS)
+	void footprint() {
+		#ifdef EZTIME_FIXED_STRINGS
+			const char *storage = "fixed strings";
+		#else
+			const char *storage = "String";
+		#endif
+		printf("Timezone (%s): %u bytes in the object\n", storage, (unsigned)sizeof(Timezone));
+		size_t before = host::heap_bytes;
+		{
+			Timezone zones[100];
+			for (int n = 0; n < 100; n++) setBerlin(zones[n]);
+			printf("  100 of them in Europe/Berlin: %u bytes on the heap\n", (unsigned)(host::heap_bytes - before));
+		}
+		before = host::heap_bytes;
+		Timezone tz;
+		tz.setPosix("NZST-12NZDT,M9.5.0,M4.1.0/3");
+		printf("  one in a zone none of the others are in: %u bytes on the heap\n\n", (unsigned)(host::heap_bytes - before));
+	}
+
+	void run(const benchmark_t &b, const bool quick) {
+		// Find an iteration count that takes about 250 ms
+		uint32_t iterations = quick ? 100 : 1000;
+		if (!quick) {
+			for (;;) {
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < iterations; i++) b.function(i);
+				double ns = elapsedNs(start);
+				if (ns > 25e6 || iterations >= 100000000) {
+					iterations = (uint32_t)(iterations * (250e6 / (ns > 1 ? ns : 1)));
+					if (iterations < 10) iterations = 10;
+					break;
+				}
+				iterations *= 10;
+			}
+		}
+		unsigned long allocations = host::allocations;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < iterations; i++) b.function(i);
+		double ns = elapsedNs(start);
+		allocations = host::allocations - allocations;
+		printf("%-28s %12u %12.1f %10.2f\n", b.name, iterations, ns / iterations, (double)allocations / iterations);
+		fflush(stdout);
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	bool quick = false;
+	const char *filter = NULL;
+	for (int n = 1; n < argc; n++) {
+		if (!strcmp(argv[n], "--quick")) {
+			quick = true;
+		} else if (argv[n][0] == '-') {
+			fprintf(stderr, "usage: %s [--quick] [filter]\n", argv[0]);
+			return 1;
+		} else {
+			filter = argv[n];
+		}
+	}
+
+	setInterval(0);								// no NTP: events() must not touch the network
+	UTC.setTime(base_time);
+	berlin.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+	sydney.setPosix("AEST-10AEDT,M10.1.0,M4.1.0/3");
+	for (uint8_t n = 0; n < WORLD_ZONES; n++) {
+		world[n].setPosix(world_rules[n]);
+		world_zones[n] = &world[n];
+	}
+	loadHistory("/usr/share/zoneinfo/Europe/Berlin");
+	fillBucketSamples();
+	fillCache();
+	events();									// first call initialises
+
+	footprint();
+	printf("%-28s %12s %12s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+	for (const benchmark_t &b : benchmarks) {
+		if (filter && !strstr(b.name, filter)) continue;
+		run(b, quick);
+	}
+	return 0;
+}
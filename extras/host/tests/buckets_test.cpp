@@ -0,0 +1,119 @@
+/*
+ * buckets_test - Timezone::localBuckets() against the slow way (tzTime(), breakTime() and
+ * makeTime() per sample), for every zone in the compiled-in database, with times in order and
+ * shuffled, and for Berlin's history from the host's TZif file if there is one.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+#include <ezTimeDB.h>
+
+#include "check.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+	const ezBucket_t BUCKETS[] = { BUCKET_HOUR, BUCKET_DAY, BUCKET_WEEK, BUCKET_MONTH };
+	const char *BUCKET_NAMES[] = { "hour", "day", "week", "month" };
+
+	time_t slowBucket(Timezone &tz, const time_t t, const ezBucket_t bucket) {
+		tmElements_t tm;
+		breakTime(tz.tzTime(t, UTC_TIME), tm);
+		switch (bucket) {
+			case BUCKET_HOUR: return makeTime(tm.Hour, 0, 0, tm.Day, tm.Month, tm.Year + 1970);
+			case BUCKET_DAY: return makeTime(0, 0, 0, tm.Day, tm.Month, tm.Year + 1970);
+			case BUCKET_WEEK: return makeTime(0, 0, 0, tm.Day, tm.Month, tm.Year + 1970) - (tm.Wday + 5) % 7 * SECS_PER_DAY;
+			case BUCKET_MONTH: return makeTime(0, 0, 0, 1, tm.Month, tm.Year + 1970);
+		}
+		return 0;
+	}
+
+	// Returns false after the first mismatch, so one broken zone does not flood the output
+	bool compare(Timezone &tz, const char *name, const std::vector<time_t> &samples) {
+		std::vector<time_t> keys(samples.size());
+		for (uint8_t b = 0; b < 4; b++) {
+			tz.localBuckets(samples.data(), keys.data(), samples.size(), BUCKETS[b]);
+			for (size_t n = 0; n < samples.size(); n++) {
+				time_t expected = slowBucket(tz, samples[n], BUCKETS[b]);
+				if (keys[n] != expected) {
+					fprintf(stderr, "%s, %s of %ld: %ld, not %ld\n", name, BUCKET_NAMES[b], (long)samples[n], (long)keys[n], (long)expected);
+					failures++;
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Every 4 hours and 7 minutes from 2018 through 2020, which comes by every hour of the day
+	// and every transition, and the same times shuffled
+	std::vector<time_t> sorted, shuffled;
+
+	void makeSamples() {
+		for (time_t t = 1514764800; t < 1609459200; t += 247 * 60) sorted.push_back(t);
+		shuffled = sorted;
+		uint32_t state = 12345;
+		for (size_t n = shuffled.size() - 1; n > 0; n--) {
+			state = state * 1103515245UL + 12345;
+			size_t m = state % (n + 1);
+			time_t tmp = shuffled[n];
+			shuffled[n] = shuffled[m];
+			shuffled[m] = tmp;
+		}
+	}
+
+	void everyZone() {
+		int passed = 0;
+		for (int n = 0; n < TZDB_ZONES; n++) {
+			Timezone tz;
+			tz.setPosix(_tzdb_rules + _tzdb_index[n][1]);
+			const char *name = _tzdb_names + _tzdb_index[n][0];
+			if (compare(tz, name, sorted) && (n % 16 || compare(tz, name, shuffled))) passed++;
+		}
+		printf("%d of %d zones bucketed right\n", passed, TZDB_ZONES);
+	}
+
+	// In place, and the same key for samples in the same local hour on both sides of a change
+	void inPlace() {
+		Timezone berlin;
+		berlin.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		time_t times[] = { 1540684800, 1540688399, 1540688400, 1540692000 };	// 2018-10-28 00:00, 00:59:59, 01:00, 02:00 UTC
+		berlin.localBuckets(times, times, 4, BUCKET_HOUR);
+		CHECK(times[0] == 1540692000 && times[1] == 1540692000);			// 02:00 local, CEST
+		CHECK(times[2] == 1540692000);										// 02:00 local again, CET
+		CHECK(times[3] == 1540695600);
+	}
+
+	void history() {
+		std::ifstream file("/usr/share/zoneinfo/Europe/Berlin", std::ios::binary);
+		std::vector<uint8_t> tzif((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		Timezone tz;
+		if (tzif.empty() || !tz.setTZif(tzif.data(), tzif.size())) {
+			printf("No TZif file for Europe/Berlin, history not checked\n");
+			return;
+		}
+		// (From 1970: breakTime(), for the slow way, does not do times before that)
+		std::vector<time_t> old;
+		for (time_t t = 0; t < 1000000000; t += 3917 * 60) old.push_back(t);
+		compare(tz, "Europe/Berlin (TZif)", old);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	makeSamples();
+	everyZone();
+	inPlace();
+	history();
+	if (failures) return 1;
+	printf("All bucket checks passed\n");
+	return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * cache_test - the EEPROM timezone cache: one zone at a fixed address with setCache(address),
+ * and many zones sharing a region with setCacheRegion() and setCache(key). Every "boot" is a
+ * fork() of this process, so it starts with a fresh ezTime but the EEPROM as it was left.
+ * The timezone server is answered in-process (host::setUdpResponder), and every zone in the
+ * compiled-in database goes through the cache once.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <HostShim.h>
+#include <ezTime.h>
+#include <ezTimeDB.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+	const char *BERLIN = "CET-1CEST,M3.5.0,M10.5.0/3";
+	const char *LONDON = "GMT0BST,M3.5.0/1,M10.5.0";
+	const char *TOKYO = "JST-9";
+	const char *NEW_SALEM = "CST6CDT,M3.2.0,M11.1.0";
+
+	const int REGION = 100;
+	const int SLOTS = 6;
+
+	size_t timezoned(const uint32_t, const uint8_t *packet, const size_t len, uint8_t *reply, const size_t max_len) {
+		String query;
+		for (size_t n = 0; n < len && packet[n] != '#'; n++) query += (char)packet[n];
+		String answer = "ERROR Timezone Not Found";
+		if (query == "Berlin") answer = String("OK Europe/Berlin ") + BERLIN;
+		if (query == "London") answer = String("OK Europe/London ") + LONDON;
+		if (query == "Tokyo") answer = String("OK Asia/Tokyo ") + TOKYO;
+		// Too long for the old text format, the times are written out in full
+		if (query == "New Salem") answer = "OK America/North_Dakota/New_Salem CST6CDT,M3.2.0/2:00:00,M11.1.0/02:00:00";
+		if (answer.length() > max_len) return 0;
+		memcpy(reply, answer.c_str(), answer.length());
+		return answer.length();
+	}
+
+	int boot(void (*function)()) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if (!pid) {
+			function();
+			fflush(stdout);
+			_exit(failures ? 1 : 0);
+		}
+		int status;
+		waitpid(pid, &status, 0);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	}
+
+	unsigned long mostWrites(const int from, const int to) {
+		unsigned long most = 0;
+		for (int n = from; n < to; n++) {
+			if (host::eepromCellWrites(n) > most) most = host::eepromCellWrites(n);
+		}
+		return most;
+	}
+
+	// The slot in the region with the highest sequence number
+	int newestSlot() {
+		int newest = 0;
+		uint16_t highest = 0;
+		for (int n = 0; n < SLOTS; n++) {
+			int addr = REGION + n * EEPROM_SLOT_LEN;
+			uint16_t sequence = EEPROM.read(addr + 2) << 8 | EEPROM.read(addr + 3);
+			if (sequence > highest) {
+				highest = sequence;
+				newest = n;
+			}
+		}
+		return newest;
+	}
+
+	// One zone at address 0: nothing is written when nothing changed
+	void fixedAddress() {
+		Timezone tz;
+		CHECK(!tz.setCache(0));
+		CHECK(tz.setLocation("Berlin"));
+		unsigned long writes = host::eeprom_writes;
+		CHECK(tz.setLocation("Berlin"));
+		CHECK(host::eeprom_writes == writes);
+		CHECK(tz.setLocation("London"));
+		CHECK(host::eeprom_writes > writes);
+	}
+
+	void fixedAddressBoot() {
+		Timezone tz;
+		CHECK(tz.setCache(0));
+		CHECK(tz.getPosix() == LONDON);
+		CHECK(tz.getOlson() == "Europe/London");
+	}
+
+	// Two zones in a region of six slots, one of them moving a lot
+	void region() {
+		CHECK(setCacheRegion(REGION, SLOTS * EEPROM_SLOT_LEN));
+		Timezone home, work;
+		CHECK(!home.setCache("home"));
+		CHECK(!work.setCache("work"));
+		CHECK(work.setLocation("Tokyo"));
+		for (int n = 0; n < 200; n++) CHECK(home.setLocation(n % 2 ? "London" : "Berlin"));
+		// 200 writes spread over the five slots work isn't using
+		unsigned long most = mostWrites(REGION, REGION + SLOTS * EEPROM_SLOT_LEN);
+		printf("200 relocations in %d slots: at most %lu writes to one byte\n", SLOTS, most);
+		CHECK(most <= 200 / (SLOTS - 1) + 1);
+		unsigned long writes = host::eeprom_writes;
+		CHECK(home.setLocation("London"));
+		CHECK(work.setLocation("Tokyo"));
+		CHECK(host::eeprom_writes == writes);
+	}
+
+	void regionBoot() {
+		CHECK(setCacheRegion(REGION, SLOTS * EEPROM_SLOT_LEN));
+		Timezone home, work, other;
+		CHECK(home.setCache("home") && home.getPosix() == LONDON);
+		CHECK(work.setCache("work") && work.getPosix() == TOKYO);
+		CHECK(!other.setCache("other"));
+	}
+
+	// Reset halfway through writing London: the newest slot has a bad checksum
+	void tornWriteBoot() {
+		int last_byte = REGION + newestSlot() * EEPROM_SLOT_LEN + EEPROM_SLOT_LEN - 1;
+		EEPROM.write(last_byte, EEPROM.read(last_byte) ^ 0x55);
+		CHECK(setCacheRegion(REGION, SLOTS * EEPROM_SLOT_LEN));
+		Timezone home, work;
+		CHECK(home.setCache("home") && home.getPosix() == BERLIN);
+		CHECK(work.setCache("work") && work.getPosix() == TOKYO);
+	}
+
+	// clearCache() gets rid of every version, not just the newest
+	void clearBoot() {
+		CHECK(setCacheRegion(REGION, SLOTS * EEPROM_SLOT_LEN));
+		Timezone home, work;
+		CHECK(home.setCache("home"));
+		home.clearCache();
+		Timezone again, work_again;
+		CHECK(!again.setCache("home"));
+		CHECK(work_again.setCache("work") && work_again.getPosix() == TOKYO);
+	}
+
+	// Two slots, three zones: the third does not fit, the others still change in place
+	void full() {
+		CHECK(!setCacheRegion(REGION, EEPROM_SLOT_LEN - 1));
+		CHECK(setCacheRegion(REGION, 2 * EEPROM_SLOT_LEN));
+		for (int n = REGION; n < REGION + 2 * EEPROM_SLOT_LEN; n++) EEPROM.write(n, 0xFF);
+		CHECK(setCacheRegion(REGION, 2 * EEPROM_SLOT_LEN));
+		Timezone a, b, c;
+		CHECK(!a.setCache("a") && !b.setCache("b") && !c.setCache("c"));
+		CHECK(a.setLocation("Berlin"));
+		CHECK(b.setLocation("London"));
+		CHECK(c.setLocation("Tokyo"));
+		CHECK(error() == CACHE_TOO_SMALL);
+		CHECK(a.setLocation("Tokyo"));
+		Timezone a2, b2;
+		CHECK(a2.setCache("a") && a2.getPosix() == TOKYO);
+		CHECK(b2.setCache("b") && b2.getPosix() == LONDON);
+	}
+
+	// Too long for the old text format
+	void longName() {
+		Timezone tz;
+		CHECK(!tz.setCache(200));
+		CHECK(tz.setLocation("New Salem"));
+	}
+
+	void longNameBoot() {
+		Timezone tz;
+		CHECK(tz.setCache(200));
+		CHECK(tz.getOlson() == "America/North_Dakota/New_Salem");
+		CHECK(tz.getPosix() == NEW_SALEM);
+	}
+
+	// Every zone in the database fits, and comes back exactly, case and all
+	void everyZone() {
+		int fitted = 0;
+		for (int n = 0; n < TZDB_ZONES; n++) {
+			String olson = _tzdb_names + _tzdb_index[n][0];
+			String posix = _tzdb_rules + _tzdb_index[n][1];
+			Timezone tz, back;
+			tz.setCache(300);
+			CHECK(tz.setLocation(olson));
+			if (back.setCache(300) && back.getOlson() == olson && back.getPosix() == posix) {
+				fitted++;
+			} else {
+				fprintf(stderr, "%s %s came back as %s %s\n", olson.c_str(), posix.c_str(), back.getOlson().c_str(), back.getPosix().c_str());
+			}
+		}
+		printf("%d of %d zones cached and read back\n", fitted, TZDB_ZONES);
+		CHECK(fitted == TZDB_ZONES);
+	}
+
+	// A block in the text format from before: still read, the case of the name guessed back
+	void textFormat() {
+		const char *text = "EUROPE/BERLIN CET-1CEST,M3.5.0,M10.5.0/3";
+		uint8_t block[EEPROM_CACHE_LEN] = { 94, (uint8_t)strlen(text) };
+		for (size_t n = 0; n < strlen(text); n++) {
+			uint32_t bits = (uint32_t)(text[n] - 32) << (18 - 6 * (n % 4));
+			for (int m = 0; m < 3; m++) block[2 + n / 4 * 3 + m] |= bits >> (16 - 8 * m);
+		}
+		uint8_t checksum = 42;
+		for (int n = 0; n < EEPROM_CACHE_LEN - 1; n++) checksum += block[n];
+		block[EEPROM_CACHE_LEN - 1] = checksum;
+		for (int n = 0; n < EEPROM_CACHE_LEN; n++) EEPROM.write(400 + n, block[n]);
+		Timezone tz;
+		CHECK(tz.setCache(400));
+		CHECK(tz.getOlson() == "Europe/Berlin");
+		CHECK(tz.getPosix() == BERLIN);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1700000000);
+	host::setUdpResponder(TIMEZONED_REMOTE_PORT, timezoned);
+	host::setMillis(0);		// answered straight away, so the gap setLocation() leaves between questions can take no time
+
+	int failed = 0;
+	fixedAddress();						// in this process, so the boots after it see the EEPROM
+	failed += boot(fixedAddressBoot);
+	region();
+	failed += boot(regionBoot);
+	failed += boot(tornWriteBoot);
+	failed += boot(clearBoot);
+	failed += boot(full);
+	longName();
+	failed += boot(longNameBoot);
+	failed += boot(everyZone);
+	failed += boot(textFormat);
+	if (failed || failures) {
+		fprintf(stderr, "%d boot(s) failed\n", failed + (failures ? 1 : 0));
+		return 1;
+	}
+	printf("All cache checks passed\n");
+	return 0;
+}
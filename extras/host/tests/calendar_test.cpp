@@ -0,0 +1,176 @@
+/*
+ * calendar_test - the constexpr calendar in ezTimeCalendar.h. Some of it is checked while
+ * compiling, with static_assert. The rest runs: breakTime() against gmtime() for every day
+ * from 1970 to 2105, makeTime() and makeOrdinalTime() the long way round, and every rule in
+ * the compiled-in database parsed by ezCalendar::rule() the same as setPosix() does it. Also
+ * built as calendar_64_test with EZTIME_64BIT_TIME, where all of it must still hold.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+#include <ezTimeDB.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+	// All of these are done by the compiler, or this does not build
+	static_assert(makeTime(14, 23, 45, 25, AUGUST, 2018) == 1535207025, "makeTime");
+	static_assert(makeTime(0, 0, 0, 1, JANUARY, 48) == 1514764800, "makeTime, years since 1970");
+	static_assert(makeTime(0, 0, 0, 29, FEBRUARY, 2000) + SECS_PER_DAY == makeTime(0, 0, 0, 1, MARCH, 2000), "leap day");
+	static_assert(makeOrdinalTime(2, 0, 0, LAST, SUNDAY, MARCH, 2018) == 1521943200, "makeOrdinalTime, last");
+	static_assert(makeOrdinalTime(2, 0, 0, SECOND, SUNDAY, MARCH, 2019) == 1552183200, "makeOrdinalTime, second");
+	static_assert(makeOrdinalTime(0, 0, 0, LAST, FRIDAY, DECEMBER, 2020) == 1608854400, "makeOrdinalTime, last of the year");
+	static_assert(breakTime(1535207025).Year == 48 && breakTime(1535207025).Month == 8 && breakTime(1535207025).Day == 25, "breakTime date");
+	static_assert(breakTime(1535207025).Hour == 14 && breakTime(1535207025).Wday == SATURDAY, "breakTime time");
+	static_assert(compileTime("Aug 25 2018", "14:23:45") == 1535207025, "compileTime");
+	static_assert(compileTime("Feb  5 2021", "01:02:03") == 1612486923, "compileTime, one digit day");
+	static_assert(compileTime("Foo 25 2018", "14:23:45") == 0, "compileTime, no such month");
+	static_assert(compileTime() > 1700000000, "compileTime, now");
+
+	constexpr ezZone_t BERLIN = EZT_ZONE("CET-1CEST,M3.5.0,M10.5.0/3");
+	constexpr ezZone_t KOLKATA = EZT_ZONE("IST-5:30");
+	constexpr ezZone_t CHATHAM = EZT_ZONE("<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45");
+	static_assert(BERLIN.rule.std_offset == -60 && BERLIN.rule.dst_offset == -120, "offsets");
+	static_assert(BERLIN.rule.start_month == 3 && BERLIN.rule.start_week == 5 && BERLIN.rule.start_dow == 0 && BERLIN.rule.start_time == 120, "start");
+	static_assert(BERLIN.rule.end_month == 10 && BERLIN.rule.end_time == 180, "end");
+	static_assert(BERLIN.rule.std_name[0] == 'C' && BERLIN.rule.dst_name[3] == 'T' && !BERLIN.rule.dst_name[4], "names");
+	static_assert(KOLKATA.rule.std_offset == -330 && !KOLKATA.rule.start_month && !KOLKATA.rule.dst_name[0], "no DST");
+	static_assert(CHATHAM.rule.std_name[0] == '+' && CHATHAM.rule.std_name[5] == 0, "name in brackets");
+	static_assert(CHATHAM.rule.dst_offset == -825 && CHATHAM.rule.start_time == 165 && CHATHAM.rule.end_time == 225, "odd minutes");
+
+	bool sameRule(const ezRule_t &a, const ezRule_t &b) {
+		return a.std_offset == b.std_offset && a.dst_offset == b.dst_offset &&
+			a.start_month == b.start_month && a.start_week == b.start_week && a.start_dow == b.start_dow && a.start_time == b.start_time &&
+			a.end_month == b.end_month && a.end_week == b.end_week && a.end_dow == b.end_dow && a.end_time == b.end_time &&
+			!memcmp(a.std_name, b.std_name, sizeof(a.std_name)) && !memcmp(a.dst_name, b.dst_name, sizeof(a.dst_name));
+	}
+
+	// Every day, at its first and last second
+	void everyDay() {
+		int days = 0;
+		for (time_t t = 0; t < 4291747200LL; t += SECS_PER_DAY) {		// up to 2106-01-01
+			for (time_t s = t; s < t + (time_t)SECS_PER_DAY; s += SECS_PER_DAY - 1) {
+				struct tm want;
+				gmtime_r(&s, &want);
+				tmElements_t tm;
+				ezt::breakTime(s, tm);
+				if (tm.Year + 70 != want.tm_year || tm.Month != want.tm_mon + 1 || tm.Day != want.tm_mday ||
+					tm.Hour != want.tm_hour || tm.Minute != want.tm_min || tm.Second != want.tm_sec || tm.Wday != want.tm_wday + 1) {
+					fprintf(stderr, "breakTime(%ld): %d-%d-%d, not %d-%d-%d\n", (long)s, tm.Year + 1970, tm.Month, tm.Day, want.tm_year + 1900, want.tm_mon + 1, want.tm_mday);
+					failures++;
+					return;
+				}
+				if (makeTime(tm) != s) {
+					fprintf(stderr, "makeTime() of %ld: %ld\n", (long)s, (long)makeTime(tm));
+					failures++;
+					return;
+				}
+			}
+			days++;
+		}
+		printf("%d days taken apart and put back together\n", days);
+	}
+
+	// The 'ordinal' 'wday' of every month in 1970 - 2105, by walking the days of the month
+	void ordinals() {
+		for (uint16_t year = 1970; year < 2106; year++) {
+			for (uint8_t month = 1; month <= 12; month++) {
+				for (uint8_t wday = 1; wday <= 7; wday++) {
+					time_t found[5];
+					uint8_t count = 0;
+					for (time_t t = makeTime(0, 0, 0, 1, month, year); breakTime(t).Month == month; t += SECS_PER_DAY) {
+						if (breakTime(t).Wday == wday) found[count++] = t;
+					}
+					for (uint8_t ordinal = FIRST; ordinal <= LAST; ordinal++) {
+						time_t want = (ordinal == LAST) ? found[count - 1] : found[ordinal - 1];
+						if (makeOrdinalTime(0, 0, 0, ordinal, wday, month, year) != want) {
+							fprintf(stderr, "makeOrdinalTime(%d, %d, %d, %d) is not %ld\n", ordinal, wday, month, year, (long)want);
+							failures++;
+							return;
+						}
+					}
+					CHECK(makeOrdinalTime(0, 0, 0, 0, wday, month, year) == found[count - 1]);
+				}
+			}
+		}
+	}
+
+	// The compiler's parser and the runtime one agree on every zone there is
+	void everyRule() {
+		int agreed = 0;
+		for (int n = 0; n < TZDB_ZONES; n++) {
+			const char *posix = _tzdb_rules + _tzdb_index[n][1];
+			Timezone tz;
+			tz.setPosix(posix);
+			if (ezCalendar::usable(posix) && sameRule(ezCalendar::rule(posix), tz.getRule())) {
+				agreed++;
+			} else {
+				fprintf(stderr, "%s: %s parsed differently\n", _tzdb_names + _tzdb_index[n][0], posix);
+				failures++;
+			}
+		}
+		printf("%d of %d rules parsed the same\n", agreed, TZDB_ZONES);
+		// And some that are not in there
+		const char *others[] = { "UTC0", "UTC5", "<UTC>3", "EST5EDT", "EST5EDT4,M3.2.0/-1,M11.1.0/26", "LONGNAME-1LONGERNAME",
+			"X+1:30:15Y,M3.5.0/1:30:59,M10.5.0", "<+00>0<+02>-2,M3.5.0/1,M10.5.0/3" };
+		for (const char *posix : others) {
+			Timezone tz;
+			tz.setPosix(posix);
+			if (!sameRule(ezCalendar::rule(posix), tz.getRule())) {
+				fprintf(stderr, "%s parsed differently\n", posix);
+				failures++;
+			}
+		}
+		// Strings EZT_ZONE() refuses
+		const char *bad[] = { "", "CET", "-1", "CET-1CEST", "CET-1CEST,M3.5.0", "CET-1CEST,M13.5.0,M10.5.0", "CET-1CEST,M3.5.0,M10.5.0/3x", "CET-1 " };
+		for (const char *posix : bad) CHECK(!ezCalendar::usable(posix));
+		CHECK(ezCalendar::usable("CET-1CEST,M3.5.0,M10.5.0/3"));
+	}
+
+	// compileTime() with Strings does what the constexpr one does
+	void compiled() {
+		CHECK(compileTime(String(__DATE__), String(__TIME__)) == compileTime());
+		CHECK(compileTime(String("Aug 25 2018"), String("14:23:45")) == 1535207025);
+		CHECK(compileTime(String("Aug 25"), String("14:23:45")) == 0);
+	}
+
+	// A Timezone set from EZT_ZONE() is the same as one set from the string
+	void zones() {
+		Timezone a, b;
+		CHECK(a.setPosix(BERLIN));
+		CHECK(b.setPosix("CET-1CEST,M3.5.0,M10.5.0/3"));
+		CHECK(sameRule(a.getRule(), b.getRule()));
+		CHECK(a.getPosix() == "CET-1CEST,M3.5.0,M10.5.0/3");
+		#ifndef EZTIME_FIXED_STRINGS
+			CHECK(&a.getRule() == &b.getRule());
+		#endif
+		CHECK(a.dateTime(1530000000, UTC_TIME, "H:i T") == "10:00 CEST");
+		// Not worked out while compiling: parsed at runtime, with an error
+		const char *posix = "CET-1CEST,M3.5.0";
+		error(true);
+		ezZone_t broken = EZT_ZONE(posix);
+		CHECK(error() == INVALID_DATA);
+		CHECK(a.setPosix(broken) && a.getOffset(1530000000, UTC_TIME) == -60);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	everyDay();
+	ordinals();
+	everyRule();
+	compiled();
+	zones();
+	if (failures) return 1;
+	printf("All calendar checks passed\n");
+	return 0;
+}
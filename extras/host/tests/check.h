@@ -0,0 +1,24 @@
+/*
+ * check.h - CHECK() for the host tests. A condition that does not hold is reported with its
+ * file and line and counted in 'failures', and the test goes on. main() returns 1 if any failed.
+ */
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <stdio.h>
+
+namespace {
+
+	int failures = 0;
+
+	#define CHECK(condition) do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+}
+
+#endif // _CHECK_H_
@@ -0,0 +1,67 @@
+/*
+ * chrono_test - ezt::clock from ezTimeChrono.h: that it is a std::chrono clock, that now() is
+ * the time ezTime keeps down to the millisecond, and that time_t goes in and out of it. Built
+ * twice: as chrono_test, and as chrono_64_test with EZTIME_64BIT_TIME, for times before 1970.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+#include <ezTimeChrono.h>
+
+#include "check.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <type_traits>
+
+namespace {
+
+	// What the standard asks of a Clock
+	static_assert(std::is_same<ezt::clock::rep, ezt::clock::duration::rep>::value, "rep");
+	static_assert(std::is_same<ezt::clock::period, ezt::clock::duration::period>::value, "period");
+	static_assert(std::is_same<ezt::clock::duration, ezt::clock::time_point::duration>::value, "duration");
+	static_assert(std::is_same<ezt::clock, ezt::clock::time_point::clock>::value, "time_point");
+	static_assert(std::is_same<decltype(ezt::clock::now()), ezt::clock::time_point>::value, "now()");
+	static_assert(!ezt::clock::is_steady, "not steady");
+
+	// The same second and millisecond UTC says, on a simulated clock that does not move by itself
+	void reading() {
+		host::setMillis(5000);
+		UTC.setTime(1530000000, 250);
+		ezt::clock::time_point t = ezt::clock::now();
+		CHECK(t.time_since_epoch().count() == 1530000000250LL);
+		host::advanceMillis(1999);
+		ezt::clock::time_point later = ezt::clock::now();
+		CHECK(std::chrono::duration_cast<std::chrono::milliseconds>(later - t).count() == 1999);
+		CHECK(ezt::clock::to_time_t(later) == UTC.now());
+		CHECK(ezt::clock::to_time_t(later) == 1530000002);
+	}
+
+	// time_t in and out, rounded down to the second
+	void conversions() {
+		CHECK(ezt::clock::to_time_t(ezt::clock::from_time_t(1530000000)) == 1530000000);
+		ezt::clock::time_point t = ezt::clock::from_time_t(1530000000) + std::chrono::milliseconds(999);
+		CHECK(ezt::clock::to_time_t(t) == 1530000000);
+		t += std::chrono::hours(24 * 365 * 100);
+		CHECK(ezt::clock::to_time_t(t) == 1530000000 + 3153600000LL);
+		CHECK(UTC.dateTime(ezt::clock::to_time_t(ezt::clock::from_time_t(0) + std::chrono::hours(36)), UTC_TIME, "Y-m-d H:i") == "1970-01-02 12:00");
+		#ifdef EZTIME_64BIT_TIME
+			ezt::clock::time_point before = ezt::clock::from_time_t(0) - std::chrono::milliseconds(1);
+			CHECK(ezt::clock::to_time_t(before) == -1);
+			CHECK(UTC.dateTime(ezt::clock::to_time_t(before), UTC_TIME, "Y-m-d H:i:s") == "1969-12-31 23:59:59");
+			CHECK(UTC.dateTime(ezt::clock::to_time_t(ezt::clock::from_time_t(0) - std::chrono::hours(24 * 36524)), UTC_TIME, "Y-m-d") == "1870-01-01");
+		#endif
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	reading();
+	conversions();
+	if (failures) return 1;
+	printf("All chrono clock checks passed\n");
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * iso_week_test - dayOfYear(), weekISO() and yearISO(), and the 'z', 'W' and 'X' letters of
+ * dateTime(), against the host's C library (strftime's %j, %V and %G) for every day from 1970
+ * to 2105, and in a timezone around New Year, where the local date is not the UTC one.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <time.h>
+
+namespace {
+
+	// What the C library says, for a time in UTC
+	void expected(const time_t t, int &yday, int &week, int &iso_year) {
+		struct tm tm;
+		gmtime_r(&t, &tm);
+		char text[32];
+		strftime(text, sizeof(text), "%j %V %G", &tm);
+		sscanf(text, "%d %d %d", &yday, &week, &iso_year);
+		yday--;		// %j counts from 1
+	}
+
+	// Returns false after the first wrong day, so one mistake does not flood the output
+	bool check(Timezone &tz, const time_t local) {
+		int yday, week, iso_year;
+		expected(local, yday, week, iso_year);
+		char want[32];
+		snprintf(want, sizeof(want), "%d %02d %d", yday, week, iso_year);
+		String got = tz.dateTime(local, "z W X");
+		if (tz.dayOfYear(local) != yday || tz.weekISO(local) != week || tz.yearISO(local) != iso_year || got != want) {
+			fprintf(stderr, "%ld: %d %d %d and \"%s\", not %s\n", (long)local, tz.dayOfYear(local), tz.weekISO(local), tz.yearISO(local), got.c_str(), want);
+			failures++;
+			return false;
+		}
+		return true;
+	}
+
+	void everyDay() {
+		int days = 0;
+		for (time_t t = 0; t < 4291747200LL; t += SECS_PER_DAY) {		// up to 2106-01-01
+			if (!check(UTC, t) || !check(UTC, t + SECS_PER_DAY - 1)) return;
+			days++;
+		}
+		printf("%d days checked\n", days);
+	}
+
+	// Late on Dec 31st in UTC is already January in Tokyo, and the functions given UTC time
+	// must say what the local date is
+	void newYear() {
+		Timezone tokyo;
+		tokyo.setPosix("JST-9");
+		const time_t eve = 1577833200;		// 2019-12-31 23:00 UTC, 2020-01-01 08:00 JST
+		CHECK(tokyo.dayOfYear(eve, UTC_TIME) == 0);
+		CHECK(tokyo.weekISO(eve, UTC_TIME) == 1 && tokyo.yearISO(eve, UTC_TIME) == 2020);
+		CHECK(UTC.dayOfYear(eve) == 364);
+		CHECK(tokyo.dateTime(eve, UTC_TIME, "z W X") == "0 01 2020");
+		// 2021-01-01 08:00 JST, a Friday: still week 53 of 2020
+		const time_t later = 1609484400 - 9 * 3600 + 8 * 3600;
+		CHECK(tokyo.dateTime(later, UTC_TIME, "Y-m-d z W X") == "2021-01-01 0 53 2020");
+		CHECK(tokyo.dateTime(later, UTC_TIME, ISO8601_YWD) == "2020-W53-5");
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	everyDay();
+	newYear();
+	if (failures) return 1;
+	printf("All ISO week checks passed\n");
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * local_times_test - ezt::localTimes() against dateTime() one zone at a time, for every zone in
+ * the compiled-in database, at instants around midnight, month and year ends and leap days,
+ * where moving the shared UTC breakdown has to carry into the date.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+#include <ezTimeDB.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+	const char *FORMAT = "D Y-m-d H:i:s T O N";
+	const uint8_t BATCH = 200;
+
+	Timezone zones[TZDB_ZONES];
+	Timezone *pointers[TZDB_ZONES];
+	ezLocalTime_t times[TZDB_ZONES];
+
+	// Each zone one at a time, the slow way, must say the same as the batch
+	void compare(const time_t t) {
+		for (int first = 0; first < TZDB_ZONES; first += BATCH) {
+			uint8_t count = (TZDB_ZONES - first < BATCH) ? TZDB_ZONES - first : BATCH;
+			CHECK(localTimes(pointers + first, times + first, count, t) == t);
+		}
+		for (int n = 0; n < TZDB_ZONES; n++) {
+			char expected[64], got[64];
+			zones[n].dateTime(expected, sizeof(expected), t, UTC_TIME, FORMAT);
+			zones[n].dateTime(got, sizeof(got), times[n], FORMAT);
+			if (strcmp(expected, got)) {
+				fprintf(stderr, "%s at %ld: %s, not %s\n", _tzdb_names + _tzdb_index[n][0], (long)t, got, expected);
+				failures++;
+			}
+			CHECK(times[n].local == zones[n].tzTime(t, UTC_TIME));
+			CHECK(times[n].offset == zones[n].getOffset(t, UTC_TIME));
+		}
+	}
+
+	void everyZone() {
+		for (int n = 0; n < TZDB_ZONES; n++) {
+			CHECK(zones[n].setPosix(_tzdb_rules + _tzdb_index[n][1]));
+			pointers[n] = &zones[n];
+		}
+		const time_t instants[] = {
+			1546300800,			// 2019-01-01 00:00
+			1577836799,			// 2019-12-31 23:59:59
+			1582934400,			// 2020-02-29 00:00
+			1583020800,			// 2020-03-01 00:00
+			1551398400,			// 2019-03-01 00:00, after a February without the 29th
+			1530000000,			// 2018-06-26 08:00
+			1604188800,			// 2020-11-01 00:00
+			1656633600			// 2022-07-01 00:00
+		};
+		for (const time_t t : instants) {
+			for (int hour = -14; hour <= 14; hour++) compare(t + hour * 3600 + 1800);
+		}
+		// And three years at an uneven step
+		for (time_t t = 1514764800; t < 1609459200; t += 86400 * 13 + 3917) compare(t);
+		// The first and last hours of time_t, where zones west of UTC are still in 1969 and
+		// (without EZTIME_64BIT_TIME) zones east of it already past 2106, back in 1970
+		for (int hour = 0; hour <= 14; hour++) {
+			compare(hour * 3600 + 1800);
+			compare((time_t)0xFFFFFFFFUL - hour * 3600 - 1800);
+		}
+	}
+
+	// TIME_NOW reads the clock once: every zone gets the same second
+	void sameSecond() {
+		Timezone berlin, tokyo;
+		berlin.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		tokyo.setPosix("JST-9");
+		Timezone *clock[] = { &berlin, &tokyo, &UTC };
+		ezLocalTime_t now[3];
+		time_t t = localTimes(clock, now, 3);
+		CHECK(t == UTC.now());
+		CHECK(now[0].local == t + 7200 && now[1].local == t + 9 * 3600 && now[2].local == t);
+		CHECK(now[0].is_dst && !now[1].is_dst);
+		CHECK(!strcmp(now[1].tzname, "JST"));
+		CHECK(tokyo.dateTime(now[1], "H:i T") == "17:00 JST");
+		CHECK(berlin.dateTime(now[0], RFC850) == berlin.dateTime(t, UTC_TIME, RFC850));
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	everyZone();
+	sameSecond();
+	if (failures) return 1;
+	printf("All localTimes checks passed\n");
+	return 0;
+}
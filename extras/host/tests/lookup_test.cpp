@@ -0,0 +1,235 @@
+/*
+ * lookup_test - setLocation() and setLocations() against the stand-in timezone server,
+ * so no network is needed.
+ *
+ *   lookup_test [directory with posixinfo and zone1970.tab]
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "tzserver.h"
+#include "check.h"
+
+#include <functional>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+	void checkAnswers(const tzserver_t &server) {
+		CHECK(answerQuery(server, "DE") == "OK Europe/Berlin CET-1CEST,M3.5.0,M10.5.0/3");
+		CHECK(answerQuery(server, "uk") == "OK Europe/London GMT0BST,M3.5.0/1,M10.5.0");
+		CHECK(answerQuery(server, "US") == "ERROR Country Spans Multiple Timezones");
+		CHECK(answerQuery(server, "NL") == "ERROR Country Not Found");
+		CHECK(answerQuery(server, "new york") == "OK America/New_York EST5EDT,M3.2.0,M11.1.0");
+		CHECK(answerQuery(server, "Dublin") == "OK Europe/Dublin GMT0IST,M3.5.0/1,M10.5.0");
+		CHECK(answerQuery(server, "Atlantis") == "ERROR Timezone Not Found");
+		CHECK(answerQuery(server, "GeoIP") == "ERROR GeoIP Lookup Failed");
+	}
+
+	bool sameRule(const ezRule_t &a, const ezRule_t &b) {
+		return a.std_offset == b.std_offset && a.dst_offset == b.dst_offset &&
+			a.start_month == b.start_month && a.start_week == b.start_week && a.start_dow == b.start_dow && a.start_time == b.start_time &&
+			a.end_month == b.end_month && a.end_week == b.end_week && a.end_dow == b.end_dow && a.end_time == b.end_time &&
+			!strcmp(a.std_name, b.std_name) && !strcmp(a.dst_name, b.dst_name);
+	}
+
+	// A rule that came in binary must be the same as the one parsed from the text answer
+	bool sameAsText(Timezone &tz, const tzserver_t &server, const char *location) {
+		std::string olson, posix;
+		Timezone parsed;
+		lookupQuery(server, location, olson, posix);
+		parsed.setPosix(posix.c_str());
+		return tz.getPosix() == parsed.getPosix() && sameRule(tz.getRule(), parsed.getRule());
+	}
+
+	// The indexes must pick the same zone as scanning them all like server/server does, for
+	// whole names and for all sorts of bits of them.
+	void checkIndex(tzserver_t &server) {
+		std::vector<std::string> queries = { "", "nope", "GeoIP", "de", "Europe/", "/", "_" };
+		for (const zoneinfo_t &zone : server.zones) {
+			queries.push_back(zone.olson);
+			for (size_t len : { 1, 2, 3, 5, 8 }) {
+				for (size_t pos = 0; pos + len <= zone.olson.size(); pos += 3) queries.push_back(zone.olson.substr(pos, len));
+			}
+		}
+		size_t mismatches = 0;
+		for (const std::string &query : queries) {
+			server.indexed = true;
+			std::string indexed = answerQuery(server, query);
+			server.indexed = false;
+			std::string linear = answerQuery(server, query);
+			if (indexed != linear && !mismatches++) fprintf(stderr, "'%s': %s, scanning gives %s\n", query.c_str(), indexed.c_str(), linear.c_str());
+		}
+		server.indexed = true;
+		CHECK(mismatches == 0);
+	}
+
+	// One packet, every location answered, even with flood protection on
+	void checkBatch(const tzserver_t &server) {
+		const String locations[] = { "UK", "kolkata", "US", "Atlantis", "Dublin", "Chatham" };
+		Timezone zones[6];
+		Timezone *pointers[6];
+		for (int n = 0; n < 6; n++) pointers[n] = &zones[n];
+		CHECK(!setLocations(pointers, locations, 6));			// not all of them were found
+		CHECK(zones[0].lookupStatus() == LOOKUP_OK && zones[0].getOlson() == "Europe/London");
+		CHECK(zones[1].lookupStatus() == LOOKUP_OK && zones[1].getPosix() == "IST-5:30");
+		CHECK(zones[2].lookupStatus() == LOOKUP_FAILED);
+		CHECK(zones[3].lookupStatus() == LOOKUP_FAILED);
+		CHECK(zones[4].lookupStatus() == LOOKUP_OK && zones[4].getPosix() == "GMT0IST,M3.5.0/1,M10.5.0");
+		CHECK(zones[4].getOffset(1530000000, UTC_TIME) == -60);
+		CHECK(zones[5].lookupStatus() == LOOKUP_OK && zones[5].getPosix() == "<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45");
+		CHECK(zones[5].getTimezoneName(1530000000, UTC_TIME) == "+1245");
+		for (int n : { 0, 1, 4, 5 }) CHECK(sameAsText(zones[n], server, locations[n].c_str()));
+	}
+
+	// Every zone on this machine, ten at a time, in binary. The POSIX string made from a binary
+	// rule does not always read the same as the original ("/2" is left out), the rule must match.
+	// This server has no flood protection, so the clock skips the gap setLocations() leaves.
+	void checkAllZones(const tzserver_t &server) {
+		size_t mismatches = 0;
+		for (size_t first = 0; first < server.zones.size(); first += MAX_LOOKUPS) {
+			uint8_t count = server.zones.size() - first < MAX_LOOKUPS ? server.zones.size() - first : MAX_LOOKUPS;
+			Timezone zones[MAX_LOOKUPS];
+			Timezone *pointers[MAX_LOOKUPS];
+			String locations[MAX_LOOKUPS];
+			for (uint8_t n = 0; n < count; n++) {
+				pointers[n] = &zones[n];
+				locations[n] = server.zones[first + n].olson.c_str();
+			}
+			host::skipMillis(TIMEZONED_MIN_GAP);
+			setLocations(pointers, locations, count);
+			for (uint8_t n = 0; n < count; n++) {
+				std::string olson, posix;
+				Timezone parsed;
+				lookupQuery(server, locations[n].c_str(), olson, posix);
+				parsed.setPosix(posix.c_str());
+				Timezone reparsed;
+				reparsed.setPosix(zones[n].getPosix());
+				if (zones[n].lookupStatus() != LOOKUP_OK || zones[n].getOlson() != olson.c_str() ||
+				    !sameRule(zones[n].getRule(), parsed.getRule()) || !sameRule(reparsed.getRule(), parsed.getRule())) {
+					if (!mismatches++) fprintf(stderr, "%s: %s came back as %s\n", olson.c_str(), posix.c_str(), zones[n].getPosix().c_str());
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+
+	// The server drops a second packet from us within 3 seconds of the first (by its own clock,
+	// so this takes real time). setLocation() right after the batch waits TIMEZONED_MIN_GAP
+	// instead of being dropped, a background lookup waits for it in turn, and setLocation()
+	// waits for a background lookup that is out to come back before it asks.
+	void checkLookupGap() {
+		Timezone berlin, dublin, chatham;
+		CHECK(berlin.setLocation("Europe/Berlin"));		// the server would have dropped it without the wait
+		uint32_t started = millis();
+		CHECK(dublin.setLocationAsync("Dublin"));
+		while (millis() - started < TIMEZONED_MIN_GAP) delay(1);
+		events();
+		CHECK(dublin.lookupStatus() == LOOKUP_PENDING);		// asked just now, by events()
+		CHECK(chatham.setLocation("Chatham"));
+		CHECK(dublin.lookupStatus() == LOOKUP_OK && dublin.getOlson() == "Europe/Dublin");
+		CHECK(millis() - started >= 2 * TIMEZONED_MIN_GAP);
+		CHECK(chatham.getOffset(1530000000, UTC_TIME) == -765);
+	}
+
+	// A server without batches sends one error for the lot, after which they are looked up
+	// one by one in the background, TIMEZONED_MIN_GAP apart.
+	void checkOldServer() {
+		const String locations[] = { "Berlin", "Chatham", "Atlantis" };
+		Timezone zones[3];
+		Timezone *pointers[3];
+		for (int n = 0; n < 3; n++) pointers[n] = &zones[n];
+		CHECK(!setLocations(pointers, locations, 3));
+		for (int n = 0; n < 3; n++) CHECK(zones[n].lookupStatus() == LOOKUP_PENDING);
+		host::setMillis(millis());
+		uint32_t started = millis();
+		for (int n = 0; n < 5000 && zones[2].lookupStatus() == LOOKUP_PENDING; n++) {
+			host::advanceMillis(10);
+			events();
+			usleep(200);
+		}
+		CHECK(millis() - started >= 3 * TIMEZONED_MIN_GAP);
+		CHECK(zones[0].lookupStatus() == LOOKUP_OK && zones[0].getOlson() == "Europe/Berlin");
+		CHECK(zones[1].lookupStatus() == LOOKUP_OK && zones[1].getOffset(1530000000, UTC_TIME) == -765);
+		CHECK(zones[2].lookupStatus() == LOOKUP_FAILED);
+		host::useRealMillis();
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	std::string data = argc > 1 ? argv[1] : "data";
+	// The real thing, one that only answers in text, and one from before batches
+	tzserver_t server, text_server, old_server;
+	text_server.binary = false;
+	text_server.flood_protection = false;
+	old_server.batches = false;
+	old_server.flood_protection = false;
+	if (!loadTzserver(data + "/posixinfo", data + "/zone1970.tab", server) ||
+	    !loadTzserver(data + "/posixinfo", data + "/zone1970.tab", text_server) ||
+	    !loadTzserver(data + "/posixinfo", data + "/zone1970.tab", old_server)) {
+		fprintf(stderr, "No zones in %s\n", data.c_str());
+		return 2;
+	}
+	uint16_t port, text_port, old_port;
+	int fd = openTzserver(0, port);
+	int text_fd = openTzserver(0, text_port);
+	int old_fd = openTzserver(0, old_port);
+	if (fd < 0 || text_fd < 0 || old_fd < 0) {
+		fprintf(stderr, "Cannot open a UDP port\n");
+		return 2;
+	}
+	checkIndex(server);
+	std::atomic<bool> stop(false);
+	std::thread thread(serveTzserver, std::ref(server), fd, std::cref(stop), false, 1u);
+	std::thread text_thread(serveTzserver, std::ref(text_server), text_fd, std::cref(stop), false, 1u);
+	std::thread old_thread(serveTzserver, std::ref(old_server), old_fd, std::cref(stop), false, 1u);
+
+	setDebug(NONE);
+	setInterval(0);
+	events();
+
+	checkAnswers(server);
+	setTimezoneServer("127.0.0.1", port);
+	checkBatch(server);
+	checkLookupGap();
+	setTimezoneServer("127.0.0.1", text_port);
+	checkBatch(text_server);
+
+	tzserver_t all_server;
+	all_server.flood_protection = false;
+	if (loadTzserver(ZONEINFO_DIR, "", all_server)) {
+		checkIndex(all_server);
+		uint16_t all_port;
+		int all_fd = openTzserver(0, all_port);
+		std::atomic<bool> all_stop(false);
+		std::thread all_thread(serveTzserver, std::ref(all_server), all_fd, std::cref(all_stop), false, 1u);
+		setTimezoneServer("127.0.0.1", all_port);
+		checkAllZones(all_server);
+		all_stop = true;
+		all_thread.join();
+		CHECK(all_server.packets == (all_server.zones.size() + MAX_LOOKUPS - 1) / MAX_LOOKUPS);
+	}
+	setTimezoneServer("127.0.0.1", old_port);
+	checkOldServer();
+
+	stop = true;
+	thread.join();
+	text_thread.join();
+	old_thread.join();
+	CHECK(server.packets == 4 && server.dropped == 0);
+	CHECK(old_server.packets == 4);
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All lookup checks passed\n");
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * ntp_listen_test - listenNTP() taking the time from NTP broadcasts sent to a localhost port.
+ * The NTP server that measures the delay is answered in-process (host::setUdpResponder), and
+ * millis() is simulated: the broadcasts say what the time was 7 ms before they are read.
+ *
+ *   ntp_listen_test [port]
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+	const uint32_t EPOCH = 1600000000UL;		// the real time at millis() 0
+	const uint32_t ONE_WAY = 7;					// milliseconds a broadcast takes
+
+	unsigned long unicast = 0;					// requests the NTP server got
+
+	void putTimestamp(uint8_t *p, const uint32_t ms) {
+		uint32_t secs = EPOCH + ms / 1000 + 2208988800UL;
+		uint32_t fraction = (ms % 1000) * 4294967UL + (ms % 1000) * 296 / 1000;
+		for (int n = 0; n < 4; n++) p[n] = secs >> (24 - 8 * n);
+		for (int n = 0; n < 4; n++) p[4 + n] = fraction >> (24 - 8 * n);
+	}
+
+	size_t server(const uint32_t, const uint8_t *, const size_t len, uint8_t *reply, const size_t max_len) {
+		if (len != NTP_PACKET_SIZE || max_len < NTP_PACKET_SIZE) return 0;
+		unicast++;
+		memset(reply, 0, NTP_PACKET_SIZE);
+		reply[0] = 0x24;
+		reply[1] = 1;
+		putTimestamp(reply + 16, millis() - 10000);
+		putTimestamp(reply + 32, millis());
+		putTimestamp(reply + 40, millis());
+		return NTP_PACKET_SIZE;
+	}
+
+	int broadcaster = -1;
+	struct sockaddr_in listener;
+
+	void broadcast(const uint8_t first_byte = 0x25, const uint8_t stratum = 2) {
+		uint8_t packet[NTP_PACKET_SIZE];
+		memset(packet, 0, sizeof(packet));
+		packet[0] = first_byte;
+		packet[1] = stratum;
+		putTimestamp(packet + 16, millis() - ONE_WAY - 1000);
+		putTimestamp(packet + 40, millis() - ONE_WAY);
+		sendto(broadcaster, packet, sizeof(packet), 0, (struct sockaddr *)&listener, sizeof(listener));
+		usleep(5000);
+		events();
+	}
+
+	// ezTime's idea of the time now, against the real time, in milliseconds
+	int32_t clockError() {
+		uint32_t real = millis();
+		return (int32_t)(UTC.now() - EPOCH - real / 1000) * 1000 + (int32_t)UTC.ms(LAST_READ) - (int32_t)(real % 1000);
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	uint16_t port = argc > 1 ? atoi(argv[1]) : 21124;
+	setDebug(NONE);
+	host::setMillis(3000);
+	host::setUdpResponder(123, server);
+	host::addHost(NTP_SERVER, "10.0.0.9");
+
+	broadcaster = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&listener, 0, sizeof(listener));
+	listener.sin_family = AF_INET;
+	listener.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	listener.sin_port = htons(port);
+	CHECK(broadcaster >= 0);
+	CHECK(listenNTP(port));
+	events();									// the normal update at boot
+	CHECK(timeStatus() == timeSet && unicast == 1);
+
+	// The first broadcast has its delay measured against the server
+	host::advanceMillis(64000);
+	broadcast();
+	CHECK(unicast == 2);
+	CHECK(clockError() == 0);
+
+	// Eight hours of broadcasts every 64 seconds keep the time right, with just one more
+	// measurement after NTP_CALIBRATE_INTERVAL
+	int32_t worst = 0;
+	for (int n = 0; n < 8 * 3600 / 64; n++) {
+		host::advanceMillis(64000);
+		events();
+		broadcast();
+		int32_t e = clockError();
+		if (abs(e) > worst) worst = abs(e);
+	}
+	printf("%d broadcasts, %lu NTP requests, worst error %d ms\n", 8 * 3600 / 64 + 1, unicast, worst);
+	CHECK(unicast == 3);
+	CHECK(worst <= 1);
+
+	// Not broadcasts: from a client, from a server to a client, unsynchronised, stratum 0
+	uint32_t synced = lastNtpUpdateTime();
+	host::advanceMillis(5000);
+	broadcast(0x23);
+	broadcast(0x24);
+	broadcast(0xE5);
+	broadcast(0x25, 0);
+	CHECK(lastNtpUpdateTime() == synced);
+
+	// No more broadcasts: back to asking the server
+	listenNTP(0);
+	host::advanceMillis(64000);
+	broadcast();
+	CHECK(lastNtpUpdateTime() == synced);
+	unsigned long before = unicast;
+	for (int n = 0; n < 2 * NTP_INTERVAL; n++) {
+		host::advanceMillis(1000);
+		events();
+	}
+	CHECK(unicast >= before + 1);
+	CHECK(timeStatus() == timeSet);
+
+	close(broadcaster);
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All NTP broadcast checks passed\n");
+	return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * ntp_responder.h - an NTP server answered in-process, for the tests that fork() a "boot" per
+ * case and simulate millis(). Install it with host::setUdpResponder(server). The real time is
+ * base_ms + millis(), with millis() running fast_ppm fast if the test sets that.
+ */
+
+#ifndef _NTP_RESPONDER_H_
+#define _NTP_RESPONDER_H_
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include <string.h>
+
+namespace {
+
+	const uint64_t START_MS = 1600000000000ULL;	// the real time at millis() 0 in the first boot
+
+	uint64_t base_ms = START_MS;
+	uint32_t fast_ppm = 0;
+	unsigned long requests = 0;
+
+	uint64_t realMs() { return base_ms + millis() - (uint64_t)millis() * fast_ppm / 1000000; }
+
+	size_t server(const uint32_t, const uint8_t *, const size_t len, uint8_t *reply, const size_t max_len) {
+		if (len != NTP_PACKET_SIZE || max_len < NTP_PACKET_SIZE) return 0;
+		requests++;
+		uint64_t ms = realMs();
+		uint32_t secs = ms / 1000 + 2208988800ULL;
+		uint32_t fraction = (ms % 1000) * 4294967UL;
+		memset(reply, 0, NTP_PACKET_SIZE);
+		reply[0] = 0x24;
+		reply[1] = 1;
+		for (int n = 0; n < 4; n++) {
+			reply[16 + n] = reply[32 + n] = reply[40 + n] = secs >> (24 - 8 * n);
+			reply[44 + n] = fraction >> (24 - 8 * n);
+		}
+		return NTP_PACKET_SIZE;
+	}
+
+	// ezTime's time now minus the real time, in milliseconds
+	int64_t clockError() {
+		time_t t = UTC.now();
+		return (int64_t)t * 1000 + UTC.ms(LAST_READ) - (int64_t)realMs();
+	}
+
+	ezPpsSource *pps = NULL;					// given an edge every second, if set
+
+	void run(const uint32_t seconds) {
+		for (uint32_t n = 0; n < seconds; n++) {
+			host::advanceMillis(1000);
+			if (pps) pps->edge();
+			events();
+		}
+	}
+
+}
+
+#endif // _NTP_RESPONDER_H_
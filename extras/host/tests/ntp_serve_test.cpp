@@ -0,0 +1,142 @@
+/*
+ * ntp_serve_test - serveNTP() answering SNTP requests from events(), on a real UDP port on
+ * localhost. ezTime's own upstream server is answered in-process (host::setUdpResponder), and
+ * millis() is simulated so the timestamps in the answers can be checked exactly.
+ *
+ *   ntp_serve_test [port]
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+	const uint32_t NTP_EPOCH = 1600000000UL + 2208988800UL;		// upstream's time at millis() 0
+
+	uint32_t get32(const uint8_t *p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+
+	void put32(uint8_t *p, const uint32_t value) {
+		for (int n = 0; n < 4; n++) p[n] = value >> (24 - 8 * n);
+	}
+
+	// Stratum 2 upstream, 10 ms root delay, 20 ms root dispersion, exactly on the second
+	size_t upstream(const uint32_t, const uint8_t *, const size_t len, uint8_t *reply, const size_t max_len) {
+		if (len != NTP_PACKET_SIZE || max_len < NTP_PACKET_SIZE) return 0;
+		memset(reply, 0, NTP_PACKET_SIZE);
+		reply[0] = 0x24;
+		reply[1] = 2;
+		put32(reply + 4, 655);
+		put32(reply + 8, 1311);
+		memcpy(reply + 12, "GPS\0", 4);
+		uint32_t secs = NTP_EPOCH + millis() / 1000;
+		put32(reply + 16, secs - 60);
+		put32(reply + 32, secs);
+		put32(reply + 40, secs);
+		return NTP_PACKET_SIZE;
+	}
+
+	int client = -1;
+	struct sockaddr_in server;
+
+	void sendRequest(const uint8_t first_byte, const uint32_t transmit, const size_t len = NTP_PACKET_SIZE) {
+		uint8_t packet[NTP_PACKET_SIZE];
+		memset(packet, 0, sizeof(packet));
+		packet[0] = first_byte;
+		packet[2] = 6;
+		put32(packet + 40, transmit);
+		put32(packet + 44, 0x12345678);
+		sendto(client, packet, len, 0, (struct sockaddr *)&server, sizeof(server));
+	}
+
+	// Runs events() for up to 50 ms of real time, returns the size of the answer that came back
+	ssize_t answer(uint8_t *reply) {
+		for (int n = 0; n < 50; n++) {
+			events();
+			ssize_t len = recv(client, reply, NTP_PACKET_SIZE + 16, MSG_DONTWAIT);
+			if (len > 0) return len;
+			usleep(1000);
+		}
+		return 0;
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	uint16_t port = argc > 1 ? atoi(argv[1]) : 21123;
+	setDebug(NONE);
+	host::setMillis(0);
+	host::setUdpResponder(123, upstream);
+	host::addHost(NTP_SERVER, "10.0.0.7");
+	setInterval(0);
+
+	client = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	server.sin_port = htons(port);
+	CHECK(client >= 0);
+	CHECK(serveNTP(port));
+	uint8_t reply[NTP_PACKET_SIZE + 16];
+
+	// Not in sync: no answer
+	sendRequest(0x23, 1);
+	CHECK(answer(reply) == 0);
+
+	host::setMillis(5000);
+	updateNTP();
+	CHECK(timeStatus() == timeSet);
+	host::advanceMillis(2250);
+
+	// Version 3 client: version 3 server answer, stratum 3, upstream as reference
+	sendRequest(0x1B, 0xDEADBEEF);
+	CHECK(answer(reply) == NTP_PACKET_SIZE);
+	CHECK(reply[0] == 0x1C);
+	CHECK(reply[1] == 3);
+	CHECK(reply[2] == 6);
+	CHECK(get32(reply + 4) >= 655 && get32(reply + 4) < 655 + 100);	// plus our round trip
+	CHECK(get32(reply + 8) == 1311 + 2);								// plus 2 seconds of drift
+	CHECK(reply[12] == 10 && reply[13] == 0 && reply[14] == 0 && reply[15] == 7);
+	CHECK(get32(reply + 24) == 0xDEADBEEF && get32(reply + 28) == 0x12345678);
+	uint32_t now = NTP_EPOCH + 7;										// 7.250 seconds in
+	CHECK(get32(reply + 16) == NTP_EPOCH + 5);
+	CHECK(get32(reply + 32) == now && get32(reply + 40) == now);
+	CHECK(get32(reply + 36) / 4294967UL == 250 && get32(reply + 44) / 4294967UL == 250);
+
+	// Several at once are all answered by one events()
+	for (int n = 0; n < 3; n++) sendRequest(0x23, n);
+	usleep(10000);
+	events();
+	int answers = 0;
+	while (recv(client, reply, sizeof(reply), MSG_DONTWAIT) == NTP_PACKET_SIZE) answers++;
+	CHECK(answers == 3);
+
+	// Not requests: answers from servers, short packets
+	sendRequest(0x24, 1);
+	CHECK(answer(reply) == 0);
+	sendRequest(0x23, 1, 20);
+	CHECK(answer(reply) == 0);
+
+	// Stopped
+	CHECK(serveNTP(0));
+	sendRequest(0x23, 1);
+	CHECK(answer(reply) == 0);
+
+	close(client);
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All NTP server checks passed\n");
+	return 0;
+}
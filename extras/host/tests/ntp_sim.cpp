@@ -0,0 +1,315 @@
+/*
+ * ntp_sim - a fleet of devices doing ezTime's NTP updates, to see how hard they hit the server.
+ *
+ *   ntp_sim [devices] [hours]
+ *
+ * Every device is a fork() of this process, so each has its own ezTime. They all run on a
+ * simulated millis() and their NTP packets are answered in-process (host::setUdpResponder),
+ * so hours go by in seconds and nothing is sent anywhere. The devices are switched on within
+ * the same two seconds, as after a power cut, and two hours in the server stops answering for
+ * an hour. Prints the requests the server sees per five minutes and checks that they spread
+ * out, that the outage is not hammered, and that a single device obeys kiss-o'-death replies
+ * and does not look up the server's name for every request.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+	const uint32_t EPOCH = 1600000000;			// UTC when the power comes back
+	const uint32_t OUTAGE_START = 2 * 3600;
+	const uint32_t OUTAGE_END = 3 * 3600;
+	const uint32_t BUCKET = 300;
+
+	typedef enum { ANSWER, SILENT, RATE, DENY } serverMode_t;
+
+	// State of the simulated server, per process
+	serverMode_t mode = ANSWER;
+	uint32_t boot_ms = 0;						// when this device was switched on
+	bool fleet = true;							// server goes away during the outage
+	int report_fd = -1;
+	std::vector<uint32_t> requests;				// seconds since the power came back
+	std::vector<uint32_t> destinations;			// addresses they were sent to
+
+	struct request_t {
+		uint16_t device;
+		uint32_t second;
+	};
+	uint16_t device = 0;
+
+	uint32_t simSeconds() { return (boot_ms + millis()) / 1000; }
+
+	void putTimestamp(uint8_t *p, const uint32_t ms) {
+		uint32_t secs = EPOCH + ms / 1000 + 2208988800UL;
+		uint32_t fraction = (uint32_t)((ms % 1000) * 4294967.296);
+		for (int n = 0; n < 4; n++) p[n] = secs >> (24 - 8 * n);
+		for (int n = 0; n < 4; n++) p[4 + n] = fraction >> (24 - 8 * n);
+	}
+
+	size_t answerNTP(const uint32_t to, const uint8_t *, const size_t len, uint8_t *reply, const size_t max_len) {
+		uint32_t now = simSeconds();
+		if (report_fd >= 0) {
+			request_t r = { device, now };
+			if (write(report_fd, &r, sizeof(r)) != sizeof(r)) exit(2);
+		} else {
+			requests.push_back(now);
+			destinations.push_back(to);
+		}
+		if (len != NTP_PACKET_SIZE || max_len < NTP_PACKET_SIZE) return 0;
+		if (mode == SILENT || (fleet && now >= OUTAGE_START && now < OUTAGE_END)) return 0;
+		host::advanceMillis(random(5, 80));		// network delay, different for every packet
+		memset(reply, 0, NTP_PACKET_SIZE);
+		reply[0] = 0x24;						// version 4, server
+		if (mode == RATE || mode == DENY) {
+			memcpy(reply + 12, mode == RATE ? "RATE" : "DENY", 4);
+			return NTP_PACKET_SIZE;
+		}
+		reply[1] = 2;
+		uint32_t ms = boot_ms + millis();
+		putTimestamp(reply + 16, ms - 30000);
+		putTimestamp(reply + 32, ms);
+		putTimestamp(reply + 40, ms);
+		return NTP_PACKET_SIZE;
+	}
+
+	// One device, until 'seconds' after the power came back
+	void runDevice(const uint32_t seconds) {
+		host::setMillis(0);
+		while (simSeconds() < seconds) {
+			events();
+			host::advanceMillis(1000);
+		}
+	}
+
+	void histogram(const std::vector<request_t> &all, const uint32_t seconds, const unsigned devices) {
+		std::vector<unsigned> buckets((seconds + BUCKET - 1) / BUCKET);
+		for (const request_t &r : all) if (r.second / BUCKET < buckets.size()) buckets[r.second / BUCKET]++;
+		unsigned most = *std::max_element(buckets.begin(), buckets.end());
+		printf("Requests per %u minutes from %u devices switched on together (fixed schedule: all %u in one bucket every %u minutes)\n",
+			BUCKET / 60, devices, devices, NTP_INTERVAL / 60);
+		for (size_t n = 0; n < buckets.size(); n++) {
+			unsigned bar = most ? (buckets[n] * 60 + most - 1) / most : 0;
+			printf("%2zu:%02zu %5u %s%s\n", n * BUCKET / 3600, n * BUCKET % 3600 / 60, buckets[n], std::string(bar, '#').c_str(),
+				(n * BUCKET >= OUTAGE_START && n * BUCKET < OUTAGE_END) ? "  (server down)" : "");
+		}
+	}
+
+	void checkFleet(const unsigned devices, const uint32_t seconds) {
+		int fds[2];
+		if (pipe(fds) < 0) {
+			perror("pipe");
+			exit(2);
+		}
+		std::vector<pid_t> children;
+		for (unsigned n = 0; n < devices; n++) {
+			uint32_t boot = random(0, 2000);
+			pid_t pid = fork();
+			if (pid < 0) {
+				perror("fork");
+				exit(2);
+			}
+			if (!pid) {
+				close(fds[0]);
+				report_fd = fds[1];
+				device = n;
+				boot_ms = boot;
+				randomSeed(n + 1);
+				runDevice(seconds);
+				_exit(0);
+			}
+			children.push_back(pid);
+		}
+		close(fds[1]);
+		std::vector<request_t> all;
+		request_t r;
+		while (read(fds[0], &r, sizeof(r)) == sizeof(r)) all.push_back(r);
+		close(fds[0]);
+		for (pid_t pid : children) {
+			int status;
+			waitpid(pid, &status, 0);
+			CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+		}
+
+		histogram(all, seconds, devices);
+
+		// Per device: syncs at boot, asks the dead server only a handful of times, and is back soon after
+		std::vector<unsigned> during_outage(devices), first_sync(devices);
+		std::vector<uint32_t> back(devices, 0);
+		for (const request_t &r : all) {
+			if (r.second < 10) first_sync[r.device]++;
+			if (r.second >= OUTAGE_START && r.second < OUTAGE_END) during_outage[r.device]++;
+			if (r.second >= OUTAGE_END && !back[r.device]) back[r.device] = r.second;
+		}
+		unsigned most_in_outage = *std::max_element(during_outage.begin(), during_outage.end());
+		uint32_t last_back = *std::max_element(back.begin(), back.end());
+		printf("Most requests from one device while the server was down: %u (fixed %u s retry: %u)\n",
+			most_in_outage, NTP_RETRY, (OUTAGE_END - OUTAGE_START) / NTP_RETRY);
+		printf("Last device back in sync %u s after the server came back\n", last_back - OUTAGE_END);
+		CHECK(std::count(first_sync.begin(), first_sync.end(), 1u) == (long)devices);
+		CHECK(most_in_outage <= 10);
+		CHECK(std::find(back.begin(), back.end(), 0u) == back.end());
+		CHECK(last_back - OUTAGE_END <= NTP_RETRY_MAX * (100 + NTP_JITTER) / 100 + 1);
+
+		// Once the boot wave has had a few intervals to spread, no minute sees more than a few
+		// times the average (a fixed schedule puts every device in the same second)
+		std::vector<unsigned> minutes(seconds / 60);
+		for (const request_t &r : all) if (r.second >= OUTAGE_END + 3600 && r.second / 60 < minutes.size()) minutes[r.second / 60]++;
+		unsigned busiest = *std::max_element(minutes.begin(), minutes.end());
+		double average = devices * 60.0 / NTP_INTERVAL;
+		printf("Busiest minute from %u h on: %u requests (average %.1f)\n", (OUTAGE_END + 3600) / 3600, busiest, average);
+		CHECK(busiest <= average * 5 + 2);
+	}
+
+	// A device that is in sync, with requests recorded in 'requests' from now on
+	void syncedDevice(const String server = NTP_SERVER) {
+		mode = ANSWER;
+		setServer(server);
+		updateNTP();
+		CHECK(timeStatus() == timeSet);
+		requests.clear();
+		destinations.clear();
+	}
+
+	void runFor(const uint32_t seconds) {
+		uint32_t until = simSeconds() + seconds;
+		while (simSeconds() < until) {
+			events();
+			host::advanceMillis(1000);
+		}
+	}
+
+	// Waits between failed requests double, with jitter, until NTP_RETRY_MAX
+	void checkBackoff() {
+		syncedDevice();
+		mode = SILENT;
+		updateNTP();
+		runFor(3 * 3600);
+		CHECK(error() == TIMEOUT);
+		CHECK(requests.size() >= 8 && requests.size() <= 14);
+		uint32_t expected = NTP_RETRY;
+		for (size_t n = 1; n < requests.size(); n++) {
+			uint32_t gap = requests[n] - requests[n - 1];
+			CHECK(gap + 2 >= expected * (100 - NTP_JITTER) / 100 && gap <= expected * (100 + NTP_JITTER) / 100 + 2);
+			expected = expected * 2 < NTP_RETRY_MAX ? expected * 2 : NTP_RETRY_MAX;
+		}
+		// Success resets it
+		mode = ANSWER;
+		runFor(NTP_RETRY_MAX * 2);
+		CHECK(timeStatus() == timeSet);
+		requests.clear();
+		mode = SILENT;
+		runFor(NTP_INTERVAL * 2);
+		CHECK(requests.size() >= 2 && requests[1] - requests[0] <= NTP_RETRY * (100 + NTP_JITTER) / 100 + 2);
+		mode = ANSWER;
+	}
+
+	// "RATE" doubles the interval for every one, and it comes back down one step per good update
+	void checkRate() {
+		syncedDevice();
+		mode = RATE;
+		updateNTP();
+		CHECK(error() == NTP_RATE_LIMITED);
+		runFor(NTP_INTERVAL * 8);
+		CHECK(requests.size() == 3);			// now, then after 2x and 4x the interval
+		if (requests.size() == 3) {
+			CHECK(requests[1] - requests[0] >= 2 * NTP_INTERVAL * (100 - NTP_JITTER) / 100);
+			CHECK(requests[2] - requests[1] >= 4 * NTP_INTERVAL * (100 - NTP_JITTER) / 100);
+		}
+		mode = ANSWER;
+		requests.clear();
+		runFor(NTP_INTERVAL * 30);			// 8x is still pending, then 8x, 4x, 2x and 1x
+		CHECK(timeStatus() == timeSet);
+		CHECK(requests.size() >= 2);
+		if (requests.size() >= 2) {
+			uint32_t last_gap = requests.back() - requests[requests.size() - 2];
+			CHECK(last_gap <= NTP_INTERVAL * (100 + NTP_JITTER) / 100 + 2);
+		}
+	}
+
+	// "DENY" stops the updates until another server is set
+	void checkDeny() {
+		syncedDevice();
+		mode = DENY;
+		updateNTP();
+		CHECK(error() == NTP_DENIED);
+		runFor(NTP_INTERVAL * 4);
+		CHECK(requests.size() == 1);
+		mode = ANSWER;
+		setServer("time.example.com");
+		runFor(5);
+		CHECK(requests.size() == 2);
+		CHECK(timeStatus() == timeSet);
+	}
+
+	// The name is looked up once per NTP_DNS_TTL, not per request. A retry goes to the next
+	// address it knows without asking DNS, until they have all failed.
+	void checkDns() {
+		syncedDevice("pool.test");
+		unsigned long lookups = host::dns_lookups;
+		runFor(NTP_DNS_TTL * 6);
+		unsigned long normal_lookups = host::dns_lookups - lookups;
+		printf("%zu updates in %u hours, %lu DNS lookups\n", requests.size(), NTP_DNS_TTL * 6 / 3600, normal_lookups);
+		// A lookup is due every hour, and happens at the first update after that
+		CHECK(requests.size() >= 10 && normal_lookups >= 3 && normal_lookups <= 6);
+
+		// By now it has seen all three addresses of the pool
+		requests.clear();
+		destinations.clear();
+		lookups = host::dns_lookups;
+		mode = SILENT;
+		updateNTP();
+		runFor(3600);
+		unsigned long outage_lookups = host::dns_lookups - lookups;
+		printf("%zu requests to a dead server, %lu DNS lookups\n", requests.size(), outage_lookups);
+		CHECK(requests.size() >= 6);
+		CHECK(outage_lookups <= requests.size() / 3 + 1);
+		for (size_t n = 1; n < 3 && n < destinations.size(); n++) CHECK(destinations[n] != destinations[n - 1]);
+		mode = ANSWER;
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned devices = argc > 1 ? atoi(argv[1]) : 200;
+	uint32_t seconds = (argc > 2 ? atof(argv[2]) : 8) * 3600;
+	if (!devices || seconds < OUTAGE_END + 2 * 3600) {
+		fprintf(stderr, "usage: %s [devices] [hours, at least %u]\n", argv[0], OUTAGE_END / 3600 + 2);
+		return 2;
+	}
+	setDebug(NONE);
+	host::setUdpResponder(123, answerNTP);
+	for (const char *address : { "10.0.0.1", "10.0.0.2", "10.0.0.3", "10.0.0.4" }) host::addHost(NTP_SERVER, address);
+	for (const char *address : { "10.0.1.1", "10.0.1.2", "10.0.1.3" }) host::addHost("pool.test", address);
+	host::addHost("time.example.com", "10.0.2.1");
+	randomSeed(12345);
+	checkFleet(devices, seconds);
+
+	// The rest runs in this process, as one device that is never switched off
+	fleet = false;
+	host::setMillis(0);
+	events();
+	checkBackoff();
+	checkRate();
+	checkDeny();
+	checkDns();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("All NTP scheduling checks passed\n");
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * restore_test - saveTime() before a reset or deep sleep, restoreTime() after. Every "boot"
+ * is a fork() of this process, so it starts with a fresh ezTime, like a device does. The NTP
+ * server is answered in-process (host::setUdpResponder) and millis() is simulated, running
+ * 100 ppm fast before the reset.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+#include "ntp_responder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+	struct saved_t {
+		ezTimeState_t state;
+		uint64_t real_ms;						// when it was saved
+	};
+
+	// First boot: hours of NTP updates, then saving the time somewhere between two of them
+	void firstBoot(saved_t &saved) {
+		fast_ppm = 100;
+		host::setMillis(0);
+		events();
+		CHECK(timeStatus() == timeSet);
+		run(4 * 3600 + 600);
+		CHECK(saveTime(saved.state));
+		saved.real_ms = realMs();
+		printf("Saved with drift %d ppm, %u s after the last update, clock %lld ms fast\n", saved.state.drift,
+			saved.state.time - saved.state.last_sync, (long long)clockError());
+		CHECK(saved.state.drift >= 90 && saved.state.drift <= 110);
+	}
+
+	// After waking up from 'slept_ms' of deep sleep, 40 ms ago
+	void wake(const saved_t &saved, const uint32_t slept_ms) {
+		fast_ppm = 0;
+		base_ms = saved.real_ms + (slept_ms == RESTORE_UNKNOWN ? 1500 : slept_ms);
+		host::setMillis(40);
+		CHECK(restoreTime(saved.state, slept_ms));
+	}
+
+	int boot(void (*function)(const saved_t &), const saved_t &saved) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if (!pid) {
+			function(saved);
+			fflush(stdout);
+			_exit(failures ? 1 : 0);
+		}
+		int status;
+		waitpid(pid, &status, 0);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	}
+
+	// A minute of sleep: right to the millisecond, drift taken off, update when it's due
+	void shortSleep(const saved_t &saved) {
+		wake(saved, 60000);
+		CHECK(timeStatus() == timeSet);
+		int64_t e = clockError();
+		printf("After a minute of sleep: %lld ms off\n", (long long)e);
+		CHECK(e >= -3 && e <= 3);
+		events();
+		run(NTP_RETRY * 2);
+		CHECK(requests == 0);
+		run(NTP_INTERVAL * 2);
+		CHECK(requests >= 1 && timeStatus() == timeSet);
+	}
+
+	// Reset without knowing for how long: the time is there, but an update goes out right away
+	void unknownGap(const saved_t &saved) {
+		wake(saved, RESTORE_UNKNOWN);
+		CHECK(timeStatus() == timeNeedsSync);
+		CHECK(UTC.now() >= saved.state.time);
+		events();
+		CHECK(requests == 1 && timeStatus() == timeSet);
+	}
+
+	// Three hours asleep: the sleep timer could be seconds off by now
+	void longSleep(const saved_t &saved) {
+		wake(saved, 3 * 3600 * 1000UL);
+		CHECK(timeStatus() == timeNeedsSync);
+		int64_t e = clockError();
+		CHECK(e >= -3 && e <= 3);
+		events();
+		CHECK(requests == 1 && timeStatus() == timeSet);
+	}
+
+	// Garbage in RTC memory after a power cut
+	void garbage(const saved_t &saved) {
+		ezTimeState_t state = saved.state;
+		state.time ^= 0x100;
+		host::setMillis(40);
+		CHECK(!restoreTime(state, 60000));
+		memset(&state, 0xA5, sizeof(state));
+		CHECK(!restoreTime(state, 60000));
+		CHECK(timeStatus() == timeNotSet);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(NTP_INTERVAL);
+	host::setUdpResponder(123, server);
+	host::addHost(NTP_SERVER, "10.0.0.1");
+
+	// The first boot hands its saved state back through a pipe
+	saved_t saved;
+	int fds[2];
+	if (pipe(fds) < 0) return 2;
+	fflush(stdout);
+	pid_t pid = fork();
+	if (!pid) {
+		close(fds[0]);
+		firstBoot(saved);
+		if (write(fds[1], &saved, sizeof(saved)) != sizeof(saved)) failures++;
+		fflush(stdout);
+		_exit(failures ? 1 : 0);
+	}
+	close(fds[1]);
+	bool got = read(fds[0], &saved, sizeof(saved)) == sizeof(saved);
+	int status;
+	waitpid(pid, &status, 0);
+	if (!got || !WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "First boot failed\n");
+		return 1;
+	}
+
+	int failed = 0;
+	failed += boot(shortSleep, saved);
+	failed += boot(unknownGap, saved);
+	failed += boot(longSleep, saved);
+	failed += boot(garbage, saved);
+	if (failed) {
+		fprintf(stderr, "%d boot(s) failed\n", failed);
+		return 1;
+	}
+	printf("All restore checks passed\n");
+	return 0;
+}
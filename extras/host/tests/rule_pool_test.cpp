@@ -0,0 +1,117 @@
+/*
+ * rule_pool_test - Timezones with the same POSIX string share one parsed rule, and the DST
+ * start and end it keeps for the last year asked about. Built twice: as rule_pool_test, where
+ * the rules are shared, and as rule_pool_fixed_test with EZTIME_FIXED_STRINGS, where every
+ * Timezone keeps its own and the answers must be the same.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+	const char *BERLIN = "CET-1CEST,M3.5.0,M10.5.0/3";
+	const char *SYDNEY = "AEST-10AEDT,M10.1.0,M4.1.0/3";
+	const int COUNT = 100;
+
+	// A hundred Timezones in two zones hold two rules, and give them back when they go. (Nothing
+	// is printed while counting: stdout's buffer comes off the heap too.)
+	void sharing() {
+		size_t before = host::heap_bytes;
+		size_t one, used;
+		{
+			Timezone zones[COUNT];
+			size_t empty = host::heap_bytes;
+			zones[0].setPosix(BERLIN);
+			one = host::heap_bytes - empty;
+			for (int n = 1; n < COUNT; n++) CHECK(zones[n].setPosix(n % 2 ? SYDNEY : BERLIN));
+			used = host::heap_bytes - empty;
+			#ifdef EZTIME_FIXED_STRINGS
+				CHECK(used == 0);
+			#else
+				CHECK(one > 0);
+				CHECK(used <= 2 * one + 16);
+				CHECK(&zones[0].getRule() == &zones[2].getRule());
+				CHECK(&zones[0].getRule() != &zones[1].getRule());
+			#endif
+			// Changing one leaves the others alone
+			CHECK(zones[2].setPosix("JST-9"));
+			CHECK(zones[0].getPosix() == BERLIN && zones[2].getPosix() == "JST-9");
+			CHECK(zones[0].getOffset(1530000000, UTC_TIME) == -120);
+			CHECK(zones[2].getOffset(1530000000, UTC_TIME) == -540);
+		}
+		CHECK(host::heap_bytes == before);
+		printf("%d Timezones in 2 zones: %u bytes on the heap, %u for the first\n", COUNT, (unsigned)used, (unsigned)one);
+	}
+
+	// Copies share the rule too, and still stand on their own
+	void copies() {
+		size_t before = host::heap_bytes;
+		{
+			Timezone a;
+			a.setPosix(SYDNEY);
+			Timezone b = a;
+			Timezone c;
+			c = a;
+			#ifndef EZTIME_FIXED_STRINGS
+				CHECK(&b.getRule() == &a.getRule() && &c.getRule() == &a.getRule());
+			#endif
+			CHECK(b.getPosix() == SYDNEY && c.getPosix() == SYDNEY);
+			a.setPosix(BERLIN);
+			CHECK(b.getOffset(1530000000, UTC_TIME) == -600);
+			CHECK(a.getOffset(1530000000, UTC_TIME) == -120);
+		}
+		CHECK(host::heap_bytes == before);
+	}
+
+	// Two Timezones sharing Berlin's rule, asking about different years in turn, in UTC and in
+	// local time. Every answer must be right however the other one left the kept year.
+	void years() {
+		Timezone a, b;
+		a.setPosix(BERLIN);
+		b.setPosix(BERLIN);
+		// DST in Berlin: 2018-03-25 01:00 to 2018-10-28 01:00 UTC, 2019-03-31 to 2019-10-27
+		const time_t changes[] = { 1521939600, 1540688400, 1553994000, 1572138000 };
+		for (int round = 0; round < 3; round++) {
+			for (int n = 0; n < 4; n++) {
+				Timezone &tz = (n + round) % 2 ? a : b;
+				bool starts = !(n % 2);
+				CHECK(tz.isDST(changes[n] - 1, UTC_TIME) == !starts);
+				CHECK(tz.isDST(changes[n], UTC_TIME) == starts);
+				// The same instants in local time, on the other Timezone
+				Timezone &other = (&tz == &a) ? b : a;
+				// (local 02:00 to 03:00 when DST ends happens twice, and counts as DST)
+				time_t local_before = changes[n] - 1 + (starts ? 3600 : 7200);
+				time_t local_after = changes[n] + 7200;
+				CHECK(other.isDST(local_before, LOCAL_TIME) == !starts);
+				CHECK(other.isDST(local_after, LOCAL_TIME) == starts);
+			}
+		}
+		// Around New Year, in both directions
+		const time_t new_year = 1546300800;		// 2019-01-01 00:00
+		CHECK(a.getOffset(new_year - 1, UTC_TIME) == -60);
+		CHECK(b.getOffset(new_year, UTC_TIME) == -60);
+		CHECK(a.getOffset(new_year - 1, LOCAL_TIME) == -60);
+		CHECK(a.getTimezoneName(changes[2] + 3600, UTC_TIME) == "CEST");
+		CHECK(b.getTimezoneName(changes[0] - 3600, UTC_TIME) == "CET");
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	sharing();
+	copies();
+	years();
+	if (failures) return 1;
+	printf("All rule pool checks passed\n");
+	return 0;
+}
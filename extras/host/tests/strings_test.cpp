@@ -0,0 +1,79 @@
+/*
+ * strings_test - the char * versions of dateTime(), getPosix() and getOlson(), and that the
+ * String ones say the same. Built twice: as strings_test with Strings inside Timezone, and
+ * as strings_fixed_test with EZTIME_FIXED_STRINGS.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+	const char *BERLIN = "CET-1CEST,M3.5.0,M10.5.0/3";
+	const time_t SUMMER = 1530000000;		// 2018-06-26 08:00:00 UTC
+
+	void buffers() {
+		Timezone tz;
+		CHECK(tz.setPosix(BERLIN));
+		char buffer[64];
+		CHECK(tz.dateTime(buffer, sizeof(buffer), SUMMER, UTC_TIME, ISO8601) == 24);
+		CHECK(!strcmp(buffer, "2018-06-26T10:00:00+0200"));
+		CHECK(tz.dateTime(SUMMER, UTC_TIME, ISO8601) == buffer);
+		CHECK(tz.dateTime(buffer, sizeof(buffer), SUMMER, "l jS F Y, T") == 28);
+		CHECK(!strcmp(buffer, "Tuesday 26th June 2018, CEST"));
+		// Cut off, but the length says how much room it needed
+		CHECK(tz.dateTime(buffer, 11, SUMMER, "Y-m-d H:i:s") == 19);
+		CHECK(!strcmp(buffer, "2018-06-26"));
+		CHECK(tz.dateTime(NULL, 0, SUMMER, "Y") == 4);
+		CHECK(tz.getPosix(buffer, sizeof(buffer)) == strlen(BERLIN) && !strcmp(buffer, BERLIN));
+		CHECK(tz.getPosix(buffer, 4) == strlen(BERLIN) && !strcmp(buffer, "CET"));
+	}
+
+	// Longer than the String version's buffer on the stack
+	void longFormat() {
+		Timezone tz;
+		tz.setPosix(BERLIN);
+		String format;
+		for (int n = 0; n < 20; n++) format += "Y-m-d ";
+		String out = tz.dateTime(SUMMER, UTC_TIME, format);
+		CHECK(out.length() == 20 * 11);
+		CHECK(out.substring(0, 22) == "2018-06-26 2018-06-26 ");
+	}
+
+	// Nothing on the heap for the POSIX string and Olson name with fixed strings, and a POSIX
+	// string too long to keep is kept as the same rule written out shorter (this one is 70)
+	void storage() {
+		size_t before = host::heap_bytes;
+		Timezone tz;
+		CHECK(tz.setPosix("<CET>-001:00:00<CEST>-002:00:00,M03.5.0/+002:00:00,M010.5.0/+003:00:00"));
+		#ifdef EZTIME_FIXED_STRINGS
+			CHECK(host::heap_bytes == before);
+			CHECK(tz.getPosix() == "CET-1CEST,M3.5.0,M10.5.0/3");
+		#else
+			CHECK(host::heap_bytes > before);
+			CHECK(tz.getPosix() == "<CET>-001:00:00<CEST>-002:00:00,M03.5.0/+002:00:00,M010.5.0/+003:00:00");
+		#endif
+		CHECK(tz.dateTime(SUMMER, UTC_TIME, "H T") == "10 CEST");
+		char olson[8];
+		CHECK(tz.getOlson(olson, sizeof(olson)) == 0 && !olson[0]);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(SUMMER);
+	buffers();
+	longFormat();
+	storage();
+	if (failures) return 1;
+	printf("All strings checks passed\n");
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * time64_test - EZTIME_64BIT_TIME. breakTime() and makeTime() against gmtime() for every day
+ * from the year 1 to 9999, dateTime() and the ISO week along the way, and Timezones against
+ * the C library's localtime() with the same POSIX string, for times far from 1970 on both
+ * sides. The three special time_t values are out of the way too: 2038 is an ordinary year.
+ */
+
+#include <Arduino.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+	const time_t DAY = SECS_PER_DAY;
+	const time_t YEAR_1 = -62135596800LL;			// 0001-01-01 00:00 UTC
+	const time_t YEAR_10000 = 253402300800LL;		// 10000-01-01 00:00 UTC
+
+	static_assert(makeTime(0, 0, 0, 1, JANUARY, 1969) == -31536000, "before 1970");
+	static_assert(makeTime(0, 0, 0, 1, JANUARY, 2107) == 4323283200LL, "after 2106");
+	static_assert(breakTime(-1).Year == -1 && breakTime(-1).Hour == 23 && breakTime(-1).Second == 59, "the last second of 1969");
+	static_assert(breakTime(YEAR_1).Year == 1 - 1970 && breakTime(YEAR_1).Wday == MONDAY, "the year 1");
+
+	// Every day, at its first and last second
+	void everyDay() {
+		int days = 0;
+		for (time_t t = YEAR_1; t < YEAR_10000; t += DAY) {
+			for (time_t s = t; s < t + DAY; s += DAY - 1) {
+				struct tm want;
+				gmtime_r(&s, &want);
+				tmElements_t tm;
+				breakTime(s, tm);
+				if (tm.Year + 70 != want.tm_year || tm.Month != want.tm_mon + 1 || tm.Day != want.tm_mday ||
+					tm.Hour != want.tm_hour || tm.Minute != want.tm_min || tm.Second != want.tm_sec || tm.Wday != want.tm_wday + 1) {
+					fprintf(stderr, "breakTime(%lld): %d-%d-%d, not %d-%d-%d\n", (long long)s, tm.Year + 1970, tm.Month, tm.Day, want.tm_year + 1900, want.tm_mon + 1, want.tm_mday);
+					failures++;
+					return;
+				}
+				if (makeTime(tm) != s) {
+					fprintf(stderr, "makeTime() of %lld: %lld\n", (long long)s, (long long)makeTime(tm));
+					failures++;
+					return;
+				}
+			}
+			days++;
+		}
+		printf("%d days taken apart and put back together\n", days);
+	}
+
+	// dateTime() and the ISO week against strftime(), every 997 days and a bit
+	void formatted() {
+		int checked = 0;
+		for (time_t t = YEAR_1 + 12345; t < YEAR_10000; t += 997 * DAY + 4321) {
+			struct tm tm;
+			gmtime_r(&t, &tm);
+			char want[64];
+			strftime(want, sizeof(want), "%Y-%m-%d %H:%M:%S %a %V %G", &tm);
+			char got[64];
+			UTC.dateTime(got, sizeof(got), t, UTC_TIME, "Y-m-d H:i:s D W X");
+			if (strcmp(got, want) || UTC.dayOfYear(t, UTC_TIME) != tm.tm_yday) {
+				fprintf(stderr, "dateTime(%lld): %s, not %s\n", (long long)t, got, want);
+				failures++;
+				return;
+			}
+			checked++;
+		}
+		printf("%d times formatted\n", checked);
+	}
+
+	// The C library's offset at UTC time t, with TZ set to the same POSIX string
+	long glibcOffset(const time_t t) {
+		struct tm tm;
+		localtime_r(&t, &tm);
+		return tm.tm_gmtoff;
+	}
+
+	// Returns false after the first mismatch, so one broken zone does not flood the output.
+	// glibc uses 1970's DST dates for every year before it, so those are compared 400 years
+	// (146097 days, a whole number of weeks) or more later, where the calendar is the same.
+	bool sameAsGlibc(Timezone &tz, const char *posix, const time_t t) {
+		time_t later = t;
+		int years = 0;
+		while (later < 2 * 365 * DAY) {
+			later += 146097 * DAY;
+			years += 400;
+		}
+		struct tm want;
+		localtime_r(&later, &want);
+		char expected[64], got[64];
+		strftime(expected, sizeof(expected), "%m-%d %H:%M:%S %Z", &want);
+		tz.dateTime(got, sizeof(got), t, UTC_TIME, "m-d H:i:s T");
+		bool right = !strcmp(expected, got) && tz.getOffset(t, UTC_TIME) * -60L == want.tm_gmtoff && tz.isDST(t, UTC_TIME) == (want.tm_isdst > 0) &&
+			tz.hour(t, UTC_TIME) == want.tm_hour && tz.weekday(t, UTC_TIME) == want.tm_wday + 1 && tz.year(t, UTC_TIME) == want.tm_year + 1900 - years;
+		// The next change is where the C library's offset changes
+		const time_t next = tz.nextTransition(t, UTC_TIME);
+		if (next != NO_TRANSITION) {
+			const time_t moved = next + (later - t);
+			right = right && next > t && glibcOffset(moved) != glibcOffset(moved - 1) && glibcOffset(moved - 1) == want.tm_gmtoff;
+		}
+		if (!right) {
+			fprintf(stderr, "%s at %lld: %d-%s, not %d-%s (next change %lld)\n", posix, (long long)t, tz.year(t, UTC_TIME), got, want.tm_year + 1900 - years, expected, (long long)next);
+			failures++;
+		}
+		return right;
+	}
+
+	void zones() {
+		const char *posixes[] = { "CET-1CEST,M3.5.0,M10.5.0/3", "AEST-10AEDT,M10.1.0,M4.1.0/3", "EST5EDT,M3.2.0,M11.1.0",
+			"<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45", "IST-5:30" };
+		for (const char *posix : posixes) {
+			setenv("TZ", posix, 1);
+			tzset();
+			Timezone tz;
+			CHECK(tz.setPosix(posix));
+			int checked = 0;
+			for (time_t t = YEAR_1 + 36 * DAY; t < YEAR_10000 - 36 * DAY; t += 99999989) {
+				if (!sameAsGlibc(tz, posix, t)) break;
+				checked++;
+			}
+			printf("%s: %d times the same as localtime()\n", posix, checked);
+		}
+		unsetenv("TZ");
+		tzset();
+	}
+
+	// localBuckets() in the year 2500, against breakTime() and makeTime()
+	void buckets() {
+		Timezone berlin;
+		berlin.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		std::vector<time_t> utc, keys;
+		for (time_t t = 16725225600LL; t < 16725225600LL + 400 * DAY; t += 7777) utc.push_back(t);		// from 2500-01-01
+		keys.resize(utc.size());
+		berlin.localBuckets(utc.data(), keys.data(), utc.size(), BUCKET_DAY);
+		for (size_t n = 0; n < utc.size(); n++) {
+			tmElements_t tm;
+			breakTime(berlin.tzTime(utc[n], UTC_TIME), tm);
+			tm.Hour = tm.Minute = tm.Second = 0;
+			if (keys[n] != makeTime(tm)) {
+				fprintf(stderr, "day bucket of %lld: %lld, not %lld\n", (long long)utc[n], (long long)keys[n], (long long)makeTime(tm));
+				failures++;
+				return;
+			}
+		}
+	}
+
+	// What used to be TIME_NOW, LAST_READ and NO_TRANSITION are times like any other
+	void sentinels() {
+		CHECK(UTC.dateTime(0x7FFFFFFF, UTC_TIME, "Y-m-d H:i:s") == "2038-01-19 03:14:07");
+		CHECK(UTC.dateTime(0x7FFFFFFE, UTC_TIME, "Y-m-d H:i:s") == "2038-01-19 03:14:06");
+		Timezone berlin;
+		berlin.setPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+		CHECK(berlin.nextTransition(0x7FFFFFF0, UTC_TIME) == 2153350800LL);		// 2038-03-28 01:00 UTC
+		CHECK(berlin.tzTime() == UTC.now() + 7200);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	setInterval(0);
+	UTC.setTime(1530000000);
+	everyDay();
+	formatted();
+	zones();
+	buckets();
+	sentinels();
+	if (failures) return 1;
+	printf("All 64-bit time checks passed\n");
+	return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * time_source_test - addTimeSource() with mock sources: an RTC chip that only knows whole
+ * seconds, a precise reference, a PPS edge on top of a coarse source, and the host's clock.
+ * Every "boot" is a fork() of this process, so it starts with a fresh ezTime. The NTP server
+ * is answered in-process (host::setUdpResponder) and millis() is simulated.
+ */
+
+#include <Arduino.h>
+#include <HostClock.h>
+#include <HostShim.h>
+#include <ezTime.h>
+
+#include "check.h"
+#include "ntp_responder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+	// A source that is 'error_ms' off. With whole_seconds it only says which second it is,
+	// like an RTC chip, and takes setTime().
+	class MockSource : public ezTimeSource {
+		public:
+			MockSource(const uint16_t precision, const int32_t error_ms, const bool whole_seconds)
+				: working(true), reads(0), sets(0), error(error_ms), _precision(precision), _whole_seconds(whole_seconds) {}
+			bool getTime(time_t &t, unsigned long &measured_at) {
+				reads++;
+				if (!working) return false;
+				uint64_t ms = realMs() + error;
+				t = ms / 1000;
+				measured_at = millis() - (_whole_seconds ? 500 : ms % 1000);
+				return true;
+			}
+			uint16_t precision() { return _precision; }
+			bool setTime(const time_t t, const unsigned long measured_at) {
+				if (!_whole_seconds) return false;
+				sets++;
+				error = (int64_t)t * 1000 + (millis() - measured_at) - (int64_t)realMs();
+				return true;
+			}
+			bool working;
+			unsigned long reads;
+			unsigned long sets;
+			int32_t error;
+		private:
+			uint16_t _precision;
+			bool _whole_seconds;
+	};
+
+	int boot(void (*function)()) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if (!pid) {
+			host::setMillis(0);
+			function();
+			fflush(stdout);
+			_exit(failures ? 1 : 0);
+		}
+		int status;
+		waitpid(pid, &status, 0);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	}
+
+	// No network at boot: the RTC has the time, and is set right once NTP answers
+	void offlineRtc() {
+		MockSource rtc(500, 300, true);
+		CHECK(addTimeSource(rtc));
+		host::setNetwork(false);
+		events();
+		CHECK(timeStatus() == timeSet);
+		CHECK(requests == 0);
+		int64_t e = clockError();
+		printf("From the RTC: %lld ms off\n", (long long)e);
+		CHECK(e >= -800 && e <= 800);
+		host::setNetwork(true);
+		run(NTP_RETRY * 3);
+		CHECK(requests == 1);
+		CHECK(clockError() == 0);
+		CHECK(rtc.sets == 1 && rtc.error == 0);
+	}
+
+	// A source better than NTP: NTP is never asked, the RTC is set from it
+	void preciseSource() {
+		MockSource reference(1, 0, false);
+		MockSource rtc(500, -2000, true);
+		CHECK(addTimeSource(rtc));
+		CHECK(addTimeSource(reference));
+		events();
+		run(3 * 3600);
+		CHECK(requests == 0);
+		CHECK(reference.reads >= 6 && rtc.reads == 0);
+		CHECK(rtc.sets >= 6 && rtc.error == 0);
+		CHECK(timeStatus() == timeSet && clockError() == 0);
+	}
+
+	// The better source stops answering: back to NTP
+	void failingSource() {
+		MockSource reference(1, 0, false);
+		CHECK(addTimeSource(reference));
+		events();
+		CHECK(requests == 0);
+		reference.working = false;
+		run(2 * NTP_INTERVAL);
+		CHECK(requests >= 1 && timeStatus() == timeSet);
+		removeTimeSource(reference);
+		unsigned long reads = reference.reads;
+		run(2 * NTP_INTERVAL);
+		CHECK(reference.reads == reads);
+	}
+
+	// NTP updates switched off: the sources are read every TIME_SOURCE_INTERVAL
+	void noNtp() {
+		setInterval(0);
+		MockSource rtc(500, 0, true);
+		CHECK(addTimeSource(rtc));
+		events();
+		CHECK(timeStatus() == timeSet && rtc.reads == 1);
+		run(2 * TIME_SOURCE_INTERVAL + 10);
+		CHECK(rtc.reads == 3);
+		CHECK(requests == 0);
+	}
+
+	// PPS: the seconds from a coarse source 400 ms off, the edges exactly on the second
+	void ppsEdges(const int32_t coarse_error) {
+		MockSource gps(500, coarse_error, false);
+		ezPpsSource edges(gps);
+		pps = &edges;
+		CHECK(addTimeSource(edges));
+		edges.edge();
+		events();
+		run(3 * 3600);
+		CHECK(requests == 0);
+		CHECK(timeStatus() == timeSet && clockError() == 0);
+		// No more edges: NTP takes over
+		pps = NULL;
+		run(2 * NTP_INTERVAL);
+		CHECK(requests >= 1 && clockError() == 0);
+	}
+
+	void ppsLate() { ppsEdges(400); }
+	void ppsEarly() { ppsEdges(-400); }
+
+	void limits() {
+		MockSource sources[MAX_TIME_SOURCES + 1] = {
+			MockSource(10, 0, false), MockSource(20, 0, false), MockSource(30, 0, false),
+			MockSource(40, 0, false), MockSource(50, 0, false)
+		};
+		for (int n = 0; n < MAX_TIME_SOURCES; n++) CHECK(addTimeSource(sources[n]));
+		CHECK(addTimeSource(sources[0]));		// already there
+		CHECK(!addTimeSource(sources[MAX_TIME_SOURCES]));
+		CHECK(error() == TOO_MANY_SOURCES);
+		removeTimeSource(sources[1]);
+		CHECK(addTimeSource(sources[MAX_TIME_SOURCES]));
+	}
+
+	// The host's clock, with the real millis()
+	void hostClock() {
+		host::useRealMillis();
+		host::setNetwork(false);
+		host::ClockSource clock;
+		CHECK(addTimeSource(clock));
+		events();
+		CHECK(timeStatus() == timeSet);
+		time_t t = UTC.now();
+		time_t real = time(NULL);
+		CHECK(t + 1 >= real && t <= real + 1);
+	}
+
+}
+
+int main() {
+	setDebug(NONE);
+	host::setUdpResponder(123, server);
+	host::addHost(NTP_SERVER, "10.0.0.1");
+
+	int failed = 0;
+	failed += boot(offlineRtc);
+	failed += boot(preciseSource);
+	failed += boot(failingSource);
+	failed += boot(noNtp);
+	failed += boot(ppsLate);
+	failed += boot(ppsEarly);
+	failed += boot(limits);
+	failed += boot(hostClock);
+	if (failed) {
+		fprintf(stderr, "%d boot(s) failed\n", failed);
+		return 1;
+	}
+	printf("All time source checks passed\n");
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * mktzdb - generates src/ezTimeDB.h, the compiled-in timezone database.
+ *
+ *   mktzdb [posixinfo file or zoneinfo directory] > src/ezTimeDB.h
+ *   mktzdb --transitions ZONE [zoneinfo directory] > zone.h
+ *
+ * The zones are read the same way server/update builds the timezone server's data. Every
+ * distinct POSIX rule is stored once, and the names are sorted the way ezTime compares
+ * them (uppercase, space and underscore equal) so setLocation() can binary search them.
+ *
+ * With --transitions, the zone's TZif file is loaded with setTZif() and printed as a
+ * compiled ezTransitions_t table, to be given to setTransitions() in a sketch.
+ */
+
+#include <Arduino.h>
+#include <ezTime.h>
+
+#include "posixinfo.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+	std::string sortKey(const std::string &name) {
+		std::string key = name;
+		for (char &c : key) c = (c == ' ') ? '_' : toupper((unsigned char)c);
+		return key;
+	}
+
+	std::string tzdataVersion(const std::string &dir) {
+		std::ifstream file(dir + "/tzdata.zi");
+		std::string line;
+		if (std::getline(file, line) && line.compare(0, 10, "# version ") == 0) return line.substr(10);
+		return "";
+	}
+
+	// Emit a NUL-separated string table as one literal per entry
+	void printTable(const char *name, const std::vector<std::string> &entries) {
+		printf("const char %s[] PROGMEM =\n", name);
+		for (size_t n = 0; n < entries.size(); n++) {
+			printf("\t\"%s\\0\"%s\n", entries[n].c_str(), n + 1 == entries.size() ? ";" : "");
+		}
+		printf("\n");
+	}
+
+	int printTransitions(const std::string &zone, const std::string &dir) {
+		std::ifstream file(dir + "/" + zone, std::ios::binary);
+		std::vector<uint8_t> tzif((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		Timezone tz;
+		if (tzif.empty() || !tz.setTZif(tzif.data(), tzif.size())) {
+			fprintf(stderr, "Cannot load %s/%s\n", dir.c_str(), zone.c_str());
+			return 1;
+		}
+		const ezTransitions_t &tr = *tz.getTransitions();
+		std::string id;
+		for (char c : zone) id += isalnum((unsigned char)c) ? (char)tolower((unsigned char)c) : '_';
+		uint16_t types = 0, chars = 0;
+		for (uint16_t n = 0; n < tr.count; n++) if (tr.type[n] >= types) types = tr.type[n] + 1;
+		if (!types) types = 1;
+		for (uint16_t n = 0; n < types; n++) {
+			uint16_t end = tr.types[n].name + strlen(tr.names + tr.types[n].name) + 1;
+			if (end > chars) chars = end;
+		}
+		std::string version = tzdataVersion(dir);
+
+		printf("// %s%s%s, generated by extras/host/tools/mktzdb --transitions\n", zone.c_str(), version.empty() ? "" : " from tzdata ", version.c_str());
+		printf("// Use with %s.setPosix(\"%s\") and %s.setTransitions(%s)\n", "myTZ", tz.getPosix().c_str(), "myTZ", id.c_str());
+		printf("// Needs a 64-bit time_t if there are times before 1901 or after 2038, else cut those off\n\n");
+		printf("const time_t %s_at[] = {", id.c_str());
+		for (uint16_t n = 0; n < tr.count; n++) printf("%s%lld", n % 6 ? ", " : (n ? ",\n\t" : "\n\t"), (long long)tr.at[n]);
+		printf("\n};\n\n");
+		printf("const uint8_t %s_type[] = {", id.c_str());
+		for (uint16_t n = 0; n < tr.count; n++) printf("%s%u", n % 16 ? ", " : (n ? ",\n\t" : "\n\t"), tr.type[n]);
+		printf("\n};\n\n");
+		printf("const ezZoneType_t %s_types[] = {\n", id.c_str());
+		for (uint16_t n = 0; n < types; n++) {
+			printf("\t{ %d, %s, %u }%s\t// %s\n", tr.types[n].offset, tr.types[n].is_dst ? "true" : "false", tr.types[n].name,
+				n + 1 == types ? "" : ",", tr.names + tr.types[n].name);
+		}
+		printf("};\n\n");
+		printf("const char %s_names[] =", id.c_str());
+		for (uint16_t n = 0; n < chars; n += strlen(tr.names + n) + 1) printf(" \"%s\\0\"", tr.names + n);
+		printf(";\n\n");
+		printf("const ezTransitions_t %s = { %u, %s_at, %s_type, %s_types, %s_names };\n",
+			id.c_str(), tr.count, id.c_str(), id.c_str(), id.c_str(), id.c_str());
+		return 0;
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 2 && std::string(argv[1]) == "--transitions") return printTransitions(argv[2], argc > 3 ? argv[3] : ZONEINFO_DIR);
+	std::string source = argc > 1 ? argv[1] : ZONEINFO_DIR;
+	std::vector<zoneinfo_t> zones;
+	if (!loadZones(source, zones) || zones.empty()) {
+		fprintf(stderr, "No zones found in %s\n", source.c_str());
+		return 1;
+	}
+
+	// Same override as the timezone server: ezTime has no negative DST
+	for (zoneinfo_t &zone : zones) {
+		if (zone.olson == "Europe/Dublin") zone.posix = "GMT0IST,M3.5.0/1,M10.5.0";
+	}
+
+	std::sort(zones.begin(), zones.end(), [](const zoneinfo_t &a, const zoneinfo_t &b) { return sortKey(a.olson) < sortKey(b.olson); });
+	zones.erase(std::unique(zones.begin(), zones.end(), [](const zoneinfo_t &a, const zoneinfo_t &b) { return sortKey(a.olson) == sortKey(b.olson); }), zones.end());
+
+	std::vector<std::string> names, rules;
+	std::map<std::string, size_t> rule_offsets;
+	std::vector<std::pair<size_t, size_t> > index;
+	size_t names_size = 0, rules_size = 0;
+	for (const zoneinfo_t &zone : zones) {
+		auto found = rule_offsets.find(zone.posix);
+		if (found == rule_offsets.end()) {
+			found = rule_offsets.insert(std::make_pair(zone.posix, rules_size)).first;
+			rules.push_back(zone.posix);
+			rules_size += zone.posix.size() + 1;
+		}
+		index.push_back(std::make_pair(names_size, found->second));
+		names.push_back(zone.olson);
+		names_size += zone.olson.size() + 1;
+	}
+	if (names_size > 0xFFFF || rules_size > 0xFFFF) {
+		fprintf(stderr, "Tables too big for 16-bit offsets\n");
+		return 1;
+	}
+
+	std::string version = tzdataVersion(source);
+	printf("/*\n");
+	printf(" * Compiled-in timezone database, used by setLocation() when EZTIME_TZDB is defined in\n");
+	printf(" * ezTime.h. Generated by extras/host/tools/mktzdb%s%s, do not edit.\n", version.empty() ? "" : " from tzdata ", version.c_str());
+	printf(" *\n");
+	printf(" * %zu zones, %zu distinct rules, %zu bytes of flash.\n", zones.size(), rules.size(), names_size + rules_size + index.size() * 4);
+	printf(" */\n\n");
+	printf("#define TZDB_ZONES\t\t%zu\n\n", zones.size());
+	printf("// Every distinct POSIX rule once\n");
+	printTable("_tzdb_rules", rules);
+	printf("// Zone names, sorted as uppercase with spaces as underscores\n");
+	printTable("_tzdb_names", names);
+	printf("// For every zone: offset of its name in _tzdb_names and of its rule in _tzdb_rules\n");
+	printf("const uint16_t _tzdb_index[TZDB_ZONES][2] PROGMEM = {\n");
+	for (size_t n = 0; n < index.size(); n++) {
+		printf("\t{ %5zu, %4zu }%s\n", index[n].first, index[n].second, n + 1 == index.size() ? "" : ",");
+	}
+	printf("};\n");
+	return 0;
+}
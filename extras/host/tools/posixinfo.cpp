@@ -0,0 +1,81 @@
+#include "posixinfo.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+	std::string trim(const std::string &s) {
+		size_t begin = s.find_first_not_of(" \t\r\n");
+		if (begin == std::string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r\n");
+		return s.substr(begin, end - begin + 1);
+	}
+
+	bool isDirectory(const std::string &path) {
+		struct stat st;
+		return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+	}
+
+	void scan(const std::string &root, const std::string &relative, std::vector<zoneinfo_t> &zones) {
+		DIR *dir = opendir((root + "/" + relative).c_str());
+		if (!dir) return;
+		std::vector<std::string> names;
+		while (struct dirent *entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			if (name[0] == '.') continue;
+			names.push_back(name);
+		}
+		closedir(dir);
+		std::sort(names.begin(), names.end());
+		for (const std::string &name : names) {
+			std::string rel = relative.empty() ? name : relative + "/" + name;
+			if (relative.empty() && (name == "posix" || name == "right")) continue;
+			if (isDirectory(root + "/" + rel)) {
+				scan(root, rel, zones);
+				continue;
+			}
+			if (relative.empty()) continue;		// like `find * | grep /`
+			std::ifstream file(root + "/" + rel, std::ios::binary);
+			std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			if (data.compare(0, 4, "TZif") != 0) continue;
+			// The footer is the POSIX rule between the last two newlines
+			if (data.size() < 2 || data[data.size() - 1] != '\n') continue;
+			size_t newline = data.rfind('\n', data.size() - 2);
+			if (newline == std::string::npos) continue;
+			std::string footer = data.substr(newline + 1, data.size() - newline - 2);
+			if (footer.empty() || std::any_of(footer.begin(), footer.end(), [](char c) { return c < 32 || c > 126; })) continue;
+			zones.push_back({ rel, footer });
+		}
+	}
+
+}
+
+bool readPosixinfo(const std::string &path, std::vector<zoneinfo_t> &zones) {
+	std::ifstream file(path);
+	if (!file) return false;
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t space = line.find(' ');
+		if (space == std::string::npos) continue;
+		std::string olson = trim(line.substr(0, space));
+		std::string posix = trim(line.substr(space + 1));
+		if (olson.empty() || posix.empty()) continue;
+		zones.push_back({ olson, posix });
+	}
+	return true;
+}
+
+bool scanZoneinfo(const std::string &dir, std::vector<zoneinfo_t> &zones) {
+	size_t before = zones.size();
+	scan(dir, "", zones);
+	return zones.size() > before;
+}
+
+bool loadZones(const std::string &path, std::vector<zoneinfo_t> &zones) {
+	if (isDirectory(path)) return scanZoneinfo(path, zones);
+	return readPosixinfo(path, zones);
+}
@@ -0,0 +1,28 @@
+/*
+ * Reading the 'posixinfo' file that server/update generates (one "Olson/Name POSIX" per
+ * line), or building the same list directly from a compiled zoneinfo directory.
+ */
+
+#ifndef _POSIXINFO_H_
+#define _POSIXINFO_H_
+
+#include <string>
+#include <vector>
+
+#define ZONEINFO_DIR	"/usr/share/zoneinfo"
+
+struct zoneinfo_t {
+	std::string olson;
+	std::string posix;
+};
+
+bool readPosixinfo(const std::string &path, std::vector<zoneinfo_t> &zones);
+
+// Same selection as server/update: every TZif file one level down or deeper, with the
+// POSIX footer (last line) as its rule. The posix/ and right/ copies are skipped.
+bool scanZoneinfo(const std::string &dir, std::vector<zoneinfo_t> &zones);
+
+// posixinfo file if 'path' is a file, zoneinfo scan if it is a directory
+bool loadZones(const std::string &path, std::vector<zoneinfo_t> &zones);
+
+#endif // _POSIXINFO_H_
@@ -0,0 +1,69 @@
+/*
+ * timezoned - a local stand-in for the timezone server, see tzserver.h.
+ *
+ *   timezoned [options] [posixinfo file or zoneinfo directory]
+ *
+ *     --port PORT              port to listen on (default 2342, like the real one)
+ *     --zone1970 FILE          country codes (default zone1970.tab in the zoneinfo directory,
+ *                              or next to the posixinfo file)
+ *     --no-flood-protection    answer every packet, not one per address per 3 seconds
+ *     --threads N              answer on N threads (default 1)
+ *     --linear                 scan every zone for every question, like server/server
+ *     --no-batches             answer like a server from before setLocations(), in text
+ *     --text                   never answer in the binary format
+ *
+ * Point a sketch at it with setTimezoneServer("<this machine>", port).
+ */
+
+#include "tzserver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+	uint16_t port = 2342;
+	unsigned threads = 1;
+	std::string source = ZONEINFO_DIR;
+	std::string zone1970;
+	tzserver_t server;
+	for (int n = 1; n < argc; n++) {
+		if (!strcmp(argv[n], "--port") && n + 1 < argc) {
+			port = atoi(argv[++n]);
+		} else if (!strcmp(argv[n], "--zone1970") && n + 1 < argc) {
+			zone1970 = argv[++n];
+		} else if (!strcmp(argv[n], "--threads") && n + 1 < argc) {
+			threads = atoi(argv[++n]);
+		} else if (!strcmp(argv[n], "--linear")) {
+			server.indexed = false;
+		} else if (!strcmp(argv[n], "--no-flood-protection")) {
+			server.flood_protection = false;
+		} else if (!strcmp(argv[n], "--no-batches")) {
+			server.batches = false;
+		} else if (!strcmp(argv[n], "--text")) {
+			server.binary = false;
+		} else if (argv[n][0] == '-') {
+			fprintf(stderr, "usage: %s [--port PORT] [--zone1970 FILE] [--threads N] [--linear] [--no-flood-protection] [--no-batches] [--text] [posixinfo | zoneinfo dir]\n", argv[0]);
+			return 2;
+		} else {
+			source = argv[n];
+		}
+	}
+	if (zone1970.empty()) zone1970 = zone1970Path(source);
+
+	if (!loadTzserver(source, zone1970, server)) {
+		fprintf(stderr, "No zones found in %s\n", source.c_str());
+		return 1;
+	}
+	uint16_t bound;
+	int fd = openTzserver(port, bound);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot listen on port %u\n", port);
+		return 1;
+	}
+	printf("%zu zones, %zu country entries, listening on port %u\n", server.zones.size(), server.countries.size(), bound);
+	fflush(stdout);
+	std::atomic<bool> stop(false);
+	serveTzserver(server, fd, stop, true, threads ? threads : 1);
+	return 0;
+}
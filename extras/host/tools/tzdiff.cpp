@@ -0,0 +1,315 @@
+/*
+ * tzdiff - compares ezTime's timezone conversions against glibc localtime_r.
+ *
+ *   tzdiff [options] [posixinfo file or zoneinfo directory]
+ *
+ *     --from YEAR      first year of the sweep (default 2000)
+ *     --to YEAR        last year of the sweep (default 2037)
+ *     --step SECONDS   distance between samples (default 3 days and a bit)
+ *     --zone TEXT      only zones whose name contains TEXT
+ *     --verbose        list every zone, not just the ones with mismatches
+ *     --history        load each zone's TZif file with setTZif() instead of only its POSIX
+ *                      string, and compare against glibc reading the same file (needs a
+ *                      zoneinfo directory)
+ *
+ * Every zone's POSIX string is given to a Timezone object and, as TZ, to glibc. For each
+ * sampled UTC instant the local time and offset from tzTime(), isDST() and the output of
+ * dateTime() are compared, and the local time is converted back with tzTime(LOCAL_TIME).
+ * Wherever glibc's offset changes between two samples the transition is located exactly
+ * and the seconds around it are checked too, as are nextTransition() and prevTransition().
+ * Both sides are also timed on their own.
+ * Offsets that are not whole minutes (local mean time in some zones' history) cannot be
+ * represented by ezTime; those samples are skipped. Exits non-zero if anything did not match.
+ */
+
+#include <Arduino.h>
+#include <ezTime.h>
+
+#include "posixinfo.h"
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+	struct options_t {
+		int from_year = 2000;
+		int to_year = 2037;
+		time_t step = 3 * 86400 + 3671;
+		const char *zone_filter = NULL;
+		bool verbose = false;
+		bool history = false;
+		std::string source = ZONEINFO_DIR;
+	};
+
+	enum mismatch_e { OFFSET, IS_DST, TEXT, REVERSE, TRANSITION, NUM_MISMATCH_KINDS };
+	const char *mismatch_names[NUM_MISMATCH_KINDS] = { "offset", "isDST", "dateTime", "tzTime(LOCAL_TIME)", "next/prevTransition" };
+
+	struct result_t {
+		unsigned long samples = 0;
+		unsigned long skipped = 0;
+		unsigned long mismatches = 0;
+		unsigned long kinds[NUM_MISMATCH_KINDS] = { 0 };
+		std::string first_mismatch;
+	};
+
+	time_t utcFromYear(const int year) {
+		struct tm tm;
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_year = year - 1900;
+		tm.tm_mday = 1;
+		return timegm(&tm);
+	}
+
+	void setTZ(const std::string &posix) {
+		setenv("TZ", posix.c_str(), 1);
+		tzset();
+	}
+
+	long glibcOffset(const time_t t) {
+		struct tm tm;
+		localtime_r(&t, &tm);
+		return tm.tm_gmtoff;
+	}
+
+	// Text as ezTime's "Y-m-d H:i:s T" would produce it
+	std::string glibcText(const struct tm &tm) {
+		char buf[64];
+		strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S %Z", &tm);
+		return buf;
+	}
+
+	// Local times in the hour that is repeated when DST ends cannot be converted back unambiguously
+	bool unambiguous(const time_t t) {
+		long offset = glibcOffset(t);
+		return glibcOffset(t - 3 * 3600) == offset && glibcOffset(t + 3 * 3600) == offset;
+	}
+
+	void mismatch(result_t &result, const time_t t, const mismatch_e kind, const std::string &problem) {
+		result.kinds[kind]++;
+		if (!result.mismatches) {
+			char when[32];
+			struct tm utc;
+			gmtime_r(&t, &utc);
+			strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%SZ", &utc);
+			result.first_mismatch = std::string(when) + ": " + problem;
+		}
+		result.mismatches++;
+	}
+
+	void compare(Timezone &tz, const time_t t, const bool check_reverse, result_t &result) {
+		struct tm tm;
+		localtime_r(&t, &tm);
+		if (tm.tm_gmtoff % 60) {
+			result.skipped++;
+			return;
+		}
+		time_t glibc_local = t + tm.tm_gmtoff;
+
+		String tzname;
+		bool is_dst;
+		int16_t offset;
+		time_t valid_until;
+		time_t ez_local = tz.tzTime(t, UTC_TIME, tzname, is_dst, offset, valid_until);
+		String text = tz.dateTime(t, UTC_TIME, "Y-m-d H:i:s T");
+
+		std::string problem;
+		mismatch_e kind = OFFSET;
+		if (ez_local != glibc_local) {
+			kind = OFFSET;
+			problem = "offset " + std::to_string(-offset * 60) + " vs " + std::to_string(tm.tm_gmtoff);
+		} else if (tz.isDST(t, UTC_TIME) != (tm.tm_isdst > 0)) {
+			kind = IS_DST;
+			problem = std::string("isDST ") + (is_dst ? "true" : "false") + " vs " + (tm.tm_isdst > 0 ? "true" : "false");
+		} else if (glibcText(tm) != text.c_str()) {
+			kind = TEXT;
+			problem = std::string("dateTime \"") + text.c_str() + "\" vs \"" + glibcText(tm) + "\"";
+		} else if (valid_until <= t || (valid_until != NO_TRANSITION && glibcOffset(valid_until - 1) != tm.tm_gmtoff)) {
+			kind = TRANSITION;
+			problem = "valid_until " + std::to_string((long long)valid_until - t) + " s ahead, offset changes before";
+		} else if (check_reverse && unambiguous(t) && tz.tzTime(glibc_local, LOCAL_TIME) != t) {
+			kind = REVERSE;
+			problem = "tzTime(LOCAL_TIME) gives " + std::to_string((long long)tz.tzTime(glibc_local, LOCAL_TIME) - t) + " s off";
+		}
+		result.samples++;
+		if (!problem.empty()) mismatch(result, t, kind, problem);
+	}
+
+	// Transitions that do not change the offset (only the name or isDST) are invisible to
+	// findTransition() below, so ezTime may step through a few before reaching this one.
+	void compareTransition(Timezone &tz, const time_t from, const time_t transition, result_t &result) {
+		time_t next = from;
+		do {
+			next = tz.nextTransition(next, UTC_TIME);
+		} while (next != NO_TRANSITION && next < transition && glibcOffset(next) == glibcOffset(next - 1));
+		if (next != transition) {
+			mismatch(result, transition, TRANSITION, "nextTransition gives " + std::to_string((long long)next - transition) + " s off");
+		} else if (tz.prevTransition(transition + 1, UTC_TIME) != transition) {
+			mismatch(result, transition, TRANSITION, "prevTransition gives " + std::to_string((long long)tz.prevTransition(transition + 1, UTC_TIME) - transition) + " s off");
+		}
+	}
+
+	// Binary search for the first second with the new offset, between lo (old) and hi (new)
+	time_t findTransition(time_t lo, time_t hi) {
+		long lo_offset = glibcOffset(lo);
+		while (hi - lo > 1) {
+			time_t mid = lo + (hi - lo) / 2;
+			if (glibcOffset(mid) == lo_offset) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		return hi;
+	}
+
+	result_t checkZone(Timezone &tz, const std::vector<time_t> &samples) {
+		result_t result;
+		long last_offset = 0;
+		for (size_t n = 0; n < samples.size(); n++) {
+			time_t t = samples[n];
+			long offset = glibcOffset(t);
+			if (n && offset != last_offset) {
+				time_t transition = findTransition(samples[n - 1], t);
+				compareTransition(tz, samples[n - 1], transition, result);
+				for (time_t s = transition - 2; s <= transition + 1; s++) compare(tz, s, false, result);
+				// An hour either side is clear of the ambiguous / skipped local times
+				compare(tz, transition - 2 * 3600, true, result);
+				compare(tz, transition + 2 * 3600, true, result);
+			}
+			last_offset = offset;
+			compare(tz, t, true, result);
+		}
+		return result;
+	}
+
+	// ns per sample for a typical mix: a conversion plus a formatted string
+	double timeEzTime(Timezone &tz, const std::vector<time_t> &samples) {
+		volatile unsigned long sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (time_t t : samples) {
+			sink += tz.tzTime(t, UTC_TIME);
+			sink += tz.dateTime(t, UTC_TIME, "Y-m-d H:i:s T").length();
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool readFile(const std::string &path, std::vector<uint8_t> &data) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	double timeGlibc(const std::vector<time_t> &samples) {
+		volatile unsigned long sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (time_t t : samples) {
+			struct tm tm;
+			localtime_r(&t, &tm);
+			sink += tm.tm_gmtoff;
+			localtime_r(&t, &tm);
+			sink += glibcText(tm).length();
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool parseArgs(int argc, char *argv[], options_t &opts) {
+		for (int n = 1; n < argc; n++) {
+			std::string arg = argv[n];
+			bool has_value = n + 1 < argc;
+			if (arg == "--from" && has_value) {
+				opts.from_year = atoi(argv[++n]);
+			} else if (arg == "--to" && has_value) {
+				opts.to_year = atoi(argv[++n]);
+			} else if (arg == "--step" && has_value) {
+				opts.step = atol(argv[++n]);
+			} else if (arg == "--zone" && has_value) {
+				opts.zone_filter = argv[++n];
+			} else if (arg == "--verbose") {
+				opts.verbose = true;
+			} else if (arg == "--history") {
+				opts.history = true;
+			} else if (arg[0] != '-') {
+				opts.source = arg;
+			} else {
+				return false;
+			}
+		}
+		return opts.step > 0 && opts.to_year >= opts.from_year;
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	options_t opts;
+	if (!parseArgs(argc, argv, opts)) {
+		fprintf(stderr, "usage: %s [--from YEAR] [--to YEAR] [--step SECONDS] [--zone TEXT] [--verbose] [--history] [posixinfo | zoneinfo dir]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<zoneinfo_t> zones;
+	if (!loadZones(opts.source, zones) || zones.empty()) {
+		fprintf(stderr, "No zones found in %s\n", opts.source.c_str());
+		return 2;
+	}
+
+	std::vector<time_t> samples;
+	time_t end = utcFromYear(opts.to_year + 1);
+	for (time_t t = utcFromYear(opts.from_year); t < end; t += opts.step) samples.push_back(t);
+
+	unsigned long zones_checked = 0, zones_failed = 0, total_samples = 0, total_skipped = 0, total_mismatches = 0;
+	unsigned long kinds[NUM_MISMATCH_KINDS] = { 0 };
+	double ez_ns = 0, glibc_ns = 0;
+	Timezone tz;
+
+	for (const zoneinfo_t &zone : zones) {
+		if (opts.zone_filter && zone.olson.find(opts.zone_filter) == std::string::npos) continue;
+		if (opts.history) {
+			std::string path = opts.source + "/" + zone.olson;
+			std::vector<uint8_t> tzif;
+			if (!readFile(path, tzif) || !tz.setTZif(tzif.data(), tzif.size())) {
+				printf("%-32s cannot load %s\n", zone.olson.c_str(), path.c_str());
+				zones_failed++;
+				total_mismatches++;
+				continue;
+			}
+			setTZ(":" + path);
+		} else {
+			setTZ(zone.posix);
+			tz.setPosix(zone.posix.c_str());
+		}
+		result_t result = checkZone(tz, samples);
+		ez_ns += timeEzTime(tz, samples);
+		glibc_ns += timeGlibc(samples);
+		zones_checked++;
+		total_samples += result.samples;
+		total_skipped += result.skipped;
+		total_mismatches += result.mismatches;
+		if (result.mismatches) zones_failed++;
+		for (int k = 0; k < NUM_MISMATCH_KINDS; k++) kinds[k] += result.kinds[k];
+		if (result.mismatches || opts.verbose) {
+			printf("%-32s %-40s %7lu/%-7lu %s\n", zone.olson.c_str(), zone.posix.c_str(), result.mismatches, result.samples,
+				result.mismatches ? result.first_mismatch.c_str() : "OK");
+		}
+	}
+
+	unsigned long timed = zones_checked * samples.size();
+	printf("\n%lu zones, %lu samples, %lu mismatches in %lu zones\n", zones_checked, total_samples, total_mismatches, zones_failed);
+	if (total_skipped) printf("%lu samples skipped, offset not in whole minutes\n", total_skipped);
+	for (int k = 0; k < NUM_MISMATCH_KINDS; k++) {
+		if (kinds[k]) printf("  %-20s %lu\n", mismatch_names[k], kinds[k]);
+	}
+	if (timed) {
+		printf("ezTime %.1f ns/sample, glibc %.1f ns/sample (ezTime takes %.2fx as long)\n",
+			ez_ns / timed, glibc_ns / timed, ez_ns / (glibc_ns > 0 ? glibc_ns : 1));
+	}
+	return total_mismatches ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * tzload - load generator for the timezone server protocol.
+ *
+ *   tzload [options] [posixinfo file or zoneinfo directory]
+ *
+ *     --host HOST        server to ask (default 127.0.0.1)
+ *     --port PORT        its port (default 2342)
+ *     --local            start a stand-in server (tzserver.h) in this process instead, on a
+ *                        free port, without flood protection
+ *     --linear           with --local: scan every zone like server/server does
+ *     --threads N        with --local: server threads (default 1)
+ *     --clients N        clients asking at the same time, one question outstanding each (default 4)
+ *     --seconds S        how long to keep asking (default 5)
+ *     --batch N          locations per question (default 1)
+ *     --partial          ask for the last part of the names in lowercase ("new_york") instead
+ *                        of the full names, so the server has to search
+ *     --text             ask for text answers instead of binary ones
+ *     --timeout MS       how long to wait for an answer (default 1000)
+ *
+ * The zone names in the file or directory are asked for in a pseudo-random order. Every client
+ * has its own socket and asks again as soon as it has an answer. Prints questions and lookups
+ * per second and the latency distribution as seen by the clients. The real server only answers
+ * once per address every three seconds, so against anything but a stand-in without flood
+ * protection most questions time out: do not point this at timezoned.rop.nl.
+ */
+
+#include "tzserver.h"
+
+#include <Arduino.h>
+#include <ezTime.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+	struct options_t {
+		std::string host = "127.0.0.1";
+		uint16_t port = TIMEZONED_REMOTE_PORT;
+		bool local = false;
+		bool linear = false;
+		unsigned threads = 1;
+		unsigned clients = 4;
+		double seconds = 5;
+		unsigned batch = 1;
+		bool partial = false;
+		bool text = false;
+		int timeout = 1000;
+		std::string source = ZONEINFO_DIR;
+	};
+
+	struct client_t {
+		unsigned long questions = 0;
+		unsigned long answers = 0;
+		unsigned long timeouts = 0;
+		unsigned long bad = 0;			// answers that are not in the format asked for
+		std::vector<uint32_t> latencies;	// microseconds
+	};
+
+	bool parseArgs(int argc, char *argv[], options_t &opts) {
+		for (int n = 1; n < argc; n++) {
+			std::string arg = argv[n];
+			bool has_value = n + 1 < argc;
+			if (arg == "--host" && has_value) opts.host = argv[++n];
+			else if (arg == "--port" && has_value) opts.port = atoi(argv[++n]);
+			else if (arg == "--local") opts.local = true;
+			else if (arg == "--linear") opts.linear = true;
+			else if (arg == "--threads" && has_value) opts.threads = atoi(argv[++n]);
+			else if (arg == "--clients" && has_value) opts.clients = atoi(argv[++n]);
+			else if (arg == "--seconds" && has_value) opts.seconds = atof(argv[++n]);
+			else if (arg == "--batch" && has_value) opts.batch = atoi(argv[++n]);
+			else if (arg == "--partial") opts.partial = true;
+			else if (arg == "--text") opts.text = true;
+			else if (arg == "--timeout" && has_value) opts.timeout = atoi(argv[++n]);
+			else if (arg[0] == '-') return false;
+			else opts.source = arg;
+		}
+		return opts.clients && opts.threads && opts.batch && opts.batch <= TZSERVER_MAX_BATCH;
+	}
+
+	std::vector<std::string> queryNames(const std::vector<zoneinfo_t> &zones, const bool partial) {
+		std::vector<std::string> names;
+		for (const zoneinfo_t &zone : zones) {
+			if (!partial) {
+				names.push_back(zone.olson);
+				continue;
+			}
+			std::string name = zone.olson.substr(zone.olson.rfind('/') + 1);
+			for (char &c : name) c = tolower((unsigned char)c);
+			names.push_back(name);
+		}
+		return names;
+	}
+
+	void runClient(const options_t &opts, const struct sockaddr_in &server, const std::vector<std::string> &names,
+	               const unsigned seed, const std::chrono::steady_clock::time_point until, client_t &result) {
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0 || connect(fd, (const struct sockaddr *)&server, sizeof(server)) < 0) {
+			perror("socket");
+			return;
+		}
+		uint32_t state = seed * 2654435761U + 1;
+		char reply[1500];
+		while (std::chrono::steady_clock::now() < until) {
+			std::string question;
+			for (unsigned n = 0; n < opts.batch; n++) {
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				if (n) question += '\n';
+				question += names[state % names.size()];
+			}
+			if (!opts.text) question += TIMEZONED_QUERY_SUFFIX;
+			auto sent = std::chrono::steady_clock::now();
+			if (send(fd, question.data(), question.size(), 0) < 0) break;
+			result.questions++;
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, opts.timeout) <= 0) {
+				result.timeouts++;
+				continue;
+			}
+			ssize_t len = recv(fd, reply, sizeof(reply), 0);
+			auto received = std::chrono::steady_clock::now();
+			if (len <= 0) {
+				result.bad++;
+				continue;
+			}
+			bool binary = (uint8_t)reply[0] == TIMEZONED_BINARY_MARK;
+			bool text = !strncmp(reply, "OK ", 3) || !strncmp(reply, "ERROR ", 6);
+			if (opts.text ? !text : !binary) result.bad++;
+			result.answers++;
+			result.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(received - sent).count());
+		}
+		close(fd);
+	}
+
+	bool resolve(const std::string &host, const uint16_t port, struct sockaddr_in &addr) {
+		struct addrinfo hints, *res;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		if (getaddrinfo(host.c_str(), NULL, &hints, &res) != 0 || !res) return false;
+		addr = *(struct sockaddr_in *)res->ai_addr;
+		addr.sin_port = htons(port);
+		freeaddrinfo(res);
+		return true;
+	}
+
+	uint32_t percentile(const std::vector<uint32_t> &sorted, const double p) {
+		if (sorted.empty()) return 0;
+		return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+	}
+
+}
+
+int main(int argc, char *argv[]) {
+	options_t opts;
+	if (!parseArgs(argc, argv, opts)) {
+		fprintf(stderr, "usage: %s [--host HOST] [--port PORT] [--local [--linear] [--threads N]] [--clients N] [--seconds S]\n"
+			"       [--batch N] [--partial] [--text] [--timeout MS] [posixinfo | zoneinfo dir]\n", argv[0]);
+		return 2;
+	}
+
+	// The stand-in, if asked for, also provides the names to ask for
+	tzserver_t server;
+	if (!loadTzserver(opts.source, zone1970Path(opts.source), server)) {
+		fprintf(stderr, "No zones found in %s\n", opts.source.c_str());
+		return 2;
+	}
+	std::vector<std::string> names = queryNames(server.zones, opts.partial);
+
+	std::atomic<bool> stop(false);
+	std::thread server_thread;
+	if (opts.local) {
+		server.flood_protection = false;
+		server.indexed = !opts.linear;
+		int fd = openTzserver(0, opts.port);
+		if (fd < 0) {
+			fprintf(stderr, "Cannot open a UDP port\n");
+			return 2;
+		}
+		opts.host = "127.0.0.1";
+		server_thread = std::thread(serveTzserver, std::ref(server), fd, std::cref(stop), false, opts.threads);
+	}
+	struct sockaddr_in addr;
+	if (!resolve(opts.host, opts.port, addr)) {
+		fprintf(stderr, "Cannot resolve %s\n", opts.host.c_str());
+		return 2;
+	}
+
+	printf("%zu names, %u clients, batches of %u, %s answers, %s%s for %.1f s\n", names.size(), opts.clients, opts.batch,
+		opts.text ? "text" : "binary", opts.local ? (opts.linear ? "local scanning server" : "local indexed server") : opts.host.c_str(),
+		opts.local ? (" (" + std::to_string(opts.threads) + " threads)").c_str() : "", opts.seconds);
+	fflush(stdout);
+
+	std::vector<client_t> results(opts.clients);
+	std::vector<std::thread> clients;
+	auto started = std::chrono::steady_clock::now();
+	auto until = started + std::chrono::microseconds((long long)(opts.seconds * 1e6));
+	for (unsigned n = 0; n < opts.clients; n++) {
+		clients.push_back(std::thread(runClient, std::cref(opts), std::cref(addr), std::cref(names), n + 1, until, std::ref(results[n])));
+	}
+	for (std::thread &client : clients) client.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	stop = true;
+	if (server_thread.joinable()) server_thread.join();
+
+	client_t total;
+	for (const client_t &result : results) {
+		total.questions += result.questions;
+		total.answers += result.answers;
+		total.timeouts += result.timeouts;
+		total.bad += result.bad;
+		total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+	}
+	std::sort(total.latencies.begin(), total.latencies.end());
+
+	printf("questions %lu, answers %lu, timeouts %lu, bad answers %lu\n", total.questions, total.answers, total.timeouts, total.bad);
+	printf("%.0f questions/s, %.0f lookups/s\n", total.answers / elapsed, total.answers * opts.batch / elapsed);
+	printf("latency us: p50 %u, p90 %u, p99 %u, max %u\n", percentile(total.latencies, 0.5), percentile(total.latencies, 0.9),
+		percentile(total.latencies, 0.99), total.latencies.empty() ? 0 : total.latencies.back());
+	return (!total.answers || total.bad) ? 1 : 0;
+}
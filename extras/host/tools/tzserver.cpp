@@ -0,0 +1,295 @@
+#include "tzserver.h"
+
+#include <Arduino.h>
+#include <ezTime.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <fstream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+	std::string trim(const std::string &s) {
+		size_t begin = s.find_first_not_of(" \t\r\n");
+		if (begin == std::string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r\n");
+		return s.substr(begin, end - begin + 1);
+	}
+
+	std::string upper(std::string s) {
+		for (char &c : s) c = toupper((unsigned char)c);
+		return s;
+	}
+
+	void split(const std::string &s, const char separator, std::vector<std::string> &parts) {
+		size_t start = 0;
+		for (;;) {
+			size_t end = s.find(separator, start);
+			parts.push_back(s.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			if (end == std::string::npos) return;
+			start = end + 1;
+		}
+	}
+
+	const size_t NOT_FOUND = (size_t)-1;
+
+	// What server/server does: the first zone whose uppercase name contains the question
+	size_t findLinear(const tzserver_t &server, const std::string &process) {
+		for (size_t n = 0; n < server.zones.size(); n++) {
+			if (upper(server.zones[n].olson).find(process) != std::string::npos) return n;
+		}
+		return NOT_FOUND;
+	}
+
+	// The same answer from the suffix table: every suffix that starts with the question belongs
+	// to a name that contains it, and they are all next to each other.
+	size_t findSuffix(const tzserver_t &server, const std::string &process) {
+		size_t found = NOT_FOUND;
+		auto it = std::lower_bound(server.suffixes.begin(), server.suffixes.end(), std::make_pair(process, (size_t)0));
+		for (; it != server.suffixes.end() && it->first.compare(0, process.size(), process) == 0; ++it) {
+			if (it->second < found) found = it->second;
+		}
+		return found;
+	}
+
+	void buildIndex(tzserver_t &server) {
+		server.suffixes.clear();
+		server.exact.clear();
+		for (size_t n = 0; n < server.zones.size(); n++) {
+			std::string name = upper(server.zones[n].olson);
+			for (size_t pos = 0; pos < name.size(); pos++) server.suffixes.push_back(std::make_pair(name.substr(pos), n));
+		}
+		std::sort(server.suffixes.begin(), server.suffixes.end());
+		// An earlier zone can contain a whole later name, so even exact names are looked up properly once
+		for (const zoneinfo_t &zone : server.zones) {
+			std::string name = upper(zone.olson);
+			if (!server.exact.count(name)) server.exact[name] = findSuffix(server, name);
+		}
+	}
+
+	void appendString(std::string &out, const std::string &s) {
+		size_t len = s.size() < 255 ? s.size() : 255;
+		out += (char)len;
+		out.append(s, 0, len);
+	}
+
+	void appendInt16(std::string &out, const int16_t value) {
+		out += (char)((uint16_t)value >> 8);
+		out += (char)(value & 0xFF);
+	}
+
+	// Same layout that binRule() in ezTime.cpp reads
+	void appendRule(std::string &out, const ezRule_t &rule) {
+		appendInt16(out, rule.std_offset);
+		appendString(out, rule.std_name);
+		out += (char)rule.start_month;
+		if (!rule.start_month) return;
+		appendInt16(out, rule.dst_offset);
+		out += (char)rule.start_week;
+		out += (char)rule.start_dow;
+		appendInt16(out, rule.start_time);
+		out += (char)rule.end_month;
+		out += (char)rule.end_week;
+		out += (char)rule.end_dow;
+		appendInt16(out, rule.end_time);
+		appendString(out, rule.dst_name);
+	}
+
+	void appendBinary(std::string &out, const tzserver_t &server, const std::string &query) {
+		std::string olson, posix;
+		if (!lookupQuery(server, query, olson, posix)) {
+			out += (char)1;
+			appendString(out, olson);
+			return;
+		}
+		Timezone tz;
+		tz.setPosix(posix.c_str());
+		out += (char)0;
+		appendString(out, olson);
+		appendRule(out, tz.getRule());
+	}
+
+}
+
+bool loadTzserver(const std::string &zones, const std::string &zone1970, tzserver_t &server) {
+	if (!loadZones(zones, server.zones) || server.zones.empty()) return false;
+	std::ifstream file(zone1970);
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::vector<std::string> columns;
+		split(line, '\t', columns);
+		if (columns.size() < 3) continue;
+		std::string olson = trim(columns[2]);
+		size_t zone;
+		for (zone = 0; zone < server.zones.size() && server.zones[zone].olson != olson; zone++);
+		if (zone == server.zones.size()) continue;		// no rule for it, nothing useful to answer
+		std::vector<std::string> codes;
+		split(columns[0], ',', codes);
+		for (const std::string &code : codes) server.countries.insert(std::make_pair(trim(code), zone));
+	}
+	buildIndex(server);
+	return true;
+}
+
+std::string zone1970Path(const std::string &zones) {
+	struct stat st;
+	if (stat(zones.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) return zones + "/zone1970.tab";
+	size_t slash = zones.rfind('/');
+	return (slash == std::string::npos ? "." : zones.substr(0, slash)) + "/zone1970.tab";
+}
+
+bool lookupQuery(const tzserver_t &server, const std::string &query, std::string &olson, std::string &posix) {
+	std::string process = query;
+	for (char &c : process) if (c == ' ') c = '_';
+	process = upper(process);
+
+	if (process == "GEOIP") {
+		olson = "GeoIP Lookup Failed";
+		return false;
+	}
+	if (process == "UK") process = "GB";
+	if (process == "DE") process = "EUROPE/BERLIN";
+
+	if (process.size() == 2 && isupper((unsigned char)process[0]) && isupper((unsigned char)process[1])) {
+		auto range = server.countries.equal_range(process);
+		size_t matches = std::distance(range.first, range.second);
+		if (matches != 1) {
+			olson = matches ? "Country Spans Multiple Timezones" : "Country Not Found";
+			return false;
+		}
+		olson = server.zones[range.first->second].olson;
+		posix = server.zones[range.first->second].posix;
+		return true;
+	}
+
+	size_t found;
+	if (!server.indexed) {
+		found = findLinear(server, process);
+	} else {
+		auto exact = server.exact.find(process);
+		found = exact != server.exact.end() ? exact->second : findSuffix(server, process);
+	}
+	if (found == NOT_FOUND) {
+		olson = "Timezone Not Found";
+		return false;
+	}
+	olson = server.zones[found].olson;
+	posix = server.zones[found].posix;
+	// Same override as the real server: ezTime has no negative DST
+	if (olson == "Europe/Dublin") posix = "GMT0IST,M3.5.0/1,M10.5.0";
+	return true;
+}
+
+std::string answerQuery(const tzserver_t &server, const std::string &query) {
+	std::string olson, posix;
+	if (!lookupQuery(server, query, olson, posix)) return "ERROR " + olson;
+	return "OK " + olson + " " + posix;
+}
+
+bool answerPacket(tzserver_t &server, const std::string &packet, const uint32_t remote_ip, const time_t now, std::string &reply) {
+	server.packets++;
+	if (server.flood_protection) {
+		std::lock_guard<std::mutex> lock(server.mutex);
+		auto last = server.last_ask.find(remote_ip);
+		if (last != server.last_ask.end() && last->second > now - TZSERVER_FLOOD_SECS) {
+			server.dropped++;
+			return false;
+		}
+		server.last_ask[remote_ip] = now;
+	}
+
+	size_t hash = packet.find('#');
+	std::string query = packet.substr(0, hash);
+	std::string version = hash == std::string::npos ? "" : packet.substr(hash + 1);
+	if (!server.batches) {
+		reply = answerQuery(server, query);
+		return true;
+	}
+	std::vector<std::string> locations;
+	split(query, '\n', locations);
+	if (locations.size() > 1 && locations.back().empty()) locations.pop_back();
+	if (locations.size() > TZSERVER_MAX_BATCH) {
+		reply = "ERROR Too Many Locations";
+		return true;
+	}
+	reply.clear();
+	if (server.binary && version.compare(0, 2, "B1") == 0) {
+		reply += (char)TIMEZONED_BINARY_MARK;
+		reply += (char)TIMEZONED_BINARY_VERSION;
+		reply += (char)locations.size();
+		for (const std::string &location : locations) appendBinary(reply, server, location);
+		return true;
+	}
+	for (size_t n = 0; n < locations.size(); n++) {
+		if (n) reply += '\n';
+		reply += answerQuery(server, locations[n]);
+	}
+	return true;
+}
+
+int openTzserver(const uint16_t port, uint16_t &bound) {
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) return -1;
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	socklen_t addrlen = sizeof(addr);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || getsockname(fd, (struct sockaddr *)&addr, &addrlen) < 0) {
+		close(fd);
+		return -1;
+	}
+	bound = ntohs(addr.sin_port);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);		// several threads may wait on it
+	return fd;
+}
+
+namespace {
+
+	void serve(tzserver_t &server, const int fd, const std::atomic<bool> &stop, const bool log) {
+		char packet[1500];
+		while (!stop) {
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, 50) <= 0) continue;		// wake up now and then to look at 'stop'
+			struct sockaddr_in remote;
+			socklen_t remote_len = sizeof(remote);
+			ssize_t len = recvfrom(fd, packet, sizeof(packet), 0, (struct sockaddr *)&remote, &remote_len);
+			if (len < 0) continue;
+			std::string reply;
+			bool answered = answerPacket(server, std::string(packet, len), remote.sin_addr.s_addr, time(NULL), reply);
+			if (log) {
+				char ip[INET_ADDRSTRLEN];
+				inet_ntop(AF_INET, &remote.sin_addr, ip, sizeof(ip));
+				std::string shown(packet, len);
+				for (char &c : shown) if (c == '\n') c = '|';
+				std::string answer = answered ? reply : "(dropped, flood protection)";
+				if (answered && !reply.empty() && (uint8_t)reply[0] == TIMEZONED_BINARY_MARK) answer = "(binary, " + std::to_string(reply.size()) + " bytes)";
+				for (char &c : answer) if (c == '\n') c = '|';
+				printf("%s:%u -- %s -> %s\n", ip, ntohs(remote.sin_port), shown.c_str(), answer.c_str());
+				fflush(stdout);
+			}
+			if (answered) sendto(fd, reply.data(), reply.size(), 0, (struct sockaddr *)&remote, remote_len);
+		}
+	}
+
+}
+
+void serveTzserver(tzserver_t &server, const int fd, const std::atomic<bool> &stop, const bool log /* = false */, const unsigned threads /* = 1 */) {
+	std::vector<std::thread> extra;
+	for (unsigned n = 1; n < threads; n++) extra.push_back(std::thread(serve, std::ref(server), fd, std::cref(stop), log));
+	serve(server, fd, stop, log);
+	for (std::thread &thread : extra) thread.join();
+	close(fd);
+}
@@ -0,0 +1,68 @@
+/*
+ * A stand-in for the timezone server (server/server), so setLocation() and setLocations()
+ * can be tried and tested without asking timezoned.rop.nl. It answers the same way the PHP
+ * server does from the same 'posixinfo' and 'zone1970.tab' files, except that GeoIP lookups
+ * always fail. Clients that ask for it ("#B1" after the locations) get the binary format
+ * described in ezTime.cpp, with the rules parsed by ezTime itself.
+ *
+ * Unlike the PHP server, it does not scan every zone for every question. Exact names come out
+ * of a hash table, and partial names are found in a sorted table of every suffix of every name
+ * (a name contains the question if one of its suffixes starts with it). Either way the answer
+ * is the same zone the PHP server picks: the first one in the file that contains the question.
+ */
+
+#ifndef _TZSERVER_H_
+#define _TZSERVER_H_
+
+#include "posixinfo.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+#define TZSERVER_MAX_BATCH	10			// locations answered from one packet, as in server/server
+#define TZSERVER_FLOOD_SECS	3			// packets from the same address closer than this are dropped
+
+struct tzserver_t {
+	std::vector<zoneinfo_t> zones;					// posixinfo order, which decides partial matches
+	std::multimap<std::string, size_t> countries;	// country code -> index in zones
+	std::unordered_map<std::string, size_t> exact;	// uppercase name -> index of the zone that answers it
+	std::vector<std::pair<std::string, size_t> > suffixes;	// every suffix of every uppercase name, sorted
+	bool indexed = true;							// false scans every zone, like server/server
+	bool flood_protection = true;
+	bool batches = true;							// false answers like a server from before batches, in text
+	bool binary = true;								// false always answers in text
+	std::mutex mutex;								// for last_ask, packets may come in on several threads
+	std::map<uint32_t, time_t> last_ask;
+	std::atomic<unsigned long> packets{0};
+	std::atomic<unsigned long> dropped{0};
+};
+
+// 'zones' is a posixinfo file or zoneinfo directory. zone1970.tab is optional: without it
+// country codes are not found.
+bool loadTzserver(const std::string &zones, const std::string &zone1970, tzserver_t &server);
+
+// zone1970.tab in a zoneinfo directory, or next to a posixinfo file
+std::string zone1970Path(const std::string &zones);
+
+// Looks up one location. Returns false with the error message in 'olson' if not found.
+bool lookupQuery(const tzserver_t &server, const std::string &query, std::string &olson, std::string &posix);
+
+// "OK <olson> <posix>" or "ERROR <message>" for one location
+std::string answerQuery(const tzserver_t &server, const std::string &query);
+
+// The answer to one packet, or false if flood protection drops it
+bool answerPacket(tzserver_t &server, const std::string &packet, const uint32_t remote_ip, const time_t now, std::string &reply);
+
+// UDP socket for serveTzserver(). Port 0 picks a free one, the port used is put in 'bound'.
+int openTzserver(const uint16_t port, uint16_t &bound);
+
+// Answers packets on 'fd' with 'threads' threads until 'stop' is set, then closes it
+void serveTzserver(tzserver_t &server, const int fd, const std::atomic<bool> &stop, const bool log = false, const unsigned threads = 1);
+
+#endif // _TZSERVER_H_
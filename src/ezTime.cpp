@@ -8,6 +8,15 @@
 	#endif
 	#ifdef EZTIME_CACHE_EEPROM
 		#include <EEPROM.h>
+		#if defined(ESP32) || defined(ESP8266)
+			#define eepromBegin()	EEPROM.begin(4096)
+			#define eepromEnd()		EEPROM.end()
+			#define eepromLength()	(4096)
+		#else
+			#define eepromBegin()	""
+			#define eepromEnd()		""
+			#define eepromLength()	EEPROM.length()
+		#endif
 	#endif	
 	#if defined(ESP8266)
 		#include <ESP8266WiFi.h>
@@ -29,6 +38,10 @@
 	#endif
 #endif
 
+#ifdef EZTIME_TZDB
+	#include "ezTimeDB.h"
+#endif
+
 #if defined(EZTIME_MAX_DEBUGLEVEL_NONE)
 	#define	err(args...) 		""
 	#define	errln(args...) 		""
@@ -51,6 +64,7 @@
 	#define	debug(args...) 		""
 	#define	debugln(args...) 	""
 #else		// nothing specified compiles everything in.
+	#define EZTIME_DEBUG_COMPILED
 	#define	err(args...) 		if (_debug_level >= ERROR) _debug_device->print(args)
 	#define	errln(args...) 		if (_debug_level >= ERROR) _debug_device->println(args)
 	#define	info(args...) 		if (_debug_level >= INFO) _debug_device->print(args)
@@ -76,9 +90,86 @@ namespace {
 	uint16_t _last_read_ms;
 	timeStatus_t _time_status;
 	bool _initialised = false;
+	time_t _last_ntp_time = 0;			// not changed by setTime()
+	int16_t _drift_ppm = 0;				// millis() runs this much fast, measured between NTP updates
+	uint8_t _drift_samples = 0;
+	bool _drift_reference = false;		// the last sync came from NTP in this boot, so drift can be measured from it
+	bool _restored = false;				// time came from restoreTime(), no need to ask NTP right away
+	ezTimeSource *_sources[MAX_TIME_SOURCES];
+	uint8_t _source_count = 0;
 	#ifdef EZTIME_NETWORK_ENABLE
 		uint16_t _ntp_interval = NTP_INTERVAL;
 		String _ntp_server = NTP_SERVER;
+		uint8_t _ntp_failures = 0;			// in a row, for the backoff
+		uint8_t _ntp_slowdown = 0;			// interval is doubled this many times after "RATE"
+		bool _ntp_denied = false;			// server said "DENY" or "RSTR", not asked again until setServer()
+
+		// Where our time came from, passed on by serveNTP()
+		typedef struct {
+			uint8_t stratum;				// 0 until the time came from NTP
+			uint32_t root_delay;			// NTP short format (16.16 seconds), including our round trip
+			uint32_t root_dispersion;
+			uint8_t reference_id[4];		// the server's address
+		} ezNtpSource_t;
+		ezNtpSource_t _ntp_reply = { 0, 0, 0, { 0, 0, 0, 0 } };		// from the last queryNTP()
+		ezNtpSource_t _ntp_source = { 0, 0, 0, { 0, 0, 0, 0 } };	// from the last updateNTP()
+		bool _ntp_serving = false;
+		bool _ntp_listening = false;
+		IPAddress _ntp_broadcaster;					// the one the delay was measured for
+		bool _ntp_calibrated = false;
+		uint32_t _ntp_calibrated_millis = 0;
+		int16_t _ntp_broadcast_delay = NTP_BROADCAST_DELAY;	// milliseconds
+		uint32_t _ntp_random = 2463534242UL;
+		#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+			String _ntp_dns_name;					// name the addresses below are for
+			IPAddress _ntp_addresses[NTP_DNS_ADDRESSES];
+			uint8_t _ntp_address_count = 0;
+			uint8_t _ntp_address = 0;				// the one in use
+			uint8_t _ntp_addresses_failed = 0;		// in a row since the name was last looked up
+			uint32_t _ntp_resolved_millis = 0;
+		#endif
+		String _timezoned_host = TIMEZONED_REMOTE_HOST;
+		uint16_t _timezoned_port = TIMEZONED_REMOTE_PORT;
+		#ifdef EZTIME_CACHE_EEPROM
+			// The shared cache region from setCacheRegion(): what is in which slot, read once
+			typedef struct {
+				uint16_t key;
+				uint16_t sequence;				// the newest one for a key has its current data
+				bool valid;						// checksum was right
+			} ezCacheSlot_t;
+			int16_t _cache_region = -1;
+			uint8_t _cache_slot_count = 0;
+			ezCacheSlot_t _cache_slots[EEPROM_CACHE_SLOTS];
+			uint16_t _cache_sequence = 0;		// the newest in the region
+			uint8_t _cache_next = 0;			// slot after the newest, where the next write starts looking
+		#endif
+
+		// Background timezone lookups, oldest first. The first one is in flight if _lookup_in_flight.
+		typedef struct {
+			Timezone *tz;
+			String location;
+			void (*callback)(Timezone &tz, const bool success);
+		} ezLookup_t;
+		ezLookup_t _lookups[MAX_LOOKUPS];
+		uint8_t _lookup_count = 0;
+		bool _lookup_in_flight = false;
+		bool _lookup_ever_sent = false;
+		uint32_t _lookup_sent_millis = 0;
+		#ifndef EZTIME_ETHERNET
+			#ifndef EZTIME_WIFIESP
+				WiFiUDP _lookup_udp;
+				WiFiUDP _ntp_serve_udp;
+				WiFiUDP _ntp_listen_udp;
+			#else
+				WiFiEspUDP _lookup_udp;
+				WiFiEspUDP _ntp_serve_udp;
+				WiFiEspUDP _ntp_listen_udp;
+			#endif
+		#else
+			EthernetUDP _lookup_udp;
+			EthernetUDP _ntp_serve_udp;
+			EthernetUDP _ntp_listen_udp;
+		#endif
 	#endif
 
 	void triggerError(const ezError_t err) {
@@ -109,6 +200,926 @@ namespace {
 		return t;
 	}
 
+	// FNV-1a over everything before the checksum
+	uint32_t stateChecksum(const ezTimeState_t &state) {
+		const uint8_t *p = (const uint8_t *)&state;
+		uint32_t hash = 2166136261UL;
+		for (size_t n = 0; n < offsetof(ezTimeState_t, checksum); n++) hash = (hash ^ p[n]) * 16777619UL;
+		return hash;
+	}
+
+	// The time was t at millis() 'measured_at', says NTP or a time source good to 'precision' ms
+	void setSyncTime(const time_t t, const unsigned long measured_at, const uint16_t precision = NTP_PRECISION) {
+		int32_t correction = ( (t - _last_sync_time) * 1000 ) - ( measured_at - _last_sync_millis );
+		uint32_t elapsed = measured_at - _last_sync_millis;
+		bool precise = precision <= NTP_PRECISION;		// an RTC's whole seconds say nothing about drift
+		if (_drift_reference && precise && elapsed >= 60000UL) {
+			// Smoothed, one update's network delay says little about the clock
+			int32_t ppm = -(float)correction * 1000000.0 / elapsed;
+			if (ppm > 30000) ppm = 30000;
+			if (ppm < -30000) ppm = -30000;
+			_drift_ppm = _drift_samples ? (_drift_ppm * 3 + ppm) / 4 : ppm;
+			if (_drift_samples < 255) _drift_samples++;
+		}
+		_drift_reference = precise;
+		_last_ntp_time = t;
+		_last_sync_time = t;
+		_last_sync_millis = measured_at;
+		_last_read_ms = ( millis() - measured_at) % 1000;
+		info(F("Received time: "));
+		info(UTC.dateTime(t, F("l, d-M-y H:i:s.v T")));
+		if (_time_status != timeNotSet) {
+			info(F(" (internal clock was "));
+			if (!correction) {
+				infoln(F("spot on)"));
+			} else {
+				info(String(abs(correction)));
+				if (correction > 0) {
+					infoln(F(" ms fast)"));
+				} else {
+					infoln(F(" ms slow)"));
+				}
+			}
+		} else {
+			infoln("");
+		}
+		#ifdef EZTIME_NETWORK_ENABLE
+			_ntp_random ^= measured_at;		// differs per device by the network delay
+		#endif
+		_time_status = timeSet;
+	}
+
+	// Passes a time good to 'precision' ms on to the sources that are worse and keep time
+	void setSources(const time_t t, const unsigned long measured_at, const uint16_t precision) {
+		for (uint8_t n = 0; n < _source_count; n++) {
+			if (_sources[n]->precision() > precision) _sources[n]->setTime(t, measured_at);
+		}
+	}
+
+	// Sets the clock from the best time source that answers, if it is better than 'precision'
+	// milliseconds
+	bool syncFromSources(const uint16_t precision = 0xFFFF) {
+		ezTimeSource *sorted[MAX_TIME_SOURCES];
+		uint16_t precisions[MAX_TIME_SOURCES];
+		for (uint8_t n = 0; n < _source_count; n++) {
+			uint16_t p = _sources[n]->precision();
+			uint8_t m;
+			for (m = n; m > 0 && precisions[m - 1] > p; m--) {
+				sorted[m] = sorted[m - 1];
+				precisions[m] = precisions[m - 1];
+			}
+			sorted[m] = _sources[n];
+			precisions[m] = p;
+		}
+		for (uint8_t n = 0; n < _source_count && precisions[n] < precision; n++) {
+			time_t t;
+			unsigned long measured_at;
+			if (!sorted[n]->getTime(t, measured_at)) continue;
+			info(F("Time from a source good to ")); info(precisions[n]); infoln(F(" ms"));
+			setSyncTime(t, measured_at, precisions[n]);
+			#ifdef EZTIME_NETWORK_ENABLE
+				_ntp_source.stratum = 1;
+				_ntp_source.root_delay = 0;
+				_ntp_source.root_dispersion = ((uint32_t)precisions[n] << 16) / 1000;
+				memcpy(_ntp_source.reference_id, "LOCL", 4);
+			#endif
+			setSources(t, measured_at, precisions[n]);
+			return true;
+		}
+		return false;
+	}
+
+	// Reading the time sources every TIME_SOURCE_INTERVAL, for when there are no NTP updates
+	void updateSources() {
+		ezt::deleteEvent(updateSources);
+		syncFromSources();
+		if (_source_count) UTC.setEvent(updateSources, nowUTC(false) + TIME_SOURCE_INTERVAL);
+	}
+
+	#ifdef EZTIME_NETWORK_ENABLE
+		void removeLookup(const uint8_t n) {
+			if (n == 0 && _lookup_in_flight) {
+				_lookup_udp.stop();
+				_lookup_in_flight = false;
+			}
+			for (uint8_t m = n; m + 1 < _lookup_count; m++) _lookups[m] = _lookups[m + 1];
+			_lookup_count--;
+			_lookups[_lookup_count] = { NULL, "", NULL };
+		}
+
+		void cancelLookups(const Timezone *tz) {
+			for (uint8_t n = _lookup_count; n > 0; n--) {
+				if (_lookups[n - 1].tz == tz) removeLookup(n - 1);
+			}
+		}
+
+		// Makes 'seconds' up to NTP_JITTER percent shorter or longer at random, so that devices
+		// that were all switched on at the same moment drift apart instead of asking the NTP pool
+		// at the same moment forever. micros() is mixed in every time because random() starts
+		// from the same seed on every device, and micros() never reads quite the same.
+		uint32_t ntpJitter(const uint32_t seconds) {
+			_ntp_random ^= micros();
+			if (!_ntp_random) _ntp_random = 1;
+			_ntp_random ^= _ntp_random << 13;
+			_ntp_random ^= _ntp_random >> 17;
+			_ntp_random ^= _ntp_random << 5;
+			uint32_t spread = seconds * NTP_JITTER / 100;
+			return seconds - spread + _ntp_random % (2 * spread + 1);
+		}
+
+		#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+			// The address to send an NTP request to, without asking DNS every time. The name is
+			// looked up again after NTP_DNS_TTL seconds, but not for a retry unless every address
+			// we know has failed since the last lookup: a retry just tries the next address.
+			bool ntpAddress(const String server, IPAddress &ip) {
+				if (server != _ntp_dns_name) {
+					_ntp_dns_name = server;
+					_ntp_address_count = 0;
+				}
+				bool retry = _ntp_addresses_failed > 0;
+				bool expired = millis() - _ntp_resolved_millis > NTP_DNS_TTL * 1000UL;
+				if (!_ntp_address_count || (expired && !retry) || _ntp_addresses_failed >= _ntp_address_count) {
+					IPAddress found;
+					if (WiFi.hostByName(server.c_str(), found) == 1 && (uint32_t)found) {
+						_ntp_resolved_millis = millis();
+						_ntp_addresses_failed = 0;
+						uint8_t n;
+						for (n = 0; n < _ntp_address_count && _ntp_addresses[n] != found; n++);
+						if (n == _ntp_address_count) {
+							if (_ntp_address_count < NTP_DNS_ADDRESSES) {
+								_ntp_address_count++;
+							} else {
+								n = (_ntp_address + 1) % NTP_DNS_ADDRESSES;		// forget the one after the current one
+							}
+							_ntp_addresses[n] = found;
+						}
+						_ntp_address = n;
+					} else if (!_ntp_address_count) {
+						return false;
+					}
+				}
+				ip = _ntp_addresses[_ntp_address];
+				return true;
+			}
+
+			void ntpAddressFailed() {
+				if (!_ntp_address_count) return;
+				_ntp_address = (_ntp_address + 1) % _ntp_address_count;
+				if (_ntp_addresses_failed < 255) _ntp_addresses_failed++;
+			}
+		#endif
+
+		#ifdef EZTIME_CACHE_EEPROM
+			// True if the EEPROM from 'address' on already holds 'data'
+			bool eepromSame(const uint16_t address, const uint8_t *data, const uint8_t len) {
+				for (uint8_t n = 0; n < len; n++) {
+					if (EEPROM.read(address + n) != data[n]) return false;
+				}
+				return true;
+			}
+
+			uint16_t cacheKey(const String &key) {
+				uint32_t hash = 2166136261UL;
+				for (uint16_t n = 0; n < key.length(); n++) hash = (hash ^ (uint8_t)key.charAt(n)) * 16777619UL;
+				uint16_t folded = hash ^ (hash >> 16);
+				return folded ? folded : 1;		// 0 means not in the region
+			}
+
+			// Sequence numbers wrap around, this still says which is newer
+			bool newerSequence(const uint16_t a, const uint16_t b) { return (int16_t)(a - b) > 0; }
+
+			uint16_t slotAddress(const uint8_t n) { return _cache_region + n * EEPROM_SLOT_LEN; }
+
+			// The slot with the current data for 'key', -1 if there is none
+			int8_t cacheSlot(const uint16_t key) {
+				int8_t found = -1;
+				for (uint8_t n = 0; n < _cache_slot_count; n++) {
+					if (!_cache_slots[n].valid || _cache_slots[n].key != key) continue;
+					if (found < 0 || newerSequence(_cache_slots[n].sequence, _cache_slots[found].sequence)) found = n;
+				}
+				return found;
+			}
+
+			// Reads the slot headers and checks the checksums, between eepromBegin() and eepromEnd()
+			void scanCacheRegion() {
+				bool any = false;
+				_cache_sequence = 0;
+				_cache_next = 0;
+				for (uint8_t n = 0; n < _cache_slot_count; n++) {
+					uint16_t addr = slotAddress(n);
+					ezCacheSlot_t &slot = _cache_slots[n];
+					uint8_t checksum = 42;
+					for (uint16_t m = addr; m < addr + EEPROM_SLOT_LEN - 1; m++) checksum += EEPROM.read(m);
+					slot.valid = checksum == EEPROM.read(addr + EEPROM_SLOT_LEN - 1);
+					slot.key = EEPROM.read(addr) << 8 | EEPROM.read(addr + 1);
+					slot.sequence = EEPROM.read(addr + 2) << 8 | EEPROM.read(addr + 3);
+					if (!slot.valid) continue;
+					if (!any || newerSequence(slot.sequence, _cache_sequence)) {
+						_cache_sequence = slot.sequence;
+						_cache_next = (n + 1) % _cache_slot_count;
+					}
+					any = true;
+				}
+			}
+
+			// Where new data for 'key' goes: the first slot from _cache_next on that has nobody's
+			// current data, so writes go round all of them and the old data stays until the new
+			// is complete. Its own current slot only if there is nothing else, -1 if not even that.
+			int8_t freeSlot(const uint16_t key) {
+				int8_t current = cacheSlot(key);
+				for (uint8_t m = 0; m < _cache_slot_count; m++) {
+					uint8_t n = (_cache_next + m) % _cache_slot_count;
+					if (n == current) continue;
+					if (!_cache_slots[n].valid || cacheSlot(_cache_slots[n].key) != n) return n;
+				}
+				return current;
+			}
+		#endif
+
+		void ntpShort(uint8_t *p, const uint32_t value) {
+			for (uint8_t n = 0; n < 4; n++) p[n] = value >> (24 - 8 * n);
+		}
+
+		uint32_t readNtpShort(const uint8_t *p) {
+			return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+		}
+
+		// Our time at millis() 'at', as an NTP timestamp
+		void ntpTimestamp(uint8_t *p, const uint32_t at) {
+			uint32_t elapsed = at - _last_sync_millis;
+			ntpShort(p, _last_sync_time + elapsed / 1000 + 2208988800UL);
+			ntpShort(p + 4, (elapsed % 1000) * 4294967UL);
+		}
+
+		// Takes the time from NTP broadcasts (mode 5) that came in since the last events(). How
+		// long they take to get here is measured for the first one, and every
+		// NTP_CALIBRATE_INTERVAL after that, by asking the NTP server normally and comparing.
+		// Every broadcast puts off the next updateNTP(), so as long as they keep coming, the
+		// server is only asked for those measurements.
+		void listenNTPPackets() {
+			for (uint8_t n = 0; n < 4; n++) {
+				int size = _ntp_listen_udp.parsePacket();
+				if (!size) return;
+				uint32_t received = millis();
+				uint8_t buffer[NTP_PACKET_SIZE];
+				if (size < NTP_PACKET_SIZE || _ntp_listen_udp.read(buffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE) continue;
+				uint32_t secs = readNtpShort(buffer + 40);
+				if ((buffer[0] & 0x07) != 5 || (buffer[0] >> 6) == 3 || buffer[1] < 1 || buffer[1] > 15 || !secs) continue;
+				time_t t = secs - 2208988800UL;
+				uint16_t ms = readNtpShort(buffer + 44) / 4294967UL;
+				IPAddress from = _ntp_listen_udp.remoteIP();
+				if (!_ntp_calibrated || from != _ntp_broadcaster || millis() - _ntp_calibrated_millis > NTP_CALIBRATE_INTERVAL * 1000UL) {
+					_ntp_calibrated = true;					// also when it fails, not trying at every broadcast
+					_ntp_calibrated_millis = millis();
+					_ntp_broadcaster = from;
+					time_t true_t;
+					unsigned long true_at;
+					if (ezt::queryNTP(_ntp_server, true_t, true_at)) {
+						// What the time really was when the broadcast came in, minus what it said
+						int32_t delay = (int32_t)(true_t - t) * 1000 + (int32_t)(received - true_at) - ms;
+						if (delay > 1000 || delay < -1000) delay = NTP_BROADCAST_DELAY;	// the broadcaster's clock is off, not the network
+						_ntp_broadcast_delay = delay;
+						info(F("Broadcasts take ")); info(delay); infoln(F(" ms"));
+						setSyncTime(true_t, true_at);
+						_ntp_source = _ntp_reply;
+						t = true_t;
+					} else {
+						setSyncTime(t, received - ms - _ntp_broadcast_delay);
+					}
+				} else {
+					setSyncTime(t, received - ms - _ntp_broadcast_delay);
+					_ntp_source.stratum = buffer[1];
+					_ntp_source.root_delay = readNtpShort(buffer + 4);
+					_ntp_source.root_dispersion = readNtpShort(buffer + 8);
+					for (uint8_t m = 0; m < 4; m++) _ntp_source.reference_id[m] = from[m];
+				}
+				ezt::deleteEvent(ezt::updateNTP);
+				if (_ntp_interval) UTC.setEvent(ezt::updateNTP, t + ntpJitter((uint32_t)_ntp_interval << _ntp_slowdown));
+			}
+		}
+
+		// Answers the SNTP requests that came in since the last events(), without waiting for
+		// any. Nothing is answered until our own time came from NTP: better no answer than a
+		// wrong one, the client will ask someone else.
+		void serveNTPRequests() {
+			for (uint8_t n = 0; n < 4; n++) {
+				int size = _ntp_serve_udp.parsePacket();
+				if (!size) return;
+				uint32_t received = millis();
+				uint8_t buffer[NTP_PACKET_SIZE];
+				if (size < NTP_PACKET_SIZE || _ntp_serve_udp.read(buffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE) continue;
+				if ((buffer[0] & 0x07) != 3 || _time_status != timeSet || !_ntp_source.stratum || _ntp_source.stratum >= 15) continue;
+				buffer[0] = (buffer[0] & 0x38) | 4;				// no leap second warning, their version, mode 4 (server)
+				buffer[1] = _ntp_source.stratum + 1;
+																// buffer[2] is their poll interval, sent back as is
+				buffer[3] = 0xF6;								// precision 2^-10 seconds, we count milliseconds
+				ntpShort(buffer + 4, _ntp_source.root_delay);
+				// Our clock may drift 15 ppm since the last update, that's about one 1/65536 s per second
+				ntpShort(buffer + 8, _ntp_source.root_dispersion + (millis() - _last_sync_millis) / 1000);
+				memcpy(buffer + 12, _ntp_source.reference_id, 4);
+				memcpy(buffer + 24, buffer + 40, 8);			// their transmit timestamp is the originate timestamp
+				ntpTimestamp(buffer + 16, _last_sync_millis);
+				ntpTimestamp(buffer + 32, received);
+				ntpTimestamp(buffer + 40, millis());
+				_ntp_serve_udp.beginPacket(_ntp_serve_udp.remoteIP(), _ntp_serve_udp.remotePort());
+				_ntp_serve_udp.write(buffer, NTP_PACKET_SIZE);
+				_ntp_serve_udp.endPacket();
+			}
+		}
+	#endif
+
+	#ifdef EZTIME_TZDB
+		// Compares like the timezone server does: case-insensitive, spaces count as underscores.
+		// 'name' is in PROGMEM.
+		int8_t tzdbCompare(const char *query, const char *name) {
+			for (;; query++, name++) {
+				uint8_t a = toupper(*query);
+				if (a == ' ') a = '_';
+				uint8_t b = toupper(pgm_read_byte(name));
+				if (a != b) return (a < b) ? -1 : 1;
+				if (!a) return 0;
+			}
+		}
+
+		// Binary search of the compiled-in database for an exact Olson name
+		bool tzdbLookup(const String &location, String &olson, String &posix) {
+			int16_t lo = 0;
+			int16_t hi = TZDB_ZONES - 1;
+			while (lo <= hi) {
+				int16_t mid = (lo + hi) / 2;
+				const char *name = _tzdb_names + pgm_read_word(&_tzdb_index[mid][0]);
+				int8_t cmp = tzdbCompare(location.c_str(), name);
+				if (cmp < 0) {
+					hi = mid - 1;
+				} else if (cmp > 0) {
+					lo = mid + 1;
+				} else {
+					olson = (const __FlashStringHelper *)name;
+					posix = (const __FlashStringHelper *)(_tzdb_rules + pgm_read_word(&_tzdb_index[mid][1]));
+					return true;
+				}
+			}
+			return false;
+		}
+	#endif
+
+
+	// Copies into a caller's buffer of 'size' bytes, cut off if need be. Returns the length of
+	// all of 'text', like snprintf() does, so the caller can tell if it fit.
+	size_t copyText(char *buffer, const size_t size, const char *text) {
+		size_t len = strlen(text);
+		if (size) {
+			size_t n = len < size ? len : size - 1;
+			memcpy(buffer, text, n);
+			buffer[n] = 0;
+		}
+		return len;
+	}
+
+	// Output of the char * dateTime(). Everything is counted, what fits goes in the buffer.
+	class ezTextOut {
+		public:
+			ezTextOut(char *buffer, const size_t size) : _buffer(buffer), _size(size), _len(0) {}
+			void add(const char c) {
+				if (_len + 1 < _size) _buffer[_len] = c;
+				_len++;
+			}
+			void add(const char *text) { while (*text) add(*text++); }
+			void add(const __FlashStringHelper *text) {
+				const char *p = (const char *)text;
+				for (char c = pgm_read_byte(p); c; c = pgm_read_byte(++p)) add(c);
+			}
+			void add(const String &text) { add(text.c_str()); }
+			// With leading zeroes up to 'digits'
+			void number(uint32_t n, const uint8_t digits = 1) {
+				char reversed[10];
+				uint8_t len = 0;
+				do {
+					reversed[len++] = '0' + n % 10;
+					n /= 10;
+				} while (n);
+				for (uint8_t zeroes = len; zeroes < digits; zeroes++) add('0');
+				while (len) add(reversed[--len]);
+			}
+			size_t finish() {
+				if (_size) _buffer[_len < _size ? _len : _size - 1] = 0;
+				return _len;
+			}
+		private:
+			char *_buffer;
+			size_t _size;
+			size_t _len;
+	};
+
+	// Reads [+|-]hh[:mm[:ss]] and returns it in minutes. Seconds are ignored.
+	int16_t parseClock(const char *&p) {
+		bool negative = false;
+		if (*p == '+' || *p == '-') negative = (*p++ == '-');
+		int16_t hours = 0, minutes = 0;
+		while (isDigit(*p)) hours = hours * 10 + (*p++ - '0');
+		if (*p == ':') {
+			p++;
+			while (isDigit(*p)) minutes = minutes * 10 + (*p++ - '0');
+			if (*p == ':') {
+				p++;
+				while (isDigit(*p)) p++;
+			}
+		}
+		return negative ? -(hours * 60 + minutes) : hours * 60 + minutes;
+	}
+
+	// A name is either letters, or anything between '<' and '>'. The brackets are not part of it.
+	void parseName(const char *&p, char *name) {
+		uint8_t len = 0;
+		if (*p == '<') {
+			p++;
+			for (; *p && *p != '>'; p++) if (len < MAX_TZNAME_LEN) name[len++] = *p;
+			if (*p == '>') p++;
+		} else {
+			for (; isAlpha(*p); p++) if (len < MAX_TZNAME_LEN) name[len++] = *p;
+		}
+		name[len] = 0;
+	}
+
+	// Reads ",Mm.w.d[/time]". Only the 'M' form is supported, all zones in the tz database use it.
+	bool parseDate(const char *&p, uint8_t &month, uint8_t &week, uint8_t &dow, int16_t &time) {
+		if (*p++ != ',' || *p++ != 'M') return false;
+		month = 0;
+		while (isDigit(*p)) month = month * 10 + (*p++ - '0');
+		if (*p++ != '.' || !isDigit(*p)) return false;
+		week = *p++ - '0';
+		if (*p++ != '.' || !isDigit(*p)) return false;
+		dow = *p++ - '0';
+		time = 120;
+		if (*p == '/') {
+			p++;
+			time = parseClock(p);
+		}
+		return (month >= 1 && month <= 12 && week >= 1 && week <= 5 && dow <= 6);
+	}
+
+	// POSIX offsets are west-positive like ezTime's. The DST offset, if given, is absolute, not a shift.
+	void parsePosix(const char *posix, ezRule_t &rule) {
+		memset(&rule, 0, sizeof(rule));
+		const char *p = posix;
+		parseName(p, rule.std_name);
+		rule.std_offset = parseClock(p);
+		rule.dst_offset = rule.std_offset - 60;
+		if (!strcmp(rule.std_name, "UTC") && rule.std_offset) strcpy(rule.std_name, "???");
+		if (!*p || *p == ',') return;
+		parseName(p, rule.dst_name);
+		if (*p && *p != ',') rule.dst_offset = parseClock(p);
+		if (!parseDate(p, rule.start_month, rule.start_week, rule.start_dow, rule.start_time) ||
+			!parseDate(p, rule.end_month, rule.end_week, rule.end_dow, rule.end_time)) {
+			rule.start_month = 0;
+		}
+	}
+
+	#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_FIXED_STRINGS)
+
+		// The other way around, for rules that arrive already parsed or POSIX strings too long
+		// to keep. 'posix' has room for MAX_POSIX_LEN characters, the longest rule there is.
+		void formatNumber(char *&p, uint16_t n) {
+			if (n >= 10) formatNumber(p, n / 10);
+			*p++ = '0' + n % 10;
+		}
+
+		void formatClock(char *&p, int16_t minutes) {
+			if (minutes < 0) {
+				*p++ = '-';
+				minutes = -minutes;
+			}
+			formatNumber(p, minutes / 60);
+			if (minutes % 60) {
+				*p++ = ':';
+				*p++ = '0' + minutes % 60 / 10;
+				*p++ = '0' + minutes % 10;
+			}
+		}
+
+		void formatName(char *&p, const char *name) {
+			bool letters = *name;
+			for (const char *c = name; *c; c++) if (!isAlpha(*c)) letters = false;
+			if (!letters) *p++ = '<';
+			while (*name) *p++ = *name++;
+			if (!letters) *p++ = '>';
+		}
+
+		void formatDate(char *&p, const uint8_t month, const uint8_t week, const uint8_t dow, const int16_t time) {
+			*p++ = ',';
+			*p++ = 'M';
+			formatNumber(p, month);
+			*p++ = '.';
+			*p++ = '0' + week;
+			*p++ = '.';
+			*p++ = '0' + dow;
+			if (time != 120) {
+				*p++ = '/';
+				formatClock(p, time);
+			}
+		}
+
+		void formatPosix(const ezRule_t &rule, char *posix) {
+			char *p = posix;
+			formatName(p, rule.std_name);
+			formatClock(p, rule.std_offset);
+			if (rule.start_month) {
+				formatName(p, rule.dst_name);
+				if (rule.dst_offset != rule.std_offset - 60) formatClock(p, rule.dst_offset);
+				formatDate(p, rule.start_month, rule.start_week, rule.start_dow, rule.start_time);
+				formatDate(p, rule.end_month, rule.end_week, rule.end_dow, rule.end_time);
+			}
+			*p = 0;
+		}
+
+	#endif
+
+	#ifdef EZTIME_NETWORK_ENABLE
+
+		// Binary timezone server replies: TIMEZONED_BINARY_MARK, the format version and the number
+		// of answers. Each answer is a status byte, then either the Olson name and the rule (0) or
+		// the error message (anything else). Strings are a length byte and the characters, numbers
+		// are big-endian. The rule is the std offset and name and the DST start month, followed
+		// if that is not 0 by the DST offset, start week, weekday and time, the same four for the
+		// end, and the DST name.
+		bool binByte(const uint8_t *&p, const uint8_t *end, uint8_t &value) {
+			if (p >= end) return false;
+			value = *p++;
+			return true;
+		}
+
+		bool binInt16(const uint8_t *&p, const uint8_t *end, int16_t &value) {
+			if (end - p < 2) return false;
+			value = (int16_t)((p[0] << 8) | p[1]);
+			p += 2;
+			return true;
+		}
+
+		bool binString(const uint8_t *&p, const uint8_t *end, String &s) {
+			uint8_t len;
+			if (!binByte(p, end, len) || end - p < len) return false;
+			s = "";
+			s.reserve(len);
+			while (len--) s += (char)*p++;
+			return true;
+		}
+
+		bool binName(const uint8_t *&p, const uint8_t *end, char *name) {
+			uint8_t len;
+			if (!binByte(p, end, len) || end - p < len) return false;
+			for (uint8_t n = 0; n < len; n++, p++) if (n < MAX_TZNAME_LEN) *name++ = *p;
+			*name = 0;
+			return true;
+		}
+
+		bool binRule(const uint8_t *&p, const uint8_t *end, ezRule_t &rule) {
+			memset(&rule, 0, sizeof(rule));
+			if (!binInt16(p, end, rule.std_offset) || !binName(p, end, rule.std_name) || !binByte(p, end, rule.start_month)) return false;
+			rule.dst_offset = rule.std_offset - 60;
+			if (!rule.start_month) return true;
+			return binInt16(p, end, rule.dst_offset) &&
+				binByte(p, end, rule.start_week) && binByte(p, end, rule.start_dow) && binInt16(p, end, rule.start_time) &&
+				binByte(p, end, rule.end_month) && binByte(p, end, rule.end_week) && binByte(p, end, rule.end_dow) && binInt16(p, end, rule.end_time) &&
+				binName(p, end, rule.dst_name) &&
+				rule.start_month <= 12 && rule.end_month >= 1 && rule.end_month <= 12 &&
+				rule.start_week >= 1 && rule.start_week <= 5 && rule.end_week >= 1 && rule.end_week <= 5 &&
+				rule.start_dow <= 6 && rule.end_dow <= 6;
+		}
+
+		// Number of answers in a reply, 0 if it makes no sense. Moves p past a binary header.
+		uint8_t replyAnswers(const uint8_t *&p, const uint8_t *end, bool &binary) {
+			binary = (p < end && *p == TIMEZONED_BINARY_MARK);
+			if (binary) {
+				if (end - p < 3 || p[1] != TIMEZONED_BINARY_VERSION) return 0;
+				p += 3;
+				return p[-1];
+			}
+			uint8_t lines = 1;
+			for (const uint8_t *c = p; c < end; c++) if (*c == '\n') lines++;
+			return lines;
+		}
+
+		#ifdef EZTIME_CACHE_EEPROM
+			// The EEPROM cache stores the rule like a binary reply does, so binRule() reads it
+			// back. These write it.
+			void binPutInt16(uint8_t *&p, const int16_t value) {
+				*p++ = value >> 8;
+				*p++ = value;
+			}
+
+			void binPutName(uint8_t *&p, const char *name) {
+				uint8_t len = strlen(name);
+				*p++ = len;
+				memcpy(p, name, len);
+				p += len;
+			}
+
+			// At most 2 * (MAX_TZNAME_LEN + 1) + 14 bytes
+			void binPutRule(uint8_t *&p, const ezRule_t &rule) {
+				binPutInt16(p, rule.std_offset);
+				binPutName(p, rule.std_name);
+				*p++ = rule.start_month;
+				if (!rule.start_month) return;
+				binPutInt16(p, rule.dst_offset);
+				*p++ = rule.start_week;
+				*p++ = rule.start_dow;
+				binPutInt16(p, rule.start_time);
+				*p++ = rule.end_month;
+				*p++ = rule.end_week;
+				*p++ = rule.end_dow;
+				binPutInt16(p, rule.end_time);
+				binPutName(p, rule.dst_name);
+			}
+
+			// The Olson name after it is 6-bit codes, four in three bytes, ending with code 0.
+			// 1 - 26 are letters, 27 - 36 digits, then "/_-+". A letter is a capital at the start
+			// and after '/', '_' or '-', and lower case anywhere else, unless CACHE_FLIP comes
+			// before it. The most common beginnings of names are one code each, from CACHE_PREFIX on.
+			const char _cache_punctuation[] = "/_-+";
+			const uint8_t CACHE_FLIP = 41;
+			const uint8_t CACHE_PREFIX = 42;
+			const uint8_t CACHE_PREFIXES = 18;
+			const char _cache_prefixes[] PROGMEM =
+				"America/Argentina/\0" "America/Indiana/\0" "America/Kentucky/\0" "America/North_Dakota/\0"
+				"America/\0" "Asia/\0" "Europe/\0" "Africa/\0" "Pacific/\0" "Etc/\0" "Australia/\0"
+				"Antarctica/\0" "Atlantic/\0" "Indian/\0" "Arctic/\0" "US/\0" "Canada/\0" "Brazil/";
+
+			bool cachePutCode(uint8_t *&p, const uint8_t *end, uint16_t &bits, uint8_t &count, const uint8_t code) {
+				bits = bits << 6 | code;
+				count += 6;
+				if (count < 8) return true;
+				if (p >= end) return false;
+				count -= 8;
+				*p++ = bits >> count;
+				return true;
+			}
+
+			// False if it does not fit before 'end', or has characters there are no codes for
+			bool cachePutName(uint8_t *p, const uint8_t *end, const char *name) {
+				uint16_t bits = 0;
+				uint8_t count = 0;
+				const char *prefix = _cache_prefixes;
+				for (uint8_t n = 0; n < CACHE_PREFIXES; n++) {
+					uint8_t len = 0;
+					while (pgm_read_byte(prefix + len) && pgm_read_byte(prefix + len) == name[len]) len++;
+					if (!pgm_read_byte(prefix + len)) {
+						if (!cachePutCode(p, end, bits, count, CACHE_PREFIX + n)) return false;
+						name += len;
+						break;
+					}
+					while (pgm_read_byte(prefix)) prefix++;
+					prefix++;
+				}
+				bool capital = true;
+				for (; *name; name++) {
+					char c = *name;
+					uint8_t code;
+					if (isAlpha(c)) {
+						if ((isupper(c) != 0) != capital && !cachePutCode(p, end, bits, count, CACHE_FLIP)) return false;
+						code = tolower(c) - 'a' + 1;
+					} else if (isDigit(c)) {
+						code = c - '0' + 27;
+					} else {
+						const char *punctuation = strchr(_cache_punctuation, c);
+						if (!punctuation) return false;
+						code = punctuation - _cache_punctuation + 37;
+					}
+					if (!cachePutCode(p, end, bits, count, code)) return false;
+					capital = (c == '/' || c == '_' || c == '-');
+				}
+				if (!cachePutCode(p, end, bits, count, 0)) return false;
+				if (count) {
+					if (p >= end) return false;
+					*p = bits << (8 - count);
+				}
+				return true;
+			}
+
+			// The other way around, into 'name' which has room for 'size' - 1 characters
+			bool cacheGetName(const uint8_t *p, const uint8_t *end, char *name, const uint8_t size) {
+				uint16_t bits = 0;
+				uint8_t count = 0;
+				uint8_t len = 0;
+				bool capital = true;
+				bool flip = false;
+				for (;;) {
+					if (count < 6) {
+						if (p >= end) return false;
+						bits = bits << 8 | *p++;
+						count += 8;
+					}
+					count -= 6;
+					uint8_t code = bits >> count & 0x3F;
+					if (!code) break;
+					if (code == CACHE_FLIP) {
+						flip = true;
+						continue;
+					}
+					if (code >= CACHE_PREFIX) {
+						if (code >= CACHE_PREFIX + CACHE_PREFIXES) return false;
+						const char *prefix = _cache_prefixes;
+						for (uint8_t n = CACHE_PREFIX; n < code; n++) {
+							while (pgm_read_byte(prefix)) prefix++;
+							prefix++;
+						}
+						for (; pgm_read_byte(prefix); prefix++) {
+							if (len >= size - 1) return false;
+							name[len++] = pgm_read_byte(prefix);
+						}
+						capital = true;
+						continue;
+					}
+					char c;
+					if (code <= 26) {
+						c = 'a' + code - 1;
+						if (capital != flip) c -= 'a' - 'A';
+					} else if (code <= 36) {
+						c = '0' + code - 27;
+					} else {
+						c = _cache_punctuation[code - 37];
+					}
+					if (len >= size - 1) return false;
+					name[len++] = c;
+					capital = (c == '/' || c == '_' || c == '-');
+					flip = false;
+				}
+				name[len] = 0;
+				return len;
+			}
+		#endif
+
+	#endif
+
+	#ifndef EZTIME_FIXED_STRINGS
+		// The rules Timezones share (see ezSharedRule). UTC is always there, so a new Timezone
+		// never needs the heap.
+		ezRuleRecord_t _utc_rule = { { 0, -60, 0, 0, 0, 0, 0, 0, 0, 0, "UTC", "" }, 0, 0, 0, 0, "UTC", NULL, 1 };
+		ezRuleRecord_t *_rule_pool = &_utc_rule;
+	#endif
+
+	// When DST starts and ends under 'rule' in 'year', in local time or UTC. The time of day is
+	// added after finding the day because it can be negative or over 24 hours.
+	void ruleTransitions(const ezRule_t &rule, const uint16_t year, const ezLocalOrUTC_t local_or_utc, time_t &dst_start, time_t &dst_end) {
+		dst_start = ezCalendar::seconds(ezCalendar::ordinalDay(rule.start_week, rule.start_dow + 1, rule.start_month, year), 0, 0, 0) + rule.start_time * 60LL;
+		dst_end = ezCalendar::seconds(ezCalendar::ordinalDay(rule.end_week, rule.end_dow + 1, rule.end_month, year), 0, 0, 0) + rule.end_time * 60LL;
+		if (local_or_utc == UTC_TIME) {
+			dst_start += rule.std_offset * 60LL;
+			dst_end += rule.dst_offset * 60LL;
+		}
+	}
+
+	void ruleOffset(ezRuleRecord_t &record, const time_t t, const ezLocalOrUTC_t local_or_utc, bool &is_dst, int16_t &offset) {
+		const ezRule_t &rule = record.rule;
+		is_dst = false;
+		offset = rule.std_offset;
+		if (!rule.start_month) return;
+
+		// DST start and end are worked out once for the year t is in, and kept with the rule
+		// for every Timezone that shares it
+		if (t < record.year_start || t >= record.year_end) {
+			tmElements_t tm;
+			ezt::breakTime(t, tm);
+			record.year_start = ezCalendar::seconds(ezCalendar::days(tm.Year + 1970, 1, 1), 0, 0, 0);
+			record.year_end = ezCalendar::seconds(ezCalendar::days(tm.Year + 1971, 1, 1), 0, 0, 0);
+			ruleTransitions(rule, tm.Year + 1970, UTC_TIME, record.dst_start, record.dst_end);
+		}
+		time_t dst_start = record.dst_start;
+		time_t dst_end = record.dst_end;
+		if (local_or_utc == LOCAL_TIME) {
+			dst_start -= rule.std_offset * 60LL;
+			dst_end -= rule.dst_offset * 60LL;
+		}
+		if (dst_end > dst_start) {
+			is_dst = (t >= dst_start && t < dst_end);		// northern hemisphere
+		} else {
+			is_dst = !(t >= dst_end && t < dst_start);		// southern hemisphere
+		}
+		if (is_dst) offset = rule.dst_offset;
+	}
+
+	// Nearest DST start or end under 'rule' after UTC time t, or at or before it if 'after' is false
+	bool ruleChange(const ezRule_t &rule, const time_t t, const bool after, time_t &change) {
+		if (!rule.start_month) return false;
+		tmElements_t tm;
+		ezt::breakTime(t, tm);
+		bool found = false;
+		#ifdef EZTIME_64BIT_TIME
+			const uint16_t first = tm.Year + 1969;
+		#else
+			const uint16_t first = tm.Year ? tm.Year + 1969 : 1970;		// 1969 would wrap around
+		#endif
+		for (uint16_t year = first; year <= tm.Year + 1971; year++) {
+			time_t candidates[2];
+			ruleTransitions(rule, year, UTC_TIME, candidates[0], candidates[1]);
+			for (uint8_t n = 0; n < 2; n++) {
+				time_t c = candidates[n];
+				if (after ? (c > t && (!found || c < change)) : (c <= t && (!found || c > change))) {
+					change = c;
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+
+	// 'tm' moved by an offset, carrying into the day, month and year. Cheaper than breakTime()
+	// for each zone when many look at the same instant.
+	void shiftTime(tmElements_t &tm, const int16_t minutes) {
+		int16_t m = tm.Hour * 60 + tm.Minute + minutes;
+		while (m < 0) {
+			m += 24 * 60;
+			tm.Wday = (tm.Wday + 5) % 7 + 1;
+			if (!--tm.Day) {
+				if (!--tm.Month) {
+					tm.Month = 12;
+					tm.Year--;
+				}
+				tm.Day = (tm.Month == 2 && LEAP_YEAR(tm.Year)) ? 29 : monthDays[tm.Month - 1];
+			}
+		}
+		while (m >= 24 * 60) {
+			m -= 24 * 60;
+			tm.Wday = tm.Wday % 7 + 1;
+			if (++tm.Day > ((tm.Month == 2 && LEAP_YEAR(tm.Year)) ? 29 : monthDays[tm.Month - 1])) {
+				tm.Day = 1;
+				if (++tm.Month > 12) {
+					tm.Month = 1;
+					tm.Year++;
+				}
+			}
+		}
+		tm.Hour = m / 60;
+		tm.Minute = m % 60;
+	}
+
+	inline int32_t newYearsDay(const int16_t year) { return ezCalendar::days(year, 1, 1); }
+
+	// Now this is where this gets a little obscure. The ISO year can be different from the
+	// actual (Gregorian) year. That is: you can be in january and still be in week 53 of past
+	// year, _and_ you can be in december and be in week one of the next. The ISO 8601
+	// definition for week 01 is the week with the Gregorian year's first Thursday in it.
+	// See https://en.wikipedia.org/wiki/ISO_week_date
+	//
+	// So a day's ISO year is the Gregorian year of the Thursday in its week, and its week is
+	// how many Thursdays that year had up to then. All from 'days' since 1970 in Gregorian
+	// 'year', with nothing but arithmetic. 'yday' is the day of the Gregorian year from 0.
+	void isoDate(const int32_t days, const int16_t year, uint16_t &yday, uint8_t &week, int16_t &iso_year) {
+		const int32_t jan_1st = newYearsDay(year);
+		yday = days - jan_1st;
+		const int32_t thursday = days - (days % 7 + 10) % 7 + 3;		// Jan 1st 1970 was a Thursday
+		iso_year = year;
+		int32_t iso_jan_1st = jan_1st;
+		if (thursday < jan_1st) {
+			iso_jan_1st = newYearsDay(--iso_year);
+		} else if (thursday >= newYearsDay(year + 1)) {
+			iso_jan_1st = newYearsDay(++iso_year);
+		}
+		week = (thursday - iso_jan_1st) / 7 + 1;
+	}
+
+	#define BUCKET_SPAN		0x40000000L		// seconds either side of a run's first time that fit its 32-bit sums
+
+	// Where each time in a run is in its hour, day, week or month, counted back to the start of
+	// it. 'since' holds seconds since 'base' on the way in, a Monday 00:00 local time whose
+	// day number is 'base_day', and the seconds to take off on the way out. Each case is one
+	// loop of 32-bit arithmetic without branches or calls, so the compiler can vectorise it.
+	void bucketSince(uint32_t *since, const size_t count, const int32_t base_day, const ezBucket_t bucket) {
+		const uint32_t day = SECS_PER_DAY;
+		switch (bucket) {
+			case BUCKET_HOUR:
+				for (size_t n = 0; n < count; n++) since[n] = since[n] % 3600;
+				break;
+			case BUCKET_DAY:
+				for (size_t n = 0; n < count; n++) since[n] = since[n] % day;
+				break;
+			case BUCKET_WEEK:
+				for (size_t n = 0; n < count; n++) since[n] = since[n] % (7 * day);
+				break;
+			case BUCKET_MONTH:
+				// Day of the month from the day number, the way Howard Hinnant's civil_from_days does
+				// it: counting from March 1st of year 0, so February comes last and leap days don't matter
+				for (size_t n = 0; n < count; n++) {
+					const uint32_t z = base_day + since[n] / day + 719468;
+					const uint32_t doe = z % 146097;											// day of the 400-year era
+					const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;	// year of the era
+					const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);				// day of that year
+					const uint32_t mp = (5 * doy + 2) / 153;									// month, March is 0
+					since[n] = (doy - (153 * mp + 2) / 5) * day + since[n] % day;
+				}
+				break;
+		}
+	}
+
+	// TZif files are big-endian
+	int64_t tzifInt(const uint8_t *p, const uint8_t size) {
+		int64_t value = (p[0] & 0x80) ? -1 : 0;
+		for (uint8_t n = 0; n < size; n++) value = (value << 8) | p[n];
+		return value;
+	}
+
+	// The reference count goes in front of the payload, padded so the payload is aligned for time_t
+	const uint8_t SHARED_BLOCK_HEADER = 8;
+
 }
 
 
@@ -131,6 +1142,12 @@ namespace ezt {
 			case TOO_MANY_EVENTS: return		F("Too many events");
 			case INVALID_DATA: return			F("Invalid data received from NTP server");
 			case SERVER_ERROR: return			_server_error; 
+			case INVALID_TZIF: return			F("Invalid TZif data");
+			case TOO_MANY_LOOKUPS: return		F("Too many lookups");
+			case NTP_RATE_LIMITED: return		F("NTP server asks to slow down");
+			case NTP_DENIED: return				F("NTP server denies access");
+			case TOO_MANY_SOURCES: return		F("Too many time sources");
+			case OUT_OF_MEMORY: return			F("Out of memory");
 			default: return						F("Unkown error");
 		}
 	}
@@ -169,11 +1186,100 @@ namespace ezt {
 
 	timeStatus_t timeStatus() { return _time_status; }
 
+	bool addTimeSource(ezTimeSource &source) {
+		for (uint8_t n = 0; n < _source_count; n++) {
+			if (_sources[n] == &source) return true;
+		}
+		if (_source_count >= MAX_TIME_SOURCES) { triggerError(TOO_MANY_SOURCES); return false; }
+		_sources[_source_count++] = &source;
+		if (!_initialised) return true;		// events() will get to it
+		#ifdef EZTIME_NETWORK_ENABLE
+			if (_ntp_interval && !_ntp_denied) {
+				// updateNTP() will use it, but no need to wait for that if we don't know the time
+				if (_time_status == timeNotSet) syncFromSources();
+				return true;
+			}
+		#endif
+		updateSources();
+		return true;
+	}
+
+	void removeTimeSource(ezTimeSource &source) {
+		for (uint8_t n = 0; n < _source_count; n++) {
+			if (_sources[n] != &source) continue;
+			for (uint8_t m = n; m + 1 < _source_count; m++) _sources[m] = _sources[m + 1];
+			_source_count--;
+			return;
+		}
+	}
+
+	bool saveTime(ezTimeState_t &state) {
+		if (_time_status == timeNotSet) return false;
+		state.magic = RESTORE_MAGIC;
+		state.time = nowUTC();
+		state.ms = _last_read_ms;
+		state.drift = _drift_ppm;
+		state.last_sync = _last_ntp_time;
+		state.checksum = stateChecksum(state);
+		return true;
+	}
+
+	bool restoreTime(const ezTimeState_t &state, const uint32_t slept_ms /* = RESTORE_UNKNOWN */) {
+		if (state.magic != RESTORE_MAGIC || state.checksum != stateChecksum(state)) return false;
+		bool unknown = slept_ms == RESTORE_UNKNOWN;
+		// The time at millis() 0, which is when we woke up
+		uint32_t total_ms = state.ms + (unknown ? 0 : slept_ms);
+		time_t t = state.time + total_ms / 1000;
+		int32_t ms = total_ms % 1000;
+		// millis() was off by the drift since the last update when it was saved, take that off
+		int32_t drift_ms = 0;
+		if (state.last_sync && state.time > state.last_sync && state.time - state.last_sync < 7 * SECS_PER_DAY) {
+			drift_ms = (float)state.drift * (state.time - state.last_sync) / 1000;
+		}
+		ms -= drift_ms;
+		t += ms / 1000;
+		ms %= 1000;
+		if (ms < 0) {
+			ms += 1000;
+			t--;
+		}
+		_last_sync_time = t;
+		_last_sync_millis = (uint32_t)0 - (uint32_t)ms;
+		_last_ntp_time = state.last_sync;
+		_drift_ppm = state.drift;
+		_drift_samples = state.drift ? 1 : 0;
+		_drift_reference = false;
+		// How far off could it be? Half the drift correction, and whatever the sleep timer was off
+		uint32_t uncertainty = abs(drift_ms) / 2 + (unknown ? 0 : slept_ms / 1000 * RESTORE_SLEEP_PPM / 1000);
+		bool sure = !unknown && state.last_sync && uncertainty <= RESTORE_MAX_ERROR;
+		#ifdef EZTIME_NETWORK_ENABLE
+			if (_ntp_interval && nowUTC(false) > state.last_sync + _ntp_interval + NTP_STALE_AFTER) sure = false;
+		#endif
+		_time_status = sure ? timeSet : timeNeedsSync;
+		_restored = sure;
+		info(F("Time restored: "));
+		info(UTC.dateTime(nowUTC(false), F("l, d-M-y H:i:s.v T")));
+		info(F(", could be ")); info(uncertainty); info(F(" ms off"));
+		infoln(sure ? F("") : F(", needs sync"));
+		return true;
+	}
+
 	void events() {
 		if (!_initialised) {
 			for (uint8_t n = 0; n < MAX_EVENTS; n++) _events[n] = { 0, NULL };
 			#ifdef EZTIME_NETWORK_ENABLE
-				if (_ntp_interval) updateNTP();	// Start the cycle of updateNTP running and then setting an event for its next run
+				if (_ntp_interval && _restored) {
+					// Time restored after a reset or deep sleep: update when due, but not before NTP_RETRY
+					time_t due = _last_ntp_time + ntpJitter(_ntp_interval);
+					if (due < nowUTC(false) + NTP_RETRY) due = nowUTC(false) + ntpJitter(NTP_RETRY);
+					UTC.setEvent(updateNTP, due);
+				} else if (_ntp_interval) {
+					updateNTP();	// Start the cycle of updateNTP running and then setting an event for its next run
+				} else {
+					updateSources();
+				}
+			#else
+				updateSources();
 			#endif
 			_initialised = true;
 		}
@@ -186,6 +1292,11 @@ namespace ezt {
 				(tmp)();						// execute the function
 			}
 		}
+		#ifdef EZTIME_NETWORK_ENABLE
+			Timezone::lookupEvents();
+			if (_ntp_serving) serveNTPRequests();
+			if (_ntp_listening) listenNTPPackets();
+		#endif
 		yield();
 	}
 
@@ -205,131 +1316,33 @@ namespace ezt {
 		}
 	}
 
-	void breakTime(const time_t timeInput, tmElements_t &tm){
-		// break the given time_t into time components
-		// this is a more compact version of the C library localtime function
-		// note that year is offset from 1970 !!!
-
-		uint8_t year;
-		uint8_t month, monthLength;
-		uint32_t time;
-		unsigned long days;
+	void breakTime(const time_t timeInput, tmElements_t &tm) { tm = breakTime(timeInput); }
 
-		time = (uint32_t)timeInput;
-		tm.Second = time % 60;
-		time /= 60; // now it is minutes
-		tm.Minute = time % 60;
-		time /= 60; // now it is hours
-		tm.Hour = time % 24;
-		time /= 24; // now it is days
-		tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1 
+	time_t makeTime(tmElements_t &tm) { return ezCalendar::seconds(ezCalendar::days(tm.Year + 1970, tm.Month, tm.Day), tm.Hour, tm.Minute, tm.Second); }
 
-		year = 0;  
-		days = 0;
-		while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
-			year++;
+	// The same instant in every zone: the time is read and taken apart once, each zone only
+	// adds its offset. Returns the UTC time they are all for.
+	time_t localTimes(Timezone *zones[], ezLocalTime_t times[], const uint8_t count, time_t t /* = TIME_NOW */) {
+		if (t == TIME_NOW) {
+			t = nowUTC();
+		} else if (t == LAST_READ) {
+			t = _last_read_t;
 		}
-		tm.Year = year; // year is offset from 1970 
-
-		days -= LEAP_YEAR(year) ? 366 : 365;
-		time  -= days; // now it is days in this year, starting at 0
-
-		days=0;
-		month=0;
-		monthLength=0;
-		for (month=0; month<12; month++) {
-			if (month==1) { // february
-				if (LEAP_YEAR(year)) {
-					monthLength=29;
-				} else {
-					monthLength=28;
-				}
-			} else {
-				monthLength = monthDays[month];
-			}
-
-			if (time >= monthLength) {
-				time -= monthLength;
-			} else {
-				break;
-			}
-		}
-		tm.Month = month + 1;  // jan is month 1  
-		tm.Day = time + 1;     // day of month
-	}
-
-	time_t makeTime(const uint8_t hour, const uint8_t minute, const uint8_t second, const uint8_t day, const uint8_t month, const uint16_t year) {
 		tmElements_t tm;
-		tm.Hour = hour;
-		tm.Minute = minute;
-		tm.Second = second;
-		tm.Day = day;
-		tm.Month = month;
-		if (year > 68) {			// time_t cannot reach beyond 68 + 1970 anyway, so if bigger user means actual years
-			tm.Year = year - 1970;
-		} else {
-			tm.Year = year;
-		}
-		return makeTime(tm);
-	}
-
-	time_t makeTime(tmElements_t &tm){
-	// assemble time elements into time_t 
-	// note year argument is offset from 1970 (see macros in time.h to convert to other formats)
-	// previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
-	
-		int i;
-		uint32_t seconds;
-
-		// seconds from 1970 till 1 jan 00:00:00 of the given year
-		seconds= tm.Year * SECS_PER_DAY * 365UL;
-
-		for (i = 0; i < tm.Year; i++) {
-			if (LEAP_YEAR(i)) {
-			  seconds +=  SECS_PER_DAY;   // add extra days for leap years
-			}
-		}
-
-		// add days for this year, months start from 1
-		for (i = 1; i < tm.Month; i++) {
-			if ( (i == 2) && LEAP_YEAR(tm.Year)) { 
-			  seconds += SECS_PER_DAY * 29UL;
-			} else {
-			  seconds += SECS_PER_DAY * (uint32_t)monthDays[i-1];  //monthDay array starts from 0
+		breakTime(t, tm);
+		for (uint8_t n = 0; n < count; n++) {
+			ezLocalTime_t &local = times[n];
+			local.local = zones[n]->convert(t, UTC_TIME, local.tzname, local.is_dst, local.offset);
+			// Without EZTIME_64BIT_TIME, an offset can carry the local time past either end of
+			// 32-bit time, from 1970 into 2106 or back: those take it apart like dateTime() does
+			const int32_t days = ezCalendar::dayOf(local.local) - ezCalendar::dayOf(t);
+			if (days > 1 || days < -1) {
+				breakTime(local.local, local.tm);
+				continue;
 			}
+			local.tm = tm;
+			shiftTime(local.tm, -local.offset);
 		}
-	
-		seconds+= (tm.Day-1) * SECS_PER_DAY;
-		seconds+= tm.Hour * 3600UL;
-		seconds+= tm.Minute * 60UL;
-		seconds+= tm.Second;
-		
-		return (time_t)seconds; 
-	}
-
-	// makeOrdinalTime allows you to resolve "second thursday in September in 2018" into a number of seconds since 1970
-	// (Very useful for the timezone calculations that ezTime does internally) 
-	// If ordinal is 0 or 5 it is taken to mean "the last $wday in $month"
-	time_t makeOrdinalTime(const uint8_t hour, const uint8_t minute, uint8_t const second, uint8_t ordinal, const uint8_t wday, const uint8_t month, uint16_t year) {
-		if (year <= 68 ) year = 1970 + year;		// fix user intent
-		uint8_t m = month;   
-		uint8_t w = ordinal;
-		if (w == 5) {	
-			ordinal = 0;
-			w = 0;
-		}
-		if (w == 0) {			// is this a "Last week" rule?
-			if (++m > 12) {		// yes, for "Last", go to the next month
-				m = 1;
-				++year;
-			}
-			w = 1;               // and treat as first week of next month, subtract 7 days later
-		}
-		time_t t = makeTime(hour, minute, second, 1, m, year);
-		// add offset from the first of the month to weekday, and offset for the given week
-		t += ( (wday - UTC.weekday(t) + 7) % 7 + (w - 1) * 7 ) * SECS_PER_DAY;
-		// back up a week if this is a "Last" rule
-		if (ordinal == 0) t -= 7 * SECS_PER_DAY;
 		return t;
 	}
 
@@ -341,21 +1354,9 @@ namespace ezt {
 		return out;
 	}
 
-	time_t compileTime(const String compile_date /* = __DATE__ */, const String compile_time /* = __TIME__ */) {
-	
-		uint8_t hrs = compile_time.substring(0,2).toInt();
-		uint8_t min = compile_time.substring(3,5).toInt();
-		uint8_t sec = compile_time.substring(6).toInt();
-		uint8_t day = compile_date.substring(4,6).toInt();
-		int16_t year = compile_date.substring(7).toInt();
-		String iterate_month;
-		for (uint8_t month = 1; month < 13; month++) {
-			iterate_month = monthStr(month);
-			if ( iterate_month.substring(0,3) == compile_date.substring(0,3) ) {
-				return makeTime(hrs, min, sec, day, month, year);
-			}
-		}
-		return 0;
+	time_t compileTime(const String compile_date, const String compile_time /* = __TIME__ */) {
+		if (compile_date.length() < 11 || compile_time.length() < 8) return 0;
+		return compileTime(compile_date.c_str(), compile_time.c_str());
 	}
 
 	bool secondChanged() {
@@ -375,37 +1376,45 @@ namespace ezt {
 
 		void updateNTP() {
 			deleteEvent(updateNTP);	// Delete any events pointing here, in case called manually
+			if (syncFromSources(NTP_PRECISION)) {
+				// A time source that is better than NTP, no need to ask
+				if (_ntp_interval) UTC.setEvent(updateNTP, nowUTC(false) + _ntp_interval);
+				return;
+			}
+			if (_ntp_denied) {
+				updateSources();
+				return;
+			}
 			time_t t;
 			unsigned long measured_at;
 			if (queryNTP(_ntp_server, t, measured_at)) {
-				int32_t correction = ( (t - _last_sync_time) * 1000 ) - ( measured_at - _last_sync_millis );
-				_last_sync_time = t;
-				_last_sync_millis = measured_at;
-				_last_read_ms = ( millis() - measured_at) % 1000;
-				info(F("Received time: "));
-				info(UTC.dateTime(t, F("l, d-M-y H:i:s.v T")));
-				if (_time_status != timeNotSet) {
-					info(F(" (internal clock was "));
-					if (!correction) {
-						infoln(F("spot on)"));
-					} else {
-						info(String(abs(correction)));
-						if (correction > 0) {
-							infoln(F(" ms fast)"));
-						} else {
-							infoln(F(" ms slow)"));
-						}
-					}
-				} else {
-					infoln("");
-				}
-				if (_ntp_interval) UTC.setEvent(updateNTP, t + _ntp_interval);
-				_time_status = timeSet;
+				setSyncTime(t, measured_at);
+				setSources(t, measured_at, NTP_PRECISION);
+				_ntp_failures = 0;
+				_ntp_source = _ntp_reply;
+				if (_ntp_interval) UTC.setEvent(updateNTP, t + ntpJitter((uint32_t)_ntp_interval << _ntp_slowdown));
+				if (_ntp_slowdown) _ntp_slowdown--;		// and back to normal one step at a time
 			} else {
+				syncFromSources();		// a worse source is still better than nothing
 			        if ( nowUTC(false) > _last_sync_time + _ntp_interval + NTP_STALE_AFTER ) {
 			        	_time_status = timeNeedsSync;
 			        }
-				UTC.setEvent(updateNTP, nowUTC(false) + NTP_RETRY);
+				uint32_t wait;
+				if (_last_error == NTP_DENIED) {
+					_ntp_denied = true;
+					if (_source_count) UTC.setEvent(updateSources, nowUTC(false) + TIME_SOURCE_INTERVAL);
+					return;
+				} else if (_last_error == NTP_RATE_LIMITED) {
+					if (_ntp_slowdown < NTP_MAX_SLOWDOWN) _ntp_slowdown++;
+					wait = (uint32_t)(_ntp_interval ? _ntp_interval : NTP_INTERVAL) << _ntp_slowdown;
+				} else {
+					// Exponential backoff, but never waiting longer than a normal update would
+					uint32_t max_wait = (_ntp_interval && _ntp_interval < NTP_RETRY_MAX) ? _ntp_interval : NTP_RETRY_MAX;
+					wait = (uint32_t)NTP_RETRY << _ntp_failures;
+					if (wait > max_wait) wait = max_wait;
+					if (_ntp_failures < 16) _ntp_failures++;
+				}
+				UTC.setEvent(updateNTP, nowUTC(false) + ntpJitter(wait));
 			}
 		}
 
@@ -441,10 +1450,20 @@ namespace ezt {
 			buffer[14]  = 'Z';
 			buffer[15]  = 'T';	
 	
+			// Look up the address first, so the round trip is just the NTP part
+			#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+				IPAddress ip;
+				if (!ntpAddress(server, ip)) { triggerError(CONNECT_FAILED); return false; }
+			#endif
+
 			udp.flush();
 			udp.begin(NTP_LOCAL_PORT);
 			unsigned long started = millis();
-			udp.beginPacket(server.c_str(), 123); //NTP requests are to port 123
+			#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+				udp.beginPacket(ip, 123); //NTP requests are to port 123
+			#else
+				udp.beginPacket(server.c_str(), 123);
+			#endif
 			udp.write(buffer, NTP_PACKET_SIZE);
 			udp.endPacket();
 
@@ -453,11 +1472,15 @@ namespace ezt {
 				delay (1);
 				if (millis() - started > NTP_TIMEOUT) {
 					udp.stop();	
+					#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+						ntpAddressFailed();
+					#endif
 					triggerError(TIMEOUT); 
 					return false;
 				}
 			}
 			udp.read(buffer, NTP_PACKET_SIZE);
+			IPAddress from = udp.remoteIP();
 			udp.stop();													// On AVR there's only very limited sockets, we want to free them when done.
 	
 			//print out received packet for debug
@@ -491,17 +1514,40 @@ namespace ezt {
 			lowWord = ( buffer[46] << 8 | buffer[47] ) & 0x0000FFFF;
 			uint32_t fraction = highWord << 16 | lowWord;				// transmit timestamp fractions	
 
+			// Stratum 0 is a "kiss-o'-death": the reason is in the reference ID (RFC 5905, 7.4)
+			if (buffer[1] == 0) {
+				if (!memcmp(buffer + 12, "RATE", 4)) {
+					triggerError(NTP_RATE_LIMITED);
+					return false;
+				}
+				if (!memcmp(buffer + 12, "DENY", 4) || !memcmp(buffer + 12, "RSTR", 4)) {
+					triggerError(NTP_DENIED);
+					return false;
+				}
+			}
+
 			//check if received data makes sense
 			//buffer[1] = stratum - should be 1..15 for valid reply
 			//also checking that all timestamps are non-zero and receive timestamp seconds are <= transmit timestamp seconds
 			if ((buffer[1] < 1) or (buffer[1] > 15) or (reftsSec == 0) or (rcvtsSec == 0) or (rcvtsSec > secsSince1900)) {
 				// we got invalid packet
+				#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+					ntpAddressFailed();
+				#endif
 				triggerError(INVALID_DATA); 
 				return false;
 			}
 
+			#if !defined(EZTIME_ETHERNET) && !defined(EZTIME_WIFIESP)
+				_ntp_addresses_failed = 0;
+			#endif
+
 			// Set the t and measured_at variables that were passed by reference
 			uint32_t done = millis();
+			_ntp_reply.stratum = buffer[1];
+			_ntp_reply.root_delay = readNtpShort(buffer + 4) + ((done - started) << 16) / 1000;
+			_ntp_reply.root_dispersion = readNtpShort(buffer + 8);
+			for (uint8_t n = 0; n < 4; n++) _ntp_reply.reference_id[n] = from[n];
 			info(F("success (round trip ")); info(done - started); infoln(F(" ms)"));
 			t = secsSince1900 - 2208988800UL;					// Subtract 70 years to get seconds since 1970
 			uint16_t ms = fraction / 4294967UL;					// Turn 32 bit fraction into ms by dividing by 2^32 / 1000 
@@ -512,11 +1558,72 @@ namespace ezt {
 
 		void setInterval(const uint16_t seconds /* = 0 */) { 
 			deleteEvent(updateNTP);
+			deleteEvent(updateSources);
 			_ntp_interval = seconds;
-			if (seconds) UTC.setEvent(updateNTP, nowUTC(false) + _ntp_interval);
+			if (seconds) {
+				UTC.setEvent(updateNTP, nowUTC(false) + ntpJitter((uint32_t)_ntp_interval << _ntp_slowdown));
+			} else if (_source_count) {
+				UTC.setEvent(updateSources, nowUTC(false) + TIME_SOURCE_INTERVAL);
+			}
+		}
+
+		#ifdef EZTIME_CACHE_EEPROM
+			bool setCacheRegion(const int16_t address, const uint16_t length) {
+				eepromBegin();
+				if (address < 0 || length < EEPROM_SLOT_LEN || address + length > eepromLength()) {
+					eepromEnd();
+					triggerError(CACHE_TOO_SMALL);
+					return false;
+				}
+				_cache_region = address;
+				_cache_slot_count = length / EEPROM_SLOT_LEN;
+				if (_cache_slot_count > EEPROM_CACHE_SLOTS) _cache_slot_count = EEPROM_CACHE_SLOTS;
+				scanCacheRegion();
+				eepromEnd();
+				return true;
+			}
+		#endif
+
+		bool listenNTP(const uint16_t port /* = NTP_BROADCAST_PORT */) {
+			if (_ntp_listening) _ntp_listen_udp.stop();
+			_ntp_listening = false;
+			_ntp_calibrated = false;
+			if (!port) return true;
+			if (!_ntp_listen_udp.begin(port)) {
+				triggerError(CONNECT_FAILED);
+				return false;
+			}
+			_ntp_listening = true;
+			return true;
 		}
 
-		void setServer(const String ntp_server /* = NTP_SERVER */) { _ntp_server = ntp_server; }
+		bool serveNTP(const uint16_t port /* = NTP_SERVE_PORT */) {
+			if (_ntp_serving) _ntp_serve_udp.stop();
+			_ntp_serving = false;
+			if (!port) return true;
+			if (!_ntp_serve_udp.begin(port)) {
+				triggerError(CONNECT_FAILED);
+				return false;
+			}
+			_ntp_serving = true;
+			return true;
+		}
+
+		void setServer(const String ntp_server /* = NTP_SERVER */) {
+			_ntp_server = ntp_server;
+			_ntp_failures = 0;
+			_ntp_slowdown = 0;
+			if (_ntp_denied && _ntp_interval) {
+				deleteEvent(updateSources);
+				UTC.setEvent(updateNTP, nowUTC(false));	// the old one stopped the updates
+			}
+			_ntp_denied = false;
+		}
+
+		void setTimezoneServer(const String host /* = TIMEZONED_REMOTE_HOST */, const uint16_t port /* = TIMEZONED_REMOTE_PORT */) {
+			_timezoned_host = host;
+			_timezoned_port = port;
+		}
 
 		bool waitForSync(const uint16_t timeout /* = 0 */) {
 
@@ -553,48 +1660,281 @@ namespace ezt {
 }
 
 
+//
+// ezCalendar
+//
+
+// Only ever called when an EZT_ZONE() was not worked out while compiling
+ezRule_t ezCalendar::notAValidPosixString(const char *posix) {
+	triggerError(INVALID_DATA);
+	ezRule_t rule;
+	parsePosix(posix, rule);
+	return rule;
+}
+
+
+//
+// ezSharedBlock
+//
+
+ezSharedBlock::ezSharedBlock(const ezSharedBlock &other) {
+	_block = other._block;
+	if (_block) (*(uint16_t *)_block)++;
+}
+
+ezSharedBlock & ezSharedBlock::operator = (const ezSharedBlock &other) {
+	if (_block != other._block) {
+		release();
+		_block = other._block;
+		if (_block) (*(uint16_t *)_block)++;
+	}
+	return *this;
+}
+
+ezSharedBlock::~ezSharedBlock() { release(); }
+
+void * ezSharedBlock::allocate(const size_t size) {
+	release();
+	_block = (uint8_t *)calloc(1, SHARED_BLOCK_HEADER + size);
+	if (!_block) return NULL;
+	*(uint16_t *)_block = 1;
+	return _block + SHARED_BLOCK_HEADER;
+}
+
+void ezSharedBlock::release() {
+	if (_block && !--(*(uint16_t *)_block)) free(_block);
+	_block = NULL;
+}
+
+void * ezSharedBlock::data() const { return _block ? _block + SHARED_BLOCK_HEADER : NULL; }
+
+
+//
+// ezSharedRule
+//
+
+#ifdef EZTIME_FIXED_STRINGS
+
+	ezSharedRule::ezSharedRule() { set("UTC"); }
+
+	bool ezSharedRule::set(const char *posix, const ezRule_t *parsed /* = NULL */) {
+		if (parsed) {
+			_record.rule = *parsed;
+		} else {
+			parsePosix(posix, _record.rule);
+		}
+		if (strlen(posix) > MAX_POSIX_LEN) {
+			formatPosix(_record.rule, _record.posix);		// same rule, without what ezTime ignores anyway
+		} else {
+			strcpy(_record.posix, posix);
+		}
+		_record.year_start = _record.year_end = 0;
+		return true;
+	}
+
+#else
+
+	ezSharedRule::ezSharedRule() {
+		_record = &_utc_rule;
+		_record->refs++;
+	}
+
+	ezSharedRule::ezSharedRule(const ezSharedRule &other) {
+		_record = other._record;
+		_record->refs++;
+	}
+
+	ezSharedRule & ezSharedRule::operator = (const ezSharedRule &other) {
+		if (_record != other._record) {
+			other._record->refs++;
+			release();
+			_record = other._record;
+		}
+		return *this;
+	}
+
+	ezSharedRule::~ezSharedRule() { release(); }
+
+	// The rule for 'posix' from the pool, parsed and added if nobody has it yet
+	bool ezSharedRule::set(const char *posix, const ezRule_t *parsed /* = NULL */) {
+		if (!strcmp(posix, _record->posix)) return true;
+		ezRuleRecord_t *r = _rule_pool;
+		while (r && strcmp(posix, r->posix)) r = r->next;
+		if (r) {
+			r->refs++;
+		} else {
+			size_t len = strlen(posix);
+			r = (ezRuleRecord_t *)malloc(sizeof(ezRuleRecord_t) + len + 1);
+			if (!r) { triggerError(OUT_OF_MEMORY); return false; }
+			if (parsed) {
+				r->rule = *parsed;
+			} else {
+				parsePosix(posix, r->rule);
+			}
+			r->year_start = r->year_end = 0;
+			memcpy(r + 1, posix, len + 1);
+			r->posix = (const char *)(r + 1);
+			r->refs = 1;
+			r->next = _rule_pool;
+			_rule_pool = r;
+		}
+		release();
+		_record = r;
+		return true;
+	}
+
+	void ezSharedRule::release() {
+		if (--_record->refs) return;
+		ezRuleRecord_t **link = &_rule_pool;
+		while (*link != _record) link = &(*link)->next;
+		*link = _record->next;
+		free(_record);
+	}
+
+#endif
+
+
+//
+// ezPpsSource
+//
+
+void ezPpsSource::edge() {
+	_edge = millis();
+	_seen = true;
+}
+
+bool ezPpsSource::getTime(time_t &t, unsigned long &measured_at) {
+	noInterrupts();
+	uint32_t edge = _edge;
+	bool seen = _seen;
+	interrupts();
+	if (!seen || millis() - edge > PPS_TIMEOUT) return false;
+	time_t coarse_t;
+	unsigned long coarse_at;
+	if (!_coarse.getTime(coarse_t, coarse_at)) return false;
+	// What the coarse source says the time was at the edge, to the nearest whole second
+	int32_t ms = (int32_t)(edge - coarse_at) + 500;
+	t = coarse_t + (ms >= 0 ? ms / 1000 : -((999 - ms) / 1000));
+	measured_at = edge;
+	return true;
+}
+
+
 //
 // Timezone class
 //
 
 Timezone::Timezone(const bool locked_to_UTC /* = false */) {
 	_locked_to_UTC = locked_to_UTC;
-	_posix = "UTC";
+	_transitions = NULL;
+	_last_transition = 0;
 	#ifdef EZTIME_NETWORK_ENABLE
+		_lookup_status = LOOKUP_IDLE;
 		#ifdef EZTIME_CACHE_EEPROM
 			_cache_month = 0;
 			_eeprom_address = -1;
+			_cache_key = 0;
 		#endif
 		#ifdef EZTIME_CACHE_NVS
 			_cache_month = 0;
 			_nvs_name = "";
 			_nvs_key = "";
 		#endif
+	#endif
+	#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
 		_olson = "";
 	#endif
 }
 
-bool Timezone::setPosix(const String posix) {
-	if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
-	_posix = posix;
+Timezone::~Timezone() {
 	#ifdef EZTIME_NETWORK_ENABLE
+		cancelLookups(this);		// so events() does not write to a Timezone that is gone
+	#endif
+}
+
+bool Timezone::setPosix(const String posix) { return setPosix(posix.c_str()); }
+
+bool Timezone::setPosix(const char *posix) {
+	if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+	if (!setRule(posix)) return false;
+	#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
+		_olson = "";
+	#endif
+	return true;
+}
+
+// A rule EZT_ZONE() parsed while compiling, nothing left to do but keep it
+bool Timezone::setPosix(const ezZone_t &zone) {
+	if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+	if (!setRule(zone.posix, &zone.rule)) return false;
+	#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
 		_olson = "";
 	#endif
 	return true;
 }
 
-time_t Timezone::now() { return tzTime(); }
+time_t Timezone::now() { return tzTime(); }
+
+time_t Timezone::tzTime(time_t t /* = TIME_NOW */, ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
+	if (_locked_to_UTC) return nowUTC();	// just saving some time and memory
+	const char *tzname;
+	bool is_dst;
+	int16_t offset;
+	return convert(t, local_or_utc, tzname, is_dst, offset);
+}
+
+time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset) {
+	const char *name;
+	t = convert(t, local_or_utc, name, is_dst, offset);
+	tzname = name;
+	return t;
+}
+
+time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset) {
+	return convert(t, local_or_utc, tzname, is_dst, offset);
+}
+
+time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset, time_t &valid_until) {
+	if (t == TIME_NOW) {
+		t = nowUTC(); 
+		local_or_utc = UTC_TIME;
+	} else if (t == LAST_READ) {
+		t = _last_read_t;
+		local_or_utc = UTC_TIME;
+	}
+	time_t converted = tzTime(t, local_or_utc, tzname, is_dst, offset);
+	// Same kind of time as t: local times stay valid until the offset changes, in the old offset
+	valid_until = transitionAfter(local_or_utc == UTC_TIME ? t : converted);
+	if (valid_until != NO_TRANSITION && local_or_utc == LOCAL_TIME) valid_until -= offset * 60LL;
+	return converted;
+}
+
+time_t Timezone::nextTransition(time_t t /* = TIME_NOW */, ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
+	String tzname;
+	bool is_dst;
+	int16_t offset;
+	return findChange(t, local_or_utc, true, tzname, is_dst, offset);
+}
+
+time_t Timezone::nextTransition(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset) {
+	return findChange(t, local_or_utc, true, tzname, is_dst, offset);
+}
 
-time_t Timezone::tzTime(time_t t /* = TIME_NOW */, ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
-	if (_locked_to_UTC) return nowUTC();	// just saving some time and memory
+time_t Timezone::prevTransition(time_t t /* = TIME_NOW */, ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	String tzname;
 	bool is_dst;
 	int16_t offset;
-	return tzTime(t, local_or_utc, tzname, is_dst, offset);
+	return findChange(t, local_or_utc, false, tzname, is_dst, offset);
 }
 
-time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset) {
+time_t Timezone::prevTransition(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset) {
+	return findChange(t, local_or_utc, false, tzname, is_dst, offset);
+}
 
+// Walks transitions from t until the offset, DST flag or name actually change, and returns that
+// moment in UTC along with what applies from then on. Without one, the values at t are returned.
+time_t Timezone::findChange(time_t t, ezLocalOrUTC_t local_or_utc, const bool forward, String &tzname, bool &is_dst, int16_t &offset) {
+	const char *name;
 	if (t == TIME_NOW) {
 		t = nowUTC(); 
 		local_or_utc = UTC_TIME;
@@ -602,188 +1942,62 @@ time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, b
 		t = _last_read_t;
 		local_or_utc = UTC_TIME;
 	}
-	
-	int8_t offset_hr = 0;
-	uint8_t offset_min = 0;
-	int8_t dst_shift_hr = 1;
-	uint8_t dst_shift_min = 0;
-	
-	uint8_t start_month = 0, start_week = 0, start_dow = 0, start_time_hr = 2, start_time_min = 0;
-	uint8_t end_month = 0, end_week = 0, end_dow = 0, end_time_hr = 2, end_time_min = 0;
-	
-	enum posix_state_e {STD_NAME, OFFSET_HR, OFFSET_MIN, DST_NAME, DST_SHIFT_HR, DST_SHIFT_MIN, START_MONTH, START_WEEK, START_DOW, START_TIME_HR, START_TIME_MIN, END_MONTH, END_WEEK, END_DOW, END_TIME_HR, END_TIME_MIN};
-	posix_state_e state = STD_NAME; 
-
-	bool ignore_nums = false;
-	char c = 1; // Dummy value to get while(newchar) started
-	uint8_t strpos = 0;
-	uint8_t stdname_end = _posix.length() - 1;
-	uint8_t dstname_begin = _posix.length();
-	uint8_t dstname_end = _posix.length();
-
-	while (strpos < _posix.length()) {
-		c = (char)_posix[strpos];
-
-		// Do not replace the code below with switch statement: evaluation of state that 
-		// changes while this runs. (Only works because this state can only go forward.)
-
-		if (c && state == STD_NAME) {
-			if (c == '<') ignore_nums = true;
-			if (c == '>') ignore_nums = false;
-			if (!ignore_nums && (isDigit(c) || c == '-'  || c == '+')) {
-				state = OFFSET_HR;
-				stdname_end = strpos - 1;
-			}
-		}
-		if (c && state == OFFSET_HR) {
-			if (c == '+') {
-				// Ignore the plus
-			} else if (c == ':') {
-				state = OFFSET_MIN;
-				c = 0;
-			} else if (c != '-' && !isDigit(c)) {
-				state = DST_NAME;
-				dstname_begin = strpos;
-			} else {
-				if (!offset_hr) offset_hr = atoi(_posix.c_str() + strpos);
-			}
-		}			
-		if (c && state == OFFSET_MIN) {
-			if (!isDigit(c)) {
-				state = DST_NAME;
-				dstname_begin = strpos;
-				ignore_nums = false;
-			} else {
-				if (!offset_min) offset_min = atoi(_posix.c_str() + strpos);
-			}
-		}				
-		if (c && state == DST_NAME) {
-			if (c == '<') ignore_nums = true;
-			if (c == '>') ignore_nums = false;
-			if (c == ',') {
-				state = START_MONTH;
-				c = 0;
-				dstname_end = strpos - 1;
-			} else if (!ignore_nums && (c == '-' || isDigit(c))) {
-				state = DST_SHIFT_HR;
-				dstname_end = strpos - 1;
-			}
-		}		
-		if (c && state == DST_SHIFT_HR) {
-			if (c == ':') {
-				state = DST_SHIFT_MIN;
-				c = 0;
-			} else if (c == ',') {
-				state = START_MONTH;
-				c = 0;
-			} else if (dst_shift_hr == 1) dst_shift_hr = atoi(_posix.c_str() + strpos);
-		}			
-		if (c && state == DST_SHIFT_MIN) {
-			if (c == ',') {
-				state = START_MONTH;
-				c = 0;
-			} else if (!dst_shift_min) dst_shift_min = atoi(_posix.c_str() + strpos);
-		}			
-		if (c && state == START_MONTH) {
-			if (c == '.') {
-				state = START_WEEK;
-				c = 0;
-			} else if (c != 'M' && !start_month) start_month = atoi(_posix.c_str() + strpos);	
-		}			
-		if (c && state == START_WEEK) {
-			if (c == '.') {
-				state = START_DOW;
-				c = 0;
-			} else start_week = c - '0';
-		}		
-		if (c && state == START_DOW) {
-			if (c == '/') {
-				state = START_TIME_HR;
-				c = 0;
-			} else if (c == ',') {
-				state = END_MONTH;
-				c = 0;
-			} else start_dow = c - '0';				
-		}
-		if (c && state == START_TIME_HR) {
-			if (c == ':') {
-				state = START_TIME_MIN;
-				c = 0;
-			} else if (c == ',') {
-				state = END_MONTH;
-				c = 0;
-			} else if (start_time_hr == 2) start_time_hr = atoi(_posix.c_str() + strpos);
-		}		
-		if (c && state == START_TIME_MIN) {
-			if (c == ',') {
-				state = END_MONTH;
-				c = 0;
-			} else if (!start_time_min) start_time_min = atoi(_posix.c_str() + strpos);
-		}		
-		if (c && state == END_MONTH) {
-			if (c == '.') {
-				state = END_WEEK;
-				c = 0;
-			} else if (c != 'M') if (!end_month) end_month = atoi(_posix.c_str() + strpos);
-		}			
-		if (c && state == END_WEEK) {
-			if (c == '.') {
-				state = END_DOW;
-				c = 0;
-			} else end_week = c - '0';
-		}		
-		if (c && state == END_DOW) {
-			if (c == '/') {
-				state = END_TIME_HR;
-				c = 0;			
-			} else end_dow = c - '0';
-		}
-		if (c && state == END_TIME_HR) {
-			if (c == ':') {
-				state = END_TIME_MIN;
-				c = 0;
-			}  else if (end_time_hr == 2) end_time_hr = atoi(_posix.c_str() + strpos);
-		}		
-		if (c && state == END_TIME_MIN) {
-			if (!end_time_min) end_time_min = atoi(_posix.c_str() + strpos);
-		}
-		strpos++;
-	}	
-	
-	int16_t std_offset = (offset_hr < 0) ? offset_hr * 60 - offset_min : offset_hr * 60 + offset_min;
-	
-	tzname = _posix.substring(0, stdname_end + 1);	// Overwritten with dstname later if needed
-	if (!start_month) {
-		if (tzname == "UTC" && std_offset) tzname = "???";
-		is_dst = false;
-		offset = std_offset;
-	} else {
-		int16_t dst_offset = std_offset - dst_shift_hr * 60 - dst_shift_min;
-		// to find the year
-		tmElements_t tm;
-		ezt::breakTime(t, tm);	
-		
-		// in local time
-		time_t dst_start = ezt::makeOrdinalTime(start_time_hr, start_time_min, 0, start_week, start_dow + 1, start_month, tm.Year + 1970);
-		time_t dst_end = ezt::makeOrdinalTime(end_time_hr, end_time_min, 0, end_week, end_dow + 1, end_month, tm.Year + 1970);
-		
-		if (local_or_utc == UTC_TIME) {
-			dst_start += std_offset * 60LL;
-			dst_end += dst_offset * 60LL;
-		}
-		
-		if (dst_end > dst_start) {
-			is_dst = (t >= dst_start && t < dst_end);		// northern hemisphere
-		} else {
-			is_dst = !(t >= dst_end && t < dst_start);		// southern hemisphere
+	time_t utc = (local_or_utc == UTC_TIME) ? t : convert(t, LOCAL_TIME, name, is_dst, offset);
+	time_t change = utc;
+	for (uint8_t tries = 0; tries < 8; tries++) {
+		change = forward ? transitionAfter(change) : transitionAtOrBefore(change);
+		if (change == NO_TRANSITION) break;
+		const char *before_name;
+		bool before_dst;
+		int16_t before_offset;
+		convert(change - 1, UTC_TIME, before_name, before_dst, before_offset);
+		convert(change, UTC_TIME, name, is_dst, offset);
+		if (offset != before_offset || is_dst != before_dst || strcmp(name, before_name)) {
+			tzname = name;
+			return change;
 		}
+		if (!forward) change--;
+	}
+	convert(utc, UTC_TIME, name, is_dst, offset);
+	tzname = name;
+	return NO_TRANSITION;
+}
 
-		if (is_dst) {
-			offset = dst_offset;
-			tzname = _posix.substring(dstname_begin, dstname_end + 1);
-		} else {
-			offset = std_offset;
-		}
+time_t Timezone::transitionAfter(const time_t t) {
+	time_t change;
+	if (_transitions) {
+		int32_t n = findTransition(t);
+		if (n < (int32_t)_transitions->count - 1) return _transitions->at[n + 1];
+	}
+	return ruleChange(_rule->rule, t, true, change) ? change : NO_TRANSITION;
+}
+
+time_t Timezone::transitionAtOrBefore(const time_t t) {
+	time_t change;
+	if (_transitions) {
+		int32_t n = findTransition(t);
+		if (n < 0) return NO_TRANSITION;
+		// Before the end of the table only the table counts, after it the rule may be more recent
+		if (n < (int32_t)_transitions->count - 1) return _transitions->at[n];
+		if (!ruleChange(_rule->rule, t, false, change) || change < _transitions->at[n]) return _transitions->at[n];
+		return change;
+	}
+	return ruleChange(_rule->rule, t, false, change) ? change : NO_TRANSITION;
+}
+
+time_t Timezone::convert(time_t t, ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset) {
+
+	if (t == TIME_NOW) {
+		t = nowUTC(); 
+		local_or_utc = UTC_TIME;
+	} else if (t == LAST_READ) {
+		t = _last_read_t;
+		local_or_utc = UTC_TIME;
+	}
+
+	if (!_transitions || !transitionOffset(t, local_or_utc, tzname, is_dst, offset)) {
+		ruleOffset(*_rule, t, local_or_utc, is_dst, offset);
+		tzname = is_dst ? _rule->rule.dst_name : _rule->rule.std_name;
 	}
 
 	if (local_or_utc == LOCAL_TIME) {
@@ -793,9 +2007,178 @@ time_t Timezone::tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, b
 	}
 }
 
-String Timezone::getPosix() { return _posix; }
+bool Timezone::setRule(const char *posix, const ezRule_t *parsed /* = NULL */) {
+	if (_transitions && strcmp(posix, _rule->posix)) clearTransitions();	// table belongs to another zone
+	return _rule.set(posix, parsed);
+}
 
 #ifdef EZTIME_NETWORK_ENABLE
+	// A rule that came in parsed already. The POSIX string is made from it so everything else
+	// stays the same.
+	bool Timezone::setRule(const ezRule_t &rule) {
+		char posix[MAX_POSIX_LEN + 1];
+		formatPosix(rule, posix);
+		return setRule(posix, &rule);
+	}
+#endif
+
+// Index of the last transition at or before UTC time t, -1 if t is before the first one.
+// Consecutive lookups tend to be close together, so the last result is tried first.
+int32_t Timezone::findTransition(const time_t t) {
+	const ezTransitions_t &tr = *_transitions;
+	if (!tr.count || t < tr.at[0]) return -1;
+	uint16_t n = _last_transition;
+	if (n < tr.count && tr.at[n] <= t && (n + 1 == tr.count || t < tr.at[n + 1])) return n;
+	uint16_t lo = 0;
+	uint16_t hi = tr.count - 1;
+	while (lo < hi) {
+		uint16_t mid = lo + (hi - lo + 1) / 2;
+		if (tr.at[mid] <= t) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	_last_transition = lo;
+	return lo;
+}
+
+// Returns false if t is past the last transition, the POSIX rule applies from there
+bool Timezone::transitionOffset(const time_t t, const ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset) {
+	const ezTransitions_t &tr = *_transitions;
+	int32_t n = findTransition(t);
+	if (local_or_utc == LOCAL_TIME) {
+		// Find the offset that takes t to a UTC time where that offset applies. Skipped local
+		// times end up on one side of the gap, repeated ones on the first occurrence.
+		for (uint8_t tries = 0; tries < 2; tries++) {
+			int32_t m = findTransition(t + tr.types[n < 0 ? 0 : tr.type[n]].offset * 60LL);
+			if (m == n) break;
+			n = m;
+		}
+	}
+	if (n == (int32_t)tr.count - 1) return false;
+	const ezZoneType_t &type = tr.types[n < 0 ? 0 : tr.type[n]];
+	tzname = tr.names + type.name;
+	is_dst = type.is_dst;
+	offset = type.offset;
+	return true;
+}
+
+bool Timezone::setTransitions(const ezTransitions_t &transitions) {
+	if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+	_tzif.release();
+	_transitions = &transitions;
+	_last_transition = 0;
+	return true;
+}
+
+bool Timezone::setTZif(const uint8_t *tzif, const size_t len) {
+	if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+
+	// Header: magic, version, 15 reserved bytes, then isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt
+	if (len < 44 || memcmp(tzif, "TZif", 4)) { triggerError(INVALID_TZIF); return false; }
+	const uint8_t *p = tzif;
+	const uint8_t *end = tzif + len;
+	uint8_t time_size = 4;
+	uint32_t cnt[6];
+	for (;;) {
+		if (end - p < 44) { triggerError(INVALID_TZIF); return false; }
+		for (uint8_t n = 0; n < 6; n++) cnt[n] = tzifInt(p + 20 + n * 4, 4);
+		if (cnt[3] > 0xFFFF || cnt[4] < 1 || cnt[4] > 256 || cnt[5] > 256) { triggerError(INVALID_TZIF); return false; }
+		p += 44;
+		if (time_size == 8 || tzif[4] < '2') break;
+		// Version 2 and up repeat everything with 64-bit times, skip the 32-bit data
+		p += cnt[3] * 5 + cnt[4] * 6 + cnt[5] + cnt[2] * 8 + cnt[1] + cnt[0];
+		time_size = 8;
+	}
+	const uint32_t timecnt = cnt[3], typecnt = cnt[4], charcnt = cnt[5];
+	const uint8_t *times = p;
+	const uint8_t *indices = times + timecnt * time_size;
+	const uint8_t *ttinfos = indices + timecnt;
+	const uint8_t *chars = ttinfos + typecnt * 6;
+	const uint8_t *footer = chars + charcnt + cnt[2] * (time_size + 4) + cnt[1] + cnt[0];
+	if (footer > end) { triggerError(INVALID_TZIF); return false; }
+
+	for (uint32_t n = 0; n < timecnt; n++) {
+		if (indices[n] >= typecnt) { triggerError(INVALID_TZIF); return false; }
+	}
+	for (uint32_t n = 0; n < typecnt; n++) {
+		if (ttinfos[n * 6 + 5] >= charcnt) { triggerError(INVALID_TZIF); return false; }
+	}
+
+	// Transitions from before what time_t can hold only matter for the type they leave in place
+	int32_t early = -1;
+	uint32_t count = 0;
+	for (uint32_t n = 0; n < timecnt; n++) {
+		int64_t t = tzifInt(times + n * time_size, time_size);
+		if ((int64_t)(time_t)t == t) {
+			count++;
+		} else if (t < 0) {
+			early = n;
+		}
+	}
+	const uint32_t first = (early < 0) ? 0 : early;
+	if (early >= 0) count++;							// clamped to the earliest time_t
+	const time_t earliest = ((time_t)-1 < 0) ? (time_t)((uint64_t)1 << (sizeof(time_t) * 8 - 1)) : 0;
+
+	_transitions = NULL;
+	size_t size = sizeof(ezTransitions_t) + count * sizeof(time_t) + typecnt * sizeof(ezZoneType_t) + count + charcnt + 1;
+	uint8_t *block = (uint8_t *)_tzif.allocate(size);
+	if (!block) { triggerError(INVALID_TZIF); return false; }
+	ezTransitions_t *tr = (ezTransitions_t *)block;
+	time_t *at = (time_t *)(block + sizeof(ezTransitions_t));
+	ezZoneType_t *types = (ezZoneType_t *)(at + count);
+	uint8_t *type = (uint8_t *)(types + typecnt);
+	char *names = (char *)(type + count);
+	for (uint32_t n = 0; n < count; n++) {
+		int64_t t = tzifInt(times + (first + n) * time_size, time_size);
+		at[n] = ((int64_t)(time_t)t == t) ? (time_t)t : earliest;
+		type[n] = indices[first + n];
+	}
+	for (uint32_t n = 0; n < typecnt; n++) {
+		const uint8_t *ttinfo = ttinfos + n * 6;
+		types[n].offset = -tzifInt(ttinfo, 4) / 60;
+		types[n].is_dst = ttinfo[4];
+		types[n].name = ttinfo[5];
+	}
+	memcpy(names, chars, charcnt);
+	tr->count = count;
+	tr->at = at;
+	tr->type = type;
+	tr->types = types;
+	tr->names = names;
+
+	// The footer, "\n<POSIX string>\n", covers everything after the last transition
+	if (time_size == 8 && footer < end && *footer == '\n') {
+		String posix;
+		for (const uint8_t *c = footer + 1; c < end && *c != '\n'; c++) posix += (char)*c;
+		if (posix.length()) {
+			setRule(posix.c_str());
+			#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
+				_olson = "";
+			#endif
+		}
+	}
+	_transitions = tr;
+	_last_transition = 0;
+	return true;
+}
+
+void Timezone::clearTransitions() {
+	_transitions = NULL;
+	_last_transition = 0;
+	_tzif.release();
+}
+
+const ezTransitions_t * Timezone::getTransitions() { return _transitions; }
+
+const ezRule_t & Timezone::getRule() { return _rule->rule; }
+
+String Timezone::getPosix() { return _rule->posix; }
+
+size_t Timezone::getPosix(char *buffer, const size_t size) { return copyText(buffer, size, _rule->posix); }
+
+#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
 
 	bool Timezone::setLocation(const String location /* = "GeoIP" */) {
 	
@@ -803,7 +2186,17 @@ String Timezone::getPosix() { return _posix; }
 		info(location);
 		info(F(" ... "));
 		if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
-		
+
+		#ifdef EZTIME_TZDB
+			if (setLocationFromDB(location)) return true;
+			#ifndef EZTIME_NETWORK_ENABLE
+				infoln(F("not in compiled-in database."));
+				triggerError(DATA_NOT_FOUND);
+				return false;
+			#endif
+		#endif
+
+		#ifdef EZTIME_NETWORK_ENABLE
 		#ifndef EZTIME_ETHERNET
 			if (WiFi.status() != WL_CONNECTED) { triggerError(NO_NETWORK); return false; }
 			#ifndef EZTIME_WIFIESP
@@ -815,15 +2208,19 @@ String Timezone::getPosix() { return _posix; }
 			EthernetUDP udp;
 		#endif
 		
+		waitForLookupGap();
 		udp.flush();
 		udp.begin(TIMEZONED_LOCAL_PORT);
 		unsigned long started = millis();
-		udp.beginPacket(TIMEZONED_REMOTE_HOST, TIMEZONED_REMOTE_PORT);
+		udp.beginPacket(_timezoned_host.c_str(), _timezoned_port);
 		udp.write((const uint8_t*)location.c_str(), location.length());
+		udp.write((const uint8_t*)TIMEZONED_QUERY_SUFFIX, sizeof(TIMEZONED_QUERY_SUFFIX) - 1);
 		udp.endPacket();
+		lookupSent();
 		
 		// Wait for packet or return false with timed out
-		while (!udp.parsePacket()) {
+		int size;
+		while (!(size = udp.parsePacket())) {
 			delay (1);
 			if (millis() - started > TIMEZONED_TIMEOUT) {
 				udp.stop();	
@@ -831,65 +2228,332 @@ String Timezone::getPosix() { return _posix; }
 				return false;
 			}
 		}
-		// Stick result in String recv 
-		String recv;
-		recv.reserve(60);
-		while (udp.available()) recv += (char)udp.read();
+		// The whole packet in one go
+		uint8_t *reply = (uint8_t *)malloc(size);
+		if (!reply) { udp.stop(); triggerError(DATA_NOT_FOUND); return false; }
+		size = udp.read(reply, size);
 		udp.stop();
 		info(F("(round-trip "));
 		info(millis() - started);
 		info(F(" ms)  "));
-		if (recv.substring(0,6) == "ERROR ") {
-			_server_error = recv.substring(6);
-			error (SERVER_ERROR);
+		const uint8_t *p = reply;
+		bool binary;
+		bool success = false;
+		if (replyAnswers(p, reply + size, binary) == 1) {
+			success = applyLocationReply(p, reply + size, binary);
+		} else {
+			triggerError(DATA_NOT_FOUND);
+		}
+		free(reply);
+		return success;
+		#endif // EZTIME_NETWORK_ENABLE
+	}
+
+	#ifdef EZTIME_TZDB
+		bool Timezone::setLocationFromDB(const String &location) {
+			String olson, posix;
+			if (!tzdbLookup(location, olson, posix)) return false;
+			_olson = olson;
+			setRule(posix.c_str());
+			infoln(F("found in compiled-in database."));
+			info(F("  Olson: ")); infoln(_olson.c_str());
+			info(F("  Posix: ")); infoln(_rule->posix);
+			#if defined(EZTIME_NETWORK_ENABLE) && (defined(EZTIME_CACHE_EEPROM) || defined(EZTIME_CACHE_NVS))
+				writeCache();		// so a cache set later does not bring back an older zone
+			#endif
+			return true;
+		}
+	#endif
+
+	#ifdef EZTIME_NETWORK_ENABLE
+
+		bool Timezone::applyLocationReply(String &recv) {
+			if (recv.substring(0,6) == "ERROR ") {
+				_server_error = recv.substring(6);
+				triggerError(SERVER_ERROR);
+				return false;
+			}
+			if (recv.substring(0,3) == "OK ") {
+				_olson = recv.substring(3, recv.indexOf(" ", 4));
+				setRule(recv.substring(recv.indexOf(" ", 4) + 1).c_str());
+				return locationFound();
+			}
+			triggerError(DATA_NOT_FOUND);
 			return false;
 		}
-		if (recv.substring(0,3) == "OK ") {
-			_olson = recv.substring(3, recv.indexOf(" ", 4));
-			_posix = recv.substring(recv.indexOf(" ", 4) + 1);
+
+		// One answer out of a reply in either format, p is moved past it. A binary answer has
+		// the rule parsed already, so it goes straight into _rule.
+		bool Timezone::applyLocationReply(const uint8_t *&p, const uint8_t *end, const bool binary) {
+			if (!binary) {
+				const uint8_t *line_end = p;
+				while (line_end < end && *line_end != '\n') line_end++;
+				String recv;
+				recv.reserve(line_end - p);
+				while (p < line_end) recv += (char)*p++;
+				if (p < end) p++;
+				return applyLocationReply(recv);
+			}
+			uint8_t status;
+			String olson;
+			ezRule_t rule;
+			if (!binByte(p, end, status)) { triggerError(DATA_NOT_FOUND); return false; }
+			if (status) {
+				if (!binString(p, end, _server_error)) { triggerError(DATA_NOT_FOUND); return false; }
+				triggerError(SERVER_ERROR);
+				return false;
+			}
+			if (!binString(p, end, olson) || !binRule(p, end, rule)) { triggerError(DATA_NOT_FOUND); return false; }
+			_olson = olson;
+			setRule(rule);
+			return locationFound();
+		}
+
+		bool Timezone::locationFound() {
 			infoln(F("success."));
-			info(F("  Olson: ")); infoln(_olson);
-			info(F("  Posix: ")); infoln(_posix);
+			info(F("  Olson: ")); infoln(_olson.c_str());
+			info(F("  Posix: ")); infoln(_rule->posix);
 			#if defined(EZTIME_CACHE_EEPROM) || defined(EZTIME_CACHE_NVS)
-				String tzinfo = _olson + " " + _posix;
-				writeCache(tzinfo);		// caution, byref to save memory, tzinfo mangled afterwards
+				writeCache();
 			#endif
 			return true;
 		}
-		error (DATA_NOT_FOUND);
-		return false;
-	}
-	
+
+		// Like setLocation, but returns right away. The answer is picked up by events(), after which
+		// lookupStatus() changes and the callback, if any, is called. Until then nothing changes.
+		bool Timezone::setLocationAsync(const String location /* = "GeoIP" */, void (*callback)(Timezone &tz, const bool success) /* = NULL */) {
+			info(F("Background timezone lookup for: "));
+			info(location);
+			info(F(" ... "));
+			if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+			#ifdef EZTIME_TZDB
+				if (setLocationFromDB(location)) {
+					_lookup_status = LOOKUP_OK;
+					if (callback) callback(*this, true);
+					return true;
+				}
+			#endif
+			#ifndef EZTIME_ETHERNET
+				if (WiFi.status() != WL_CONNECTED) { triggerError(NO_NETWORK); return false; }
+			#endif
+			cancelLookups(this);
+			if (_lookup_count >= MAX_LOOKUPS) { triggerError(TOO_MANY_LOOKUPS); return false; }
+			_lookups[_lookup_count++] = { this, location, callback };
+			infoln(F("queued."));
+			lookupEvents();					// sends it now if nothing else is going on
+			return true;
+		}
+
+		ezLookupStatus_t Timezone::lookupStatus() {
+			for (uint8_t n = 0; n < _lookup_count; n++) {
+				if (_lookups[n].tz == this) return LOOKUP_PENDING;
+			}
+			return _lookup_status;
+		}
+
+		void Timezone::lookupEvents() {
+			bool success = false;
+			if (_lookup_in_flight) {
+				int size = _lookup_udp.parsePacket();
+				uint8_t *reply = size ? (uint8_t *)malloc(size) : NULL;
+				if (reply) {
+					size = _lookup_udp.read(reply, size);
+					info(F("Background timezone lookup for: "));
+					info(_lookups[0].location);
+					info(F(" (round-trip "));
+					info(millis() - _lookup_sent_millis);
+					info(F(" ms)  "));
+					const uint8_t *p = reply;
+					bool binary;
+					if (replyAnswers(p, reply + size, binary) == 1) {
+						success = _lookups[0].tz->applyLocationReply(p, reply + size, binary);
+					} else {
+						triggerError(DATA_NOT_FOUND);
+					}
+					free(reply);
+				} else if (size) {
+					triggerError(DATA_NOT_FOUND);
+				} else if (millis() - _lookup_sent_millis > TIMEZONED_TIMEOUT) {
+					triggerError(TIMEOUT);
+				} else {
+					return;
+				}
+			} else if (_lookup_count && (!_lookup_ever_sent || millis() - _lookup_sent_millis >= TIMEZONED_MIN_GAP)) {
+				#ifndef EZTIME_ETHERNET
+					if (WiFi.status() != WL_CONNECTED) return;		// try again later
+				#endif
+				_lookup_udp.begin(TIMEZONED_LOCAL_PORT);
+				if (_lookup_udp.beginPacket(_timezoned_host.c_str(), _timezoned_port)) {
+					_lookup_udp.write((const uint8_t*)_lookups[0].location.c_str(), _lookups[0].location.length());
+					_lookup_udp.write((const uint8_t*)TIMEZONED_QUERY_SUFFIX, sizeof(TIMEZONED_QUERY_SUFFIX) - 1);
+					_lookup_udp.endPacket();
+					_lookup_in_flight = true;
+					lookupSent();
+					return;
+				}
+				_lookup_udp.stop();
+				triggerError(CONNECT_FAILED);
+			} else {
+				return;
+			}
+			// Done with the first one, successfully or not
+			Timezone *tz = _lookups[0].tz;
+			void (*callback)(Timezone &tz, const bool success) = _lookups[0].callback;
+			removeLookup(0);
+			tz->_lookup_status = success ? LOOKUP_OK : LOOKUP_FAILED;
+			if (callback) callback(*tz, success);
+		}
+
+		// setLocation() and setLocations() use the port of the background lookups, and the server
+		// ignores a second question from us within 3 seconds. So they first wait for a background
+		// lookup that is out to be answered or time out, and then for TIMEZONED_MIN_GAP after the
+		// last question that went out, whichever way it went.
+		void Timezone::waitForLookupGap() {
+			while (_lookup_in_flight) {
+				delay(1);
+				lookupEvents();
+			}
+			while (_lookup_ever_sent && millis() - _lookup_sent_millis < TIMEZONED_MIN_GAP) delay(1);
+		}
+
+		// Every question to the server counts for the gap, from whichever path it went out
+		void Timezone::lookupSent() {
+			_lookup_ever_sent = true;
+			_lookup_sent_millis = millis();
+		}
+
+		namespace ezt {
+
+			// Several locations in one exchange: one per line in the question, one "OK ..." or
+			// "ERROR ..." line per location in the answer, in the same order. A server that does not
+			// know about this takes the whole question as one name and sends a single error, in which
+			// case the locations are looked up one by one in the background instead.
+			bool setLocations(Timezone *zones[], const String locations[], const uint8_t count) {
+				bool success = true;
+				String query;
+				uint8_t asked[MAX_LOOKUPS];
+				uint8_t num_asked = 0;
+				for (uint8_t n = 0; n < count; n++) {
+					Timezone *tz = zones[n];
+					tz->_lookup_status = LOOKUP_FAILED;
+					if (tz->_locked_to_UTC) { triggerError(LOCKED_TO_UTC); success = false; continue; }
+					#ifdef EZTIME_TZDB
+						info(F("Timezone lookup for: ")); info(locations[n]); info(F(" ... "));
+						if (tz->setLocationFromDB(locations[n])) {
+							tz->_lookup_status = LOOKUP_OK;
+							continue;
+						}
+						infoln(F("asking server."));
+					#endif
+					if (num_asked == MAX_LOOKUPS) { triggerError(TOO_MANY_LOOKUPS); success = false; continue; }
+					if (num_asked) query += '\n';
+					query += locations[n];
+					asked[num_asked++] = n;
+				}
+				if (!num_asked) return success;
+
+				#ifndef EZTIME_ETHERNET
+					if (WiFi.status() != WL_CONNECTED) { triggerError(NO_NETWORK); return false; }
+					#ifndef EZTIME_WIFIESP
+						WiFiUDP udp;
+					#else
+						WiFiEspUDP udp;
+					#endif
+				#else
+					EthernetUDP udp;
+				#endif
+
+				info(F("Timezone lookup for ")); info(num_asked); info(F(" locations ... "));
+				Timezone::waitForLookupGap();
+				udp.flush();
+				udp.begin(TIMEZONED_LOCAL_PORT);
+				unsigned long started = millis();
+				udp.beginPacket(_timezoned_host.c_str(), _timezoned_port);
+				udp.write((const uint8_t*)query.c_str(), query.length());
+				udp.write((const uint8_t*)TIMEZONED_QUERY_SUFFIX, sizeof(TIMEZONED_QUERY_SUFFIX) - 1);
+				udp.endPacket();
+				Timezone::lookupSent();
+				int size;
+				while (!(size = udp.parsePacket())) {
+					delay (1);
+					if (millis() - started > TIMEZONED_TIMEOUT) {
+						udp.stop();
+						triggerError(TIMEOUT);
+						return false;
+					}
+				}
+				uint8_t *reply = (uint8_t *)malloc(size);
+				if (!reply) { udp.stop(); triggerError(DATA_NOT_FOUND); return false; }
+				size = udp.read(reply, size);
+				udp.stop();
+				info(F("(round-trip "));
+				info(millis() - started);
+				infoln(F(" ms)"));
+
+				const uint8_t *p = reply;
+				const uint8_t *end = reply + size;
+				bool binary;
+				uint8_t answers = replyAnswers(p, end, binary);
+				if (answers != num_asked) {
+					bool one_error = binary ? (p < end && *p) : (size >= 6 && !memcmp(reply, "ERROR ", 6));
+					if (answers == 1 && one_error) {
+						infoln(F("Server does not do batches, asking one by one in the background."));
+						for (uint8_t m = 0; m < num_asked; m++) zones[asked[m]]->setLocationAsync(locations[asked[m]]);
+					} else {
+						triggerError(DATA_NOT_FOUND);
+					}
+					free(reply);
+					return false;
+				}
+				for (uint8_t m = 0; m < num_asked; m++) {
+					info(F("  ")); info(locations[asked[m]]); info(F(": "));
+					if (zones[asked[m]]->applyLocationReply(p, end, binary)) {
+						zones[asked[m]]->_lookup_status = LOOKUP_OK;
+					} else {
+						success = false;
+					}
+				}
+				free(reply);
+				return success;
+			}
+
+		}
+
+	#endif // EZTIME_NETWORK_ENABLE
 	
 	String Timezone::getOlson() {
-		return _olson;
+		return _olson.c_str();
 	}
 
+	size_t Timezone::getOlson(char *buffer, const size_t size) { return copyText(buffer, size, _olson.c_str()); }
+
 	String Timezone::getOlsen() {
-		return _olson;
+		return _olson.c_str();
 	}	
 
+#endif // defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
+
+#ifdef EZTIME_NETWORK_ENABLE
+
 
 	#if defined(EZTIME_CACHE_EEPROM) || defined(EZTIME_CACHE_NVS)
 	
-		#if defined(ESP32) || defined(ESP8266)
-			#define eepromBegin()	EEPROM.begin(4096)
-			#define eepromEnd()		EEPROM.end()
-			#define eepromLength()	(4096)
-		#else
-			#define eepromBegin()	""
-			#define eepromEnd()		""
-			#define eepromLength()	EEPROM.length()
-		#endif
-		
 		#ifdef EZTIME_CACHE_EEPROM
 			bool Timezone::setCache(const int16_t address) {
 				eepromBegin();
 				if (address + EEPROM_CACHE_LEN > eepromLength()) { triggerError(CACHE_TOO_SMALL); return false; }
 				_eeprom_address = address;
+				_cache_key = 0;
 				eepromEnd();
 				return setCache();
 			}
+
+			bool Timezone::setCache(const String key) {
+				if (_cache_region < 0) { triggerError(NO_CACHE_SET); return false; }
+				_eeprom_address = -1;
+				_cache_key = cacheKey(key);
+				return setCache();
+			}
 		#endif
 	
 		#ifdef EZTIME_CACHE_NVS
@@ -901,15 +2565,18 @@ String Timezone::getPosix() { return _posix; }
 		#endif
 
 		bool Timezone::setCache() {
-			String olson, posix;
+			String olson;
+			ezRule_t rule;
 			uint8_t months_since_jan_2018;
-			if (readCache(olson, posix, months_since_jan_2018)) {
-				setPosix(posix);
+			if (readCache(olson, rule, months_since_jan_2018)) {
+				if (_locked_to_UTC) { triggerError(LOCKED_TO_UTC); return false; }
+				setRule(rule);
 				_olson = olson;
 				_cache_month = months_since_jan_2018;
+				info(F("Cache read. Olson: ")); info(_olson.c_str()); info (F("  Posix: ")); infoln(_rule->posix);
 				if ( (year() - 2018) * 12 + month(LAST_READ) - months_since_jan_2018 > MAX_CACHE_AGE_MONTHS) {
-					infoln(F("Cache stale, getting fresh"));
-					setLocation(olson);
+					infoln(F("Cache stale, getting fresh in the background"));
+					setLocationAsync(olson);
 				}
 				return true;
 			}
@@ -919,14 +2586,24 @@ String Timezone::getPosix() { return _posix; }
 		void Timezone::clearCache(const bool delete_section /* = false */) {
 		
 			#ifdef EZTIME_CACHE_EEPROM
+				if (_eeprom_address < 0 && !_cache_key) { triggerError(NO_CACHE_SET); return; }
 				eepromBegin();
-				if (_eeprom_address < 0) { triggerError(NO_CACHE_SET); return; }
-				for (int16_t n = _eeprom_address; n < _eeprom_address + EEPROM_CACHE_LEN; n++) EEPROM.write(n, 0);
+				if (_cache_key) {
+					// Every slot it has data in, or an older one would come back. A bad checksum does it.
+					for (uint8_t n = 0; n < _cache_slot_count; n++) {
+						if (!_cache_slots[n].valid || _cache_slots[n].key != _cache_key) continue;
+						uint16_t last_byte = slotAddress(n) + EEPROM_SLOT_LEN - 1;
+						EEPROM.write(last_byte, EEPROM.read(last_byte) + 1);
+						_cache_slots[n].valid = false;
+					}
+				} else {
+					for (int16_t n = _eeprom_address; n < _eeprom_address + EEPROM_CACHE_LEN; n++) EEPROM.write(n, 0);
+				}
 				eepromEnd();
 			#endif
 
 			#ifdef EZTIME_CACHE_NVS
-				if (_nvs_name == "" || _nvs_key == "") { triggerError(NO_CACHE_SET); return; }
+				if (!*_nvs_name.c_str() || !*_nvs_key.c_str()) { triggerError(NO_CACHE_SET); return; }
 				Preferences prefs;
 				prefs.begin(_nvs_name.c_str(), false);
 				if (delete_section) {
@@ -938,75 +2615,80 @@ String Timezone::getPosix() { return _posix; }
 			#endif
 		}
 
-		bool Timezone::writeCache(String &str) {
+		bool Timezone::writeCache() {
 			uint8_t months_since_jan_2018 = 0;
 			if (year() >= 2018) months_since_jan_2018 = (year(LAST_READ) - 2018) * 12 + month(LAST_READ) - 1;
 
 			#ifdef EZTIME_CACHE_EEPROM
-				if (_eeprom_address < 0) return false;
+				if (_eeprom_address < 0 && !_cache_key) return false;
 
 				info(F("Caching timezone data  "));
-				if (str.length() > MAX_CACHE_PAYLOAD) { triggerError(CACHE_TOO_SMALL); return false; }
 				
-				uint16_t last_byte = _eeprom_address + EEPROM_CACHE_LEN - 1;	
-				uint16_t addr = _eeprom_address;
+				// Put together in memory first. In the shared region 2 bytes key and 2 bytes sequence
+				// number go in front, and the checksum covers those too.
+				uint8_t block[EEPROM_SLOT_LEN];
+				memset(block, 0, sizeof(block));
+				uint8_t header = _cache_key ? 4 : 0;
+				uint8_t len = header + EEPROM_CACHE_LEN;
+				uint8_t *p = block + header;
 				
+				// Cache age in months since 2018, the format, the rule as it is in memory and the
+				// Olson name in what is left. (The rest stays zeroes.)
+				*p++ = months_since_jan_2018;
+				*p++ = EEPROM_CACHE_BINARY;
+				binPutRule(p, _rule->rule);
+				if (!cachePutName(p, block + len - 1, _olson.c_str())) { triggerError(CACHE_TOO_SMALL); return false; }
+
 				eepromBegin();
-				
-				// First byte is cache age, in months since 2018
-				EEPROM.write(addr++, months_since_jan_2018);
-				
-				// Second byte is length of payload
-				EEPROM.write(addr++, str.length());
-				
-				// Followed by payload, compressed. Every 4 bytes to three by encoding only 6 bits, ASCII all-caps
-				str.toUpperCase();
-				uint8_t store = 0;
-				for (uint8_t n = 0; n < str.length(); n++) {
-					unsigned char c = str.charAt(n) - 32;
-					if ( c > 63) c = 0;
-					switch (n % 4) {
-						case 0:
-							store = c << 2;					//all of 1st
-							break;
-						case 1:
-							store |= c >> 4;				//high two of 2nd
-							EEPROM.write(addr++, store);	 
-							store = c << 4;					//low four of 2nd
-							break;
-						case 2:
-							store |= c >> 2;				//high four of 3rd
-							EEPROM.write(addr++, store);
-							store = c << 6;					//low two of third
-							break;
-						case 3:
-							store |= c;						//all of 4th
-							EEPROM.write(addr++, store);
-							store = 0;
+				uint16_t start = _eeprom_address;
+				if (_cache_key) {
+					int8_t current = cacheSlot(_cache_key);
+					if (current >= 0 && eepromSame(slotAddress(current) + header, block + header, EEPROM_CACHE_LEN - 1)) {
+						eepromEnd();
+						infoln(F("(unchanged)"));
+						return true;
 					}
+					int8_t n = freeSlot(_cache_key);
+					if (n < 0) { eepromEnd(); triggerError(CACHE_TOO_SMALL); return false; }
+					uint16_t sequence = _cache_sequence + 1;
+					block[0] = _cache_key >> 8;
+					block[1] = _cache_key;
+					block[2] = sequence >> 8;
+					block[3] = sequence;
+					start = slotAddress(n);
+					_cache_slots[n] = { _cache_key, sequence, true };
+					_cache_sequence = sequence;
+					_cache_next = (n + 1) % _cache_slot_count;
 				}
-				if (store) EEPROM.write(addr++, store);
-				
-				// Fill rest of cache (except last byte) with zeroes
-				for (; addr < last_byte; addr++) EEPROM.write(addr, 0);
 
 				// Add all bytes in cache % 256 and add 42, that is the checksum written to last byte.
 				// The 42 is because then checksum of all zeroes then isn't zero.
-				uint8_t checksum = 0;
-				for (uint16_t n = _eeprom_address; n < last_byte; n++) checksum += EEPROM.read(n);
-				checksum += 42;
-				EEPROM.write(last_byte, checksum);
+				uint8_t checksum = 42;
+				for (uint8_t n = 0; n < len - 1; n++) checksum += block[n];
+				block[len - 1] = checksum;
+				if (!_cache_key && eepromSame(start, block, len)) {
+					eepromEnd();
+					infoln(F("(unchanged)"));
+					return true;
+				}
+
+				// Only the bytes that changed, and the checksum last: a reset halfway through leaves
+				// a bad checksum, not a mix of old and new. In the region the old data is still
+				// in its own slot then.
+				for (uint8_t n = 0; n < len; n++) {
+					if (EEPROM.read(start + n) != block[n]) EEPROM.write(start + n, block[n]);
+				}
 				eepromEnd();
 				infoln();
 				return true;
 			#endif
 			
 			#ifdef EZTIME_CACHE_NVS
-				if (_nvs_name == "" || _nvs_key == "") return false;
+				if (!*_nvs_name.c_str() || !*_nvs_key.c_str()) return false;
 				infoln(F("Caching timezone data"));
 				Preferences prefs;
 				prefs.begin(_nvs_name.c_str(), false);
-				String tmp = String(months_since_jan_2018) + " " + str;
+				String tmp = String(months_since_jan_2018) + " " + _olson.c_str() + " " + _rule->posix;
 				prefs.putString(_nvs_key.c_str(), tmp);
 				prefs.end();
 				return true;
@@ -1014,73 +2696,100 @@ String Timezone::getPosix() { return _posix; }
 		}
 	
 
-		bool Timezone::readCache(String &olson, String &posix, uint8_t &months_since_jan_2018) {
+		bool Timezone::readCache(String &olson, ezRule_t &rule, uint8_t &months_since_jan_2018) {
 
 			#ifdef EZTIME_CACHE_EEPROM
-				if (_eeprom_address < 0) { triggerError(NO_CACHE_SET); return false; }
+				if (_eeprom_address < 0 && !_cache_key) { triggerError(NO_CACHE_SET); return false; }
 				eepromBegin();
-				uint16_t last_byte = _eeprom_address + EEPROM_CACHE_LEN - 1;			
-				
-				for (uint16_t n = _eeprom_address; n <= last_byte; n++) {
-					debug(n);
-					debug(F(" "));
-					debugln(EEPROM.read(n), HEX);
+				// Where the checksummed block starts, and where the data in it starts
+				uint16_t start = _eeprom_address;
+				if (_cache_key) {
+					int8_t slot = cacheSlot(_cache_key);
+					if (slot < 0) { eepromEnd(); return false; }
+					start = slotAddress(slot);
 				}
+				uint8_t header = _cache_key ? 4 : 0;
+				uint8_t last_byte = header + EEPROM_CACHE_LEN - 1;
+
+				// The whole block in one go, every byte read once
+				uint8_t block[EEPROM_SLOT_LEN];
+				for (uint8_t n = 0; n <= last_byte; n++) block[n] = EEPROM.read(start + n);
+				eepromEnd();
+
+				#ifdef EZTIME_DEBUG_COMPILED
+					if (_debug_level >= DEBUG) {
+						for (uint8_t n = 0; n <= last_byte; n++) {
+							debug(start + n);
+							debug(F(" "));
+							debugln(block[n], HEX);
+						}
+					}
+				#endif
 				
 				// return false if checksum incorrect
-				uint8_t checksum = 0;
-				for (uint16_t n = _eeprom_address; n < last_byte; n++) checksum += EEPROM.read(n);
-				checksum += 42;				
-				if (checksum != EEPROM.read(last_byte)) { eepromEnd(); return false; }
+				uint8_t checksum = 42;
+				for (uint8_t n = 0; n < last_byte; n++) checksum += block[n];
+				if (checksum != block[last_byte]) return false;
 				debugln(F("Checksum OK"));
 				
-				// Return false if length impossible
-				uint8_t len = EEPROM.read(_eeprom_address + 1);
+				const uint8_t *image = block + header;
+				months_since_jan_2018 = image[0];
+				char text[MAX_CACHE_PAYLOAD + 1];
+
+				// The rule goes straight in, the name only needs unpacking
+				if (image[1] == EEPROM_CACHE_BINARY) {
+					const uint8_t *p = image + 2;
+					if (!binRule(p, block + last_byte, rule) || !cacheGetName(p, block + last_byte, text, sizeof(text))) return false;
+					olson = text;
+					return true;
+				}
+
+				// Before that it was text, "olson posix". Return false if length impossible.
+				uint8_t len = image[1];
 				debug("Length: "); debugln(len);
-				if (len > MAX_CACHE_PAYLOAD) { eepromEnd(); return false; }
+				if (len > MAX_CACHE_PAYLOAD) return false;
 				
-				// OK, we're gonna decompress
-				olson.reserve(len + 3);		// Everything goes in olson first. Decompression might overshoot 3 
-				months_since_jan_2018 = EEPROM.read(_eeprom_address);
-				
-				for (uint8_t n = 0; n < EEPROM_CACHE_LEN - 3; n++) {
-					uint16_t addr = n + _eeprom_address + 2;
-					uint8_t c = EEPROM.read(addr);
-					uint8_t p = EEPROM.read(addr - 1);	// previous byte
-					switch (n % 3) {
+				// OK, we're gonna decompress: every 3 bytes are 4 characters of 6 bits. The Olson
+				// name gets its case back (best effort) on the way: capitals only at the start and
+				// after '_', '/' and '-'.
+				const uint8_t *packed = image + 2;
+				int16_t first_space = -1;
+				for (uint8_t n = 0; n < len; n++) {
+					const uint8_t *p = packed + n / 4 * 3;
+					uint8_t c;
+					switch (n % 4) {
 						case 0:
-							olson += (char)( ((c & 0b11111100) >> 2) + 32 );
+							c = p[0] >> 2;
 							break;
 						case 1:
-							olson += (char)( ((p & 0b00000011) << 4) + ((c & 0b11110000) >> 4) + 32 );
+							c = (p[0] & 0b00000011) << 4 | p[1] >> 4;
 							break;
 						case 2:
-							olson += (char)( ((p & 0b00001111) << 2) + ((c & 0b11000000) >> 6) + 32 );
-							olson += (char)( (c & 0b00111111) + 32 );
+							c = (p[1] & 0b00001111) << 2 | p[2] >> 6;
+							break;
+						default:
+							c = p[2] & 0b00111111;
 					}
-					if (olson.length() >= len) break;
-				}
-				
-				uint8_t first_space = olson.indexOf(' ');
-				posix = olson.substring(first_space + 1, len);
-				olson = olson.substring(0, first_space);
-				
-				// Restore case of olson (best effort)
-				String olson_lowercase = olson;
-				olson_lowercase.toLowerCase();
-				for (uint8_t n = 1; n < olson.length(); n++) {
-					unsigned char p = olson.charAt(n - 1);	// previous character
-					if (p != '_' && p != '/' && p != '-') {
-						olson.setCharAt(n, olson_lowercase[n]);
+					c += 32;
+					if (first_space < 0) {
+						if (c == ' ') {
+							first_space = n;
+						} else if (n && c >= 'A' && c <= 'Z' && text[n - 1] != '_' && text[n - 1] != '/' && text[n - 1] != '-') {
+							c += 'a' - 'A';
+						}
 					}
+					text[n] = c;
 				}
-				info(F("Cache read. Olson: ")); info(olson); info (F("  Posix: ")); infoln(posix);
-				eepromEnd();
+				if (first_space < 0) return false;
+				text[len] = 0;
+				text[first_space] = 0;
+				olson = text;
+				parsePosix(text + first_space + 1, rule);
 				return true;
 			#endif						
 			
 			#ifdef EZTIME_CACHE_NVS
-				if (_nvs_name == "" || _nvs_key == "") { triggerError(NO_CACHE_SET); return false; }
+				if (!*_nvs_name.c_str() || !*_nvs_key.c_str()) { triggerError(NO_CACHE_SET); return false; }
 				
 				Preferences prefs;
 				prefs.begin(_nvs_name.c_str(), true);
@@ -1093,9 +2802,8 @@ String Timezone::getPosix() { return _posix; }
 				uint8_t second_space = read_string.indexOf(' ', first_space + 1);
 				if (first_space && second_space) {
 					months_since_jan_2018 = read_string.toInt();
-					posix = read_string.substring(second_space + 1);
+					parsePosix(read_string.c_str() + second_space + 1, rule);
 					olson = read_string.substring(first_space + 1, second_space);
-					info(F("Cache read. Olson: ")); info(olson); info (F("  Posix: ")); infoln(posix);
 					return true;
 				}
 				return false;
@@ -1110,30 +2818,30 @@ String Timezone::getPosix() { return _posix; }
 
 void Timezone::setDefault() {
 	defaultTZ = this;
-	debug(F("Default timezone set to ")); debug(_olson); debug(F("  "));debugln(_posix);
+	debug(F("Default timezone set to ")); debug(_olson.c_str()); debug(F("  "));debugln(_rule->posix);
 }
 
 bool Timezone::isDST(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
-	String tzname;
+	const char *tzname;
 	bool is_dst;
 	int16_t offset;
-	t = tzTime(t, local_or_utc, tzname, is_dst, offset);
+	convert(t, local_or_utc, tzname, is_dst, offset);
 	return is_dst;
 }
 
 String Timezone::getTimezoneName(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
-	String tzname;
+	const char *tzname;
 	bool is_dst;
 	int16_t offset;
-	t = tzTime(t, local_or_utc, tzname, is_dst, offset);
+	convert(t, local_or_utc, tzname, is_dst, offset);
 	return tzname;
 }
 
 int16_t Timezone::getOffset(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
-	String tzname;
+	const char *tzname;
 	bool is_dst;
 	int16_t offset;
-	t = tzTime(t, local_or_utc, tzname, is_dst, offset);
+	convert(t, local_or_utc, tzname, is_dst, offset);
 	return offset;
 }
 
@@ -1162,6 +2870,7 @@ void Timezone::setTime(const time_t t, const uint16_t ms /* = 0 */) {
 	_last_sync_time = t + offset * 60;
 	_last_sync_millis = millis() - ms;
 	_time_status = timeSet;
+	_drift_reference = false;
 }
 
 void Timezone::setTime(const uint8_t hr, const uint8_t min, const uint8_t sec, const uint8_t day, const uint8_t mnth, uint16_t yr) {
@@ -1190,30 +2899,73 @@ String Timezone::dateTime(const time_t t, const String format /* = DEFAULT_TIMEF
 	return dateTime(t, LOCAL_TIME, format);
 }
 
+// Into a buffer on the stack, a longer one only for very long formats
 String Timezone::dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const String format /* = DEFAULT_TIMEFORMAT */) {
+	char buffer[64];
+	size_t len = dateTime(buffer, sizeof(buffer), t, local_or_utc, format.c_str());
+	if (len < sizeof(buffer)) return buffer;
+	char *longer = new char[len + 1];
+	dateTime(longer, len + 1, t == TIME_NOW ? LAST_READ : t, local_or_utc, format.c_str());	// the same second
+	String out = longer;
+	delete[] longer;
+	return out;
+}
 
-	String tzname;
-	bool is_dst;
-	int16_t offset;
+size_t Timezone::dateTime(char *buffer, const size_t size, const char *format /* = DEFAULT_TIMEFORMAT */) {
+	return dateTime(buffer, size, TIME_NOW, format);
+}
+
+size_t Timezone::dateTime(char *buffer, const size_t size, const time_t t, const char *format /* = DEFAULT_TIMEFORMAT */) {
+	return dateTime(buffer, size, t, LOCAL_TIME, format);
+}
+
+// Like snprintf(): returns the length of the whole thing, even if not all of it fit
+size_t Timezone::dateTime(char *buffer, const size_t size, time_t t, const ezLocalOrUTC_t local_or_utc, const char *format /* = DEFAULT_TIMEFORMAT */) {
+
+	ezLocalTime_t local;
 
 	if (t == TIME_NOW || t == LAST_READ || local_or_utc == UTC_TIME) {
 		// in these cases we actually want tzTime to translate the time for us
 		// back in to this timezone's time as well as grab the timezone info
 		// from the stored POSIX data
-		t = tzTime(t, UTC_TIME, tzname, is_dst, offset);
+		local.local = convert(t, UTC_TIME, local.tzname, local.is_dst, local.offset);
 	} else {
 		// when receiving a local time we don't want to translate the timestamp
 		// but rather use tzTime to just parse the info about the timezone from
 		// the stored POSIX data
-		tzTime(t, LOCAL_TIME, tzname, is_dst, offset);
+		convert(t, LOCAL_TIME, local.tzname, local.is_dst, local.offset);
+		local.local = t;
 	}
+	ezt::breakTime(local.local, local.tm);
 
-	String tmpstr;
-	uint8_t tmpint8;
-	String out = "";
+	return dateTime(buffer, size, local, format);
+}
 
-	tmElements_t tm;
-	ezt::breakTime(t, tm);
+String Timezone::dateTime(const ezLocalTime_t &local, const String format /* = DEFAULT_TIMEFORMAT */) {
+	char buffer[64];
+	size_t len = dateTime(buffer, sizeof(buffer), local, format.c_str());
+	if (len < sizeof(buffer)) return buffer;
+	char *longer = new char[len + 1];
+	dateTime(longer, len + 1, local, format.c_str());
+	String out = longer;
+	delete[] longer;
+	return out;
+}
+
+// A time from ezt::localTimes(), or one dateTime() above worked out, into text. It has to be
+// from this timezone for the Olson name ('e') to be right.
+size_t Timezone::dateTime(char *buffer, const size_t size, const ezLocalTime_t &local, const char *format /* = DEFAULT_TIMEFORMAT */) {
+
+	const time_t t = local.local;
+	const tmElements_t &tm = local.tm;
+	const char *tzname = local.tzname;
+	const int16_t offset = local.offset;
+
+	uint8_t tmpint8;
+	uint16_t yday;
+	uint8_t week;
+	int16_t iso_year;
+	ezTextOut out(buffer, size);
 
 	int8_t hour12 = tm.Hour % 12;
 	if (hour12 == 0) hour12 = 12;
@@ -1222,12 +2974,12 @@ String Timezone::dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const Str
 
 	bool escape_char = false;
 	
-	for (uint8_t n = 0; n < format.length(); n++) {
+	for (const char *f = format; *f; f++) {
 	
-		char c = format.charAt(n);
+		char c = *f;
 		
 		if (escape_char) {
-			out += String(c);
+			out.add(c);
 			escape_char = false;
 		} else {
 		
@@ -1238,156 +2990,160 @@ String Timezone::dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const Str
 					escape_char = true;
 					break;
 				case 'd':	// Day of the month, 2 digits with leading zeros
-					out += ezt::zeropad(tm.Day, 2);
+					out.number(tm.Day, 2);
 					break;
 				case 'D':	// A textual representation of a day, usually two or three letters
-					out += ezt::dayShortStr(tm.Wday);
+					out.add(ezt::dayShortStr(tm.Wday));
 					break;
 				case 'j':	// Day of the month without leading zeros
-					out += String(tm.Day);
+					out.number(tm.Day);
 					break;
 				case 'l':	// (lowercase L) A full textual representation of the day of the week
-					out += ezt::dayStr(tm.Wday);
+					out.add(ezt::dayStr(tm.Wday));
 					break;
 				case 'N':	// ISO-8601 numeric representation of the day of the week. ( 1 = Monday, 7 = Sunday )
 					tmpint8 = tm.Wday - 1;
 					if (tmpint8 == 0) tmpint8 = 7;
-					out += String(tmpint8);
+					out.number(tmpint8);
 					break;
 				case 'S':	// English ordinal suffix for the day of the month, 2 characters (st, nd, rd, th)
 					switch (tm.Day) {
 						case 1:
 						case 21:
 						case 31:
-							out += F("st"); break;
+							out.add(F("st")); break;
 						case 2:
 						case 22:
-							out += F("nd"); break;
+							out.add(F("nd")); break;
 						case 3:
 						case 23:
-							out += F("rd"); break;
+							out.add(F("rd")); break;
 						default:
-							out += F("th"); break;
+							out.add(F("th")); break;
 					}
 					break;
 				case 'w':	// Numeric representation of the day of the week ( 0 = Sunday )
-					out += String(tm.Wday);
+					out.number(tm.Wday);
 					break;
 				case 'F':	// A full textual representation of a month, such as January or March
-					out += ezt::monthStr(tm.Month);
+					out.add(ezt::monthStr(tm.Month));
 					break;
 				case 'm':	// Numeric representation of a month, with leading zeros
-					out += ezt::zeropad(tm.Month, 2);
+					out.number(tm.Month, 2);
 					break;
 				case 'M':	// A short textual representation of a month, usually three letters
-					out += ezt::monthShortStr(tm.Month);
+					out.add(ezt::monthShortStr(tm.Month));
 					break;
 				case 'n':	// Numeric representation of a month, without leading zeros
-					out += String(tm.Month);
+					out.number(tm.Month);
 					break;
 				case 't':	// Number of days in the given month
-					out += String(monthDays[tm.Month - 1]);
+					out.number(monthDays[tm.Month - 1]);
 					break;
 				case 'Y':	// A full numeric representation of a year, 4 digits
-					out += String(tm.Year + 1970);
+					out.number(tm.Year + 1970);
 					break;
 				case 'y':	// A two digit representation of a year
-					out += ezt::zeropad((tm.Year + 1970) % 100, 2);
+					out.number((tm.Year + 1970) % 100, 2);
 					break;
 				case 'a':	// am or pm
-					out += (tm.Hour < 12) ? F("am") : F("pm");
+					out.add((tm.Hour < 12) ? F("am") : F("pm"));
 					break;
 				case 'A':	// AM or PM
-					out += (tm.Hour < 12) ? F("AM") : F("PM");
+					out.add((tm.Hour < 12) ? F("AM") : F("PM"));
 					break;
 				case 'g':	// 12-hour format of an hour without leading zeros
-					out += String(hour12);
+					out.number(hour12);
 					break;
 				case 'G':	// 24-hour format of an hour without leading zeros
-					out += String(tm.Hour);
+					out.number(tm.Hour);
 					break;
 				case 'h':	// 12-hour format of an hour with leading zeros
-					out += ezt::zeropad(hour12, 2);
+					out.number(hour12, 2);
 					break;
 				case 'H':	// 24-hour format of an hour with leading zeros
-					out += ezt::zeropad(tm.Hour, 2);
+					out.number(tm.Hour, 2);
 					break;
 				case 'i':	// Minutes with leading zeros
-					out += ezt::zeropad(tm.Minute, 2);
+					out.number(tm.Minute, 2);
 					break;
 				case 's':	// Seconds with leading zeros
-					out += ezt::zeropad(tm.Second, 2);
+					out.number(tm.Second, 2);
 					break;
 				case 'T':	// abbreviation for timezone
-					out += tzname;	
+					out.add(tzname);	
 					break;
 				case 'v':	// milliseconds as three digits
-					out += ezt::zeropad(_last_read_ms, 3);				
+					out.number(_last_read_ms, 3);				
 					break;
-				#ifdef EZTIME_NETWORK_ENABLE
+				#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
 					case 'e':	// Timezone identifier (Olson)
-						out += getOlson();
+						out.add(_olson.c_str());
 						break;
 				#endif
 				case 'O':	// Difference to Greenwich time (GMT) in hours and minutes written together (+0200)
 				case 'P':	// Difference to Greenwich time (GMT) in hours and minutes written with colon (+02:00)
 					o = offset;
-					out += (o < 0) ? "+" : "-";		// reversed from our offset
+					out.add((o < 0) ? '+' : '-');		// reversed from our offset
 					if (o < 0) o = 0 - o;
-					out += ezt::zeropad(o / 60, 2);
-					out += (c == 'P') ? ":" : "";
-					out += ezt::zeropad(o % 60, 2);
+					out.number(o / 60, 2);
+					if (c == 'P') out.add(':');
+					out.number(o % 60, 2);
 					break;	
 				case 'Z':	//Timezone offset in seconds. West of UTC is negative, east of UTC is positive.
-					out += String(0 - offset * 60);
+					if (offset > 0) out.add('-');
+					out.number(offset < 0 ? -offset * 60L : offset * 60L);
 					break;
-				case 'z':
-					out += String(dayOfYear(t)); // The day of the year (starting from 0)
-					break;
-				case 'W':
-					out += ezt::zeropad(weekISO(t), 2); // ISO-8601 week number of year, weeks starting on Monday
-					break;
-				case 'X':
-					out += String(yearISO(t)); // ISO-8601 year-week notation year, see https://en.wikipedia.org/wiki/ISO_week_date
+				case 'z':	// The day of the year (starting from 0)
+				case 'W':	// ISO-8601 week number of year, weeks starting on Monday
+				case 'X':	// ISO-8601 year-week notation year, see https://en.wikipedia.org/wiki/ISO_week_date
+					isoDate(ezCalendar::dayOf(t), tm.Year + 1970, yday, week, iso_year);
+					if (c == 'z') out.number(yday);
+					if (c == 'W') out.number(week, 2);
+					if (c == 'X') out.number(iso_year);
 					break;
 				case 'B':
-					out += militaryTZ(t);
+					out.add(militaryLetter(t, LOCAL_TIME));
 					break;
 				default:
-					out += String(c);
+					out.add(c);
 
 			}
 		}
 	}
 	
-	return out;
+	return out.finish();
 }
 
 String Timezone::militaryTZ(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
+	return String(militaryLetter(t, local_or_utc));
+}
+
+char Timezone::militaryLetter(time_t t, const ezLocalOrUTC_t local_or_utc) {
 	t = tzTime(t, local_or_utc);
 	int16_t o = getOffset(t);
-	if (o % 60) return "?"; // If it's not a whole hour from UTC, it's not a timezone with a military letter code
+	if (o % 60) return '?'; // If it's not a whole hour from UTC, it's not a timezone with a military letter code
 	o = o / 60;
-	if (o > 0) return String((char)('M' + o));
-	if (o < 0 && o >= -9) return String((char)('A' - o - 1));	// Minus a negative number == plus 1
-	if (o < -9) return String((char)('A' - o));				// Crazy, they're skipping 'J'
-	return "Z";
+	if (o > 0) return 'M' + o;
+	if (o < 0 && o >= -9) return 'A' - o - 1;	// Minus a negative number == plus 1
+	if (o < -9) return 'A' - o;				// Crazy, they're skipping 'J'
+	return 'Z';
 }
 
 
 uint8_t Timezone::hour(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	return t / 3600 % 24;
+	return ezCalendar::secondOfDay(t) / 3600;
 }
 
 uint8_t Timezone::minute(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	return t / 60 % 60;
+	return ezCalendar::secondOfDay(t) / 60 % 60;
 }
 
 uint8_t Timezone::second(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	return t % 60;
+	return ezCalendar::secondOfDay(t) % 60;
 }
 
 uint16_t Timezone::ms(time_t t /*= TIME_NOW */) {
@@ -1427,57 +3183,91 @@ uint16_t Timezone::year(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_
 
 uint16_t Timezone::dayOfYear(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	time_t jan_1st = ezt::makeTime(0, 0, 0, 1, 1, year(t));
-	return (t - jan_1st) / SECS_PER_DAY;
+	const int32_t days = ezCalendar::dayOf(t);
+	return days - newYearsDay(ezCalendar::year(days));
 }
 
 uint8_t Timezone::hourFormat12(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	uint8_t h = t / 3600 % 12;
+	uint8_t h = ezCalendar::secondOfDay(t) / 3600 % 12;
 	if (h) return h;
 	return 12;
 }
 
 bool Timezone::isAM(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	return (t / 3600 % 24 < 12);
+	return (ezCalendar::secondOfDay(t) / 3600 < 12);
 }
 
 bool Timezone::isPM(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	return (t / 3600 % 24 >= 12);
+	return (ezCalendar::secondOfDay(t) / 3600 >= 12);
 }
 
 
-// Now this is where this gets a little obscure. The ISO year can be different from the
-// actual (Gregorian) year. That is: you can be in january and still be in week 53 of past
-// year, _and_ you can be in december and be in week one of the next. The ISO 8601 
-// definition for week 01 is the week with the Gregorian year's first Thursday in it.  
-// See https://en.wikipedia.org/wiki/ISO_week_date
-//
-#define startISOyear(year...) ezt::makeOrdinalTime(0, 0, 0, FIRST, THURSDAY, JANUARY, year) - 3UL * SECS_PER_DAY;
+// Every UTC time in 'utc' to the local time at which its hour, day, ISO week or month started,
+// for adding up samples per local period. The offset is looked up once for every stretch of
+// times that fall between the same two transitions, so sorted times are fastest. 'keys' may be
+// the same array as 'utc'.
+void Timezone::localBuckets(const time_t utc[], time_t keys[], const size_t count, const ezBucket_t bucket) {
+	uint32_t since[64];
+	size_t n = 0;
+	while (n < count) {
+		const char *tzname;
+		bool is_dst;
+		int16_t offset;
+		convert(utc[n], UTC_TIME, tzname, is_dst, offset);
+		const time_t from = transitionAtOrBefore(utc[n]);
+		const time_t until = transitionAfter(utc[n]);
+		const int32_t shift = -offset * 60L;
+		// A Monday 00:00 local time before anything in the run, so everything is a whole number
+		// of hours, days and weeks after it (Jan 1st 1970 was a Thursday). In 64 bits, as it may
+		// be before 1970 where time_t is unsigned.
+		const int64_t week = 7 * SECS_PER_DAY;
+		const int64_t earliest = (int64_t)utc[n] + shift - BUCKET_SPAN + 3 * SECS_PER_DAY;
+		const int64_t base = earliest - ((earliest % week) + week) % week - 3 * SECS_PER_DAY;
+		const int32_t base_day = base / (int64_t)SECS_PER_DAY;
+		size_t end = n;
+		bool more = true;
+		while (more) {
+			// In pieces that fit on the stack
+			size_t len = 0;
+			while (len < 64 && end + len < count) {
+				const time_t t = utc[end + len];
+				const int64_t d = (int64_t)t + shift - base;
+				if ((from != NO_TRANSITION && t < from) || (until != NO_TRANSITION && t >= until) || d < 0 || d >= 2 * (int64_t)BUCKET_SPAN) break;
+				since[len++] = d;
+			}
+			more = (len == 64);
+			bucketSince(since, len, base_day, bucket);
+			for (size_t m = 0; m < len; m++) keys[end + m] = utc[end + m] + shift - since[m];
+			end += len;
+		}
+		if (end == n) end++;		// cannot happen, but never loop forever
+		n = end;
+	}
+}
+
 uint8_t Timezone::weekISO(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	int16_t yr = year(t);
-	time_t this_year = startISOyear(yr);
-	time_t prev_year = startISOyear(yr - 1);
-	time_t next_year = startISOyear(yr + 1);
-	if (t < this_year) this_year = prev_year;
-	if (t >= next_year) this_year = next_year;
-	return (t - this_year) / ( SECS_PER_DAY * 7UL) + 1;
+	const int32_t days = ezCalendar::dayOf(t);
+	uint16_t yday;
+	uint8_t week;
+	int16_t iso_year;
+	isoDate(days, ezCalendar::year(days), yday, week, iso_year);
+	return week;
 }
 
 uint16_t Timezone::yearISO(time_t t /*= TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) {
 	t = tzTime(t, local_or_utc);
-	int16_t yr = year(t);
-	time_t this_year = startISOyear(yr);
-	time_t next_year = startISOyear(yr + 1);
-	if (t < this_year) return yr - 1;
-	if (t >= next_year) return yr + 1;
-	return yr;
+	const int32_t days = ezCalendar::dayOf(t);
+	uint16_t yday;
+	uint8_t week;
+	int16_t iso_year;
+	isoDate(days, ezCalendar::year(days), yday, week, iso_year);
+	return iso_year;
 }
 
-
 Timezone UTC;
 Timezone *defaultTZ = &UTC;
 
@@ -1486,6 +3276,9 @@ namespace ezt {
 	String dateTime(const String format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(format)); }
 	String dateTime(time_t t, const String format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(t, format)); }
 	String dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const String format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(t, local_or_utc, format)); }
+	size_t dateTime(char *buffer, const size_t size, const char *format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(buffer, size, format)); }
+	size_t dateTime(char *buffer, const size_t size, time_t t, const char *format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(buffer, size, t, format)); }
+	size_t dateTime(char *buffer, const size_t size, time_t t, const ezLocalOrUTC_t local_or_utc, const char *format /* = DEFAULT_TIMEFORMAT */) { return (defaultTZ->dateTime(buffer, size, t, local_or_utc, format)); }
 	uint8_t day(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->day(t, local_or_utc)); } 
 	uint16_t dayOfYear(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->dayOfYear(t, local_or_utc)); }
 	int16_t getOffset(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->getOffset(t, local_or_utc)); }
@@ -1499,7 +3292,9 @@ namespace ezt {
 	uint8_t minute(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->minute(t, local_or_utc)); }
 	uint8_t month(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->month(t, local_or_utc)); } 
 	uint16_t ms(time_t t /* = TIME_NOW */) { return (defaultTZ->ms(t)); }
+	time_t nextTransition(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->nextTransition(t, local_or_utc)); }
 	time_t now() { return  (defaultTZ->now()); }
+	time_t prevTransition(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->prevTransition(t, local_or_utc)); }
 	uint8_t second(time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->second(t, local_or_utc)); } 
 	uint8_t setEvent(void (*function)(), const uint8_t hr, const uint8_t min, const uint8_t sec, const uint8_t day, const uint8_t mnth, uint16_t yr) { return (defaultTZ->setEvent(function,hr, min, sec, day, mnth, yr)); }
 	uint8_t setEvent(void (*function)(), time_t t /* = TIME_NOW */, const ezLocalOrUTC_t local_or_utc /* = LOCAL_TIME */) { return (defaultTZ->setEvent(function, t, local_or_utc)); }
@@ -10,6 +10,10 @@
 // Compiles in NTP updating, timezoned fetching and caching 
 #define EZTIME_NETWORK_ENABLE
 
+// Compiles in a table of all timezones (about 12 kB of flash), so setLocation() finds full
+// Olson names like "Europe/Berlin" without network. Other queries still go to the server.
+// #define EZTIME_TZDB
+
 // Arduino Ethernet shields
 // #define EZTIME_ETHERNET
 
@@ -26,17 +30,29 @@
 #define EZTIME_CACHE_EEPROM
 // #define EZTIME_CACHE_NVS
 
+// Keeps the POSIX string and Olson name of every Timezone in buffers inside the object, not
+// on the heap, for boards with very little RAM. (See README)
+// #define EZTIME_FIXED_STRINGS
+
 // Uncomment if you want to access ezTime functions only after "ezt."
 // (to avoid naming conflicts in bigger projects, e.g.) 
 // #define EZTIME_EZT_NAMESPACE
 
+// Does all the calendar math in 64-bit signed seconds, so times before 1970 and after 2106 work.
+// Needs a 64-bit time_t, which most 32-bit boards do not have. Meant for computers. (See README)
+// #define EZTIME_64BIT_TIME
+
 
 // Warranty void if edited below this point...
 
 
 
 #if !defined(__time_t_defined) // avoid conflict with newlib or other posix libc
-	typedef unsigned long time_t;
+	#ifdef EZTIME_64BIT_TIME
+		typedef long long time_t;
+	#else
+		typedef unsigned long time_t;
+	#endif
 #endif
 
 #include <inttypes.h>
@@ -45,7 +61,15 @@
 #endif
 
 #if !defined(__time_t_defined) // avoid conflict with newlib or other posix libc
-typedef unsigned long time_t;
+	#ifdef EZTIME_64BIT_TIME
+		typedef long long time_t;
+	#else
+		typedef unsigned long time_t;
+	#endif
+#endif
+
+#ifdef EZTIME_64BIT_TIME
+	static_assert(sizeof(time_t) == 8 && (time_t)-1 < 0, "EZTIME_64BIT_TIME needs a 64-bit signed time_t, and this platform's is not");
 #endif
 
 
@@ -65,7 +89,13 @@ typedef enum {
 	CACHE_TOO_SMALL,
 	TOO_MANY_EVENTS,
 	INVALID_DATA,
-	SERVER_ERROR
+	SERVER_ERROR,
+	INVALID_TZIF,
+	TOO_MANY_LOOKUPS,
+	NTP_RATE_LIMITED,	// NTP server sent a "RATE" kiss-o'-death
+	NTP_DENIED,			// NTP server sent a "DENY" or "RSTR" kiss-o'-death
+	TOO_MANY_SOURCES,
+	OUT_OF_MEMORY
 } ezError_t;
 
 typedef enum {
@@ -80,6 +110,21 @@ typedef enum {
 	UTC_TIME
 } ezLocalOrUTC_t;
 
+// What Timezone::localBuckets() rounds times down to, in local time
+typedef enum {
+	BUCKET_HOUR,
+	BUCKET_DAY,
+	BUCKET_WEEK,				// ISO weeks, starting on Monday
+	BUCKET_MONTH
+} ezBucket_t;
+
+typedef enum {
+	LOOKUP_IDLE,				// no background lookup asked for since the last one finished
+	LOOKUP_PENDING,
+	LOOKUP_OK,
+	LOOKUP_FAILED				// see error() for why
+} ezLookupStatus_t;
+
 // Defines that can make your code more readable. For example, if you are looking for the first
 // Thursday in a year, you could write:  time.makeOrdinalTime(0, 0, 0, JANUARY, FIRST, THURSDAY, year)
 
@@ -123,41 +168,240 @@ typedef struct  {
 	uint8_t Wday;   // day of week, sunday is day 1
 	uint8_t Day;
 	uint8_t Month; 
+#ifdef EZTIME_64BIT_TIME
+	int16_t Year;   // offset from 1970, negative before
+#else
 	uint8_t Year;   // offset from 1970; 
+#endif
 } tmElements_t;
 
+// One instant in one timezone, as ezt::localTimes() gives it for every zone of a world clock.
+// Timezone::dateTime() can format it without working anything out again.
+typedef struct {
+	time_t local;				// the local time ...
+	tmElements_t tm;			// ... taken apart
+	int16_t offset;				// minutes, same direction as getOffset()
+	bool is_dst;
+	const char *tzname;			// good until the timezone changes
+} ezLocalTime_t;
+
 typedef enum { 
 	timeNotSet,
 	timeNeedsSync,
 	timeSet
 } timeStatus_t;
 
+// What saveTime() puts away, in RTC memory or wherever survives a reset or deep sleep, for
+// restoreTime() to pick up again
+typedef struct {
+	uint32_t magic;				// RESTORE_MAGIC if it came from saveTime()
+	uint32_t time;				// UTC when saved ...
+	uint16_t ms;				// ... and the milliseconds
+	int16_t drift;				// millis() was running this many ppm fast (slow if negative)
+	uint32_t last_sync;			// UTC of the last NTP update, 0 if there was none
+	uint32_t checksum;
+} ezTimeState_t;
+
+#define RESTORE_MAGIC			0x457A5431		// "EzT1"
+#define RESTORE_UNKNOWN			0xFFFFFFFF		// restoreTime() does not know how long it was out
+#define RESTORE_SLEEP_PPM		200				// how far off the time slept given to restoreTime() may be
+#define RESTORE_MAX_ERROR		500				// milliseconds: a restored time that may be further off than this is timeNeedsSync
+
 typedef struct {
 	time_t time;
 	void (*function)();
 } ezEvent_t;
 
 #define MAX_EVENTS				8
+#define MAX_TIME_SOURCES		4
+#define TIME_SOURCE_INTERVAL	3600			// seconds between reads of the time sources when there are no NTP updates
+
+#define MAX_TZNAME_LEN			7				// longer timezone abbreviations are cut off
+#define MAX_POSIX_LEN			(2 * (MAX_TZNAME_LEN + 2) + 2 * 7 + 2 * 17)	// the longest rule ezRule_t can hold, written out
+#define MAX_OLSON_LEN			39				// longest in the tz database is 32
+
+// A timezone's POSIX string, parsed. Offsets are in minutes, in the same direction as
+// getOffset(): positive is west of UTC.
+typedef struct {
+	int16_t std_offset;
+	int16_t dst_offset;
+	uint8_t start_month;		// 0 if there is no DST
+	uint8_t start_week;			// 1 - 4, 5 means last
+	uint8_t start_dow;			// 0 is Sunday
+	int16_t start_time;			// minutes after local midnight, may be negative or over 24 hours
+	uint8_t end_month;
+	uint8_t end_week;
+	uint8_t end_dow;
+	int16_t end_time;
+	char std_name[MAX_TZNAME_LEN + 1];
+	char dst_name[MAX_TZNAME_LEN + 1];
+} ezRule_t;
+
+// Historical offsets, as found in TZif files. Can be compiled in or loaded with setTZif().
+typedef struct {
+	int16_t offset;				// minutes, same direction as getOffset()
+	bool is_dst;
+	uint8_t name;				// index of the abbreviation in ezTransitions_t.names
+} ezZoneType_t;
+
+typedef struct {
+	uint16_t count;				// number of transitions
+	const time_t *at;			// UTC instants, ascending, at which the zone switches ...
+	const uint8_t *type;		// ... to types[type[n]]
+	const ezZoneType_t *types;	// types[0] applies before the first transition
+	const char *names;			// NUL-separated abbreviations
+} ezTransitions_t;
+
+#ifdef EZTIME_FIXED_STRINGS
+	// Stands in for the Strings a Timezone keeps, with room for N characters. Longer text is cut off.
+	template <uint8_t N> class ezFixedString {
+		public:
+			ezFixedString() { _text[0] = 0; }
+			ezFixedString & operator = (const char *text) {
+				if (text == _text) return *this;
+				uint8_t len = 0;
+				while (len < N && text[len]) { _text[len] = text[len]; len++; }
+				_text[len] = 0;
+				return *this;
+			}
+			ezFixedString & operator = (const String &text) { return *this = text.c_str(); }
+			const char *c_str() const { return _text; }
+		private:
+			char _text[N + 1];
+	};
+#endif
 
-#define TIME_NOW				(int32_t)0x7FFFFFFF			// Two special-meaning time_t values ...
-#define LAST_READ				(int32_t)0x7FFFFFFE			// (So yes, ezTime might malfunction two seconds before everything else...)
+// Reference counted heap block, so copies of a Timezone can share data it allocated
+class ezSharedBlock {
+	public:
+		ezSharedBlock() : _block(NULL) {}
+		ezSharedBlock(const ezSharedBlock &other);
+		ezSharedBlock & operator = (const ezSharedBlock &other);
+		~ezSharedBlock();
+		void *allocate(const size_t size);		// releases the old block, returns zeroed payload
+		void release();
+		void *data() const;
+	private:
+		uint8_t *_block;
+};
+
+// A Timezone's rule: the POSIX string, the parsed version of it, and when DST starts and ends
+// in the year last asked about, so that is worked out once a year instead of on every call.
+typedef struct ezRuleRecord {
+	ezRule_t rule;
+	time_t year_start;			// Jan 1st of the year dst_start and dst_end are for ...
+	time_t year_end;			// ... and of the year after
+	time_t dst_start;			// UTC
+	time_t dst_end;
+	#ifdef EZTIME_FIXED_STRINGS
+		char posix[MAX_POSIX_LEN + 1];
+	#else
+		const char *posix;			// kept right after the record
+		struct ezRuleRecord *next;	// in the pool
+		uint16_t refs;
+	#endif
+} ezRuleRecord_t;
+
+// Timezones with the same POSIX string share one ezRuleRecord_t out of a pool, counted like
+// ezSharedBlock, so a hundred Timezones in five zones keep five rules. With EZTIME_FIXED_STRINGS
+// nothing goes on the heap and every Timezone has its own.
+class ezSharedRule {
+	public:
+		ezSharedRule();
+		#ifdef EZTIME_FIXED_STRINGS
+			ezRuleRecord_t * operator -> () { return &_record; }
+			ezRuleRecord_t & operator * () { return _record; }
+		#else
+			ezSharedRule(const ezSharedRule &other);
+			ezSharedRule & operator = (const ezSharedRule &other);
+			~ezSharedRule();
+			ezRuleRecord_t * operator -> () { return _record; }
+			ezRuleRecord_t & operator * () { return *_record; }
+		#endif
+		bool set(const char *posix, const ezRule_t *parsed = NULL);		// false if out of memory
+	private:
+		#ifdef EZTIME_FIXED_STRINGS
+			ezRuleRecord_t _record;
+		#else
+			ezRuleRecord_t *_record;
+			void release();
+		#endif
+};
+
+// Somewhere other than NTP to get the time from: an RTC chip, a GPS, the host's clock. See
+// addTimeSource(). getTime() works like queryNTP(): it gives the time and the millis() at which
+// it was that time. Sources that keep time themselves, like RTC chips, can take setTime(),
+// which ezTime calls after it got the time from somewhere better.
+class ezTimeSource {
+	public:
+		virtual ~ezTimeSource() {}
+		virtual bool getTime(time_t &t, unsigned long &measured_at) = 0;
+		virtual uint16_t precision() = 0;			// milliseconds it may be off
+		virtual bool setTime(const time_t, const unsigned long) { return false; }
+};
+
+#define PPS_PRECISION			1				// milliseconds
+#define PPS_TIMEOUT				1500			// no edge for this long: ezPpsSource has lost the signal
+
+// A pulse-per-second output, from a GPS for instance: edge() is called from the interrupt on
+// every whole second, the seconds themselves come from 'coarse', which has to be right to
+// within half a second.
+class ezPpsSource : public ezTimeSource {
+	public:
+		ezPpsSource(ezTimeSource &coarse) : _coarse(coarse), _edge(0), _seen(false) {}
+		void edge();
+		bool getTime(time_t &t, unsigned long &measured_at);
+		uint16_t precision() { return PPS_PRECISION; }
+	private:
+		ezTimeSource &_coarse;
+		volatile uint32_t _edge;					// millis() at the last one
+		volatile bool _seen;
+};
+
+#ifndef EZTIME_64BIT_TIME
+	#define TIME_NOW			(int32_t)0x7FFFFFFF			// Three special-meaning time_t values ...
+	#define LAST_READ			(int32_t)0x7FFFFFFE			// (So yes, ezTime might malfunction three seconds before everything else...)
+	#define NO_TRANSITION		(int32_t)0x7FFFFFFD			// returned when the offset never changes again (or never did)
+#else
+	#define TIME_NOW			(int64_t)0x7FFFFFFFFFFFFFFF	// ... and at the very end of 64-bit time, so 2038 is like any other year
+	#define LAST_READ			(int64_t)0x7FFFFFFFFFFFFFFE
+	#define NO_TRANSITION		(int64_t)0x7FFFFFFFFFFFFFFD
+#endif
 
 #define NTP_PACKET_SIZE			48
 #define NTP_LOCAL_PORT			4242
 #define NTP_SERVER				"pool.ntp.org"
 #define NTP_TIMEOUT				1500			// milliseconds
 #define NTP_INTERVAL			1801				// default update interval in seconds
-#define NTP_RETRY				20				// Retry after this many seconds on failed NTP
+#define NTP_RETRY				20				// Retry after this many seconds on failed NTP ...
+#define NTP_RETRY_MAX			1800			// ... doubling for every failure after that, up to this (or the interval)
+#define NTP_JITTER				20				// percent by which every wait is randomly made shorter or longer
+#define NTP_MAX_SLOWDOWN		4				// a "RATE" kiss-o'-death doubles the interval, up to 2^this times
+#define NTP_DNS_TTL				3600			// seconds before the NTP server's name is looked up again
+#define NTP_DNS_ADDRESSES		4				// addresses remembered for it, pool names give a different one now and then
+#define NTP_SERVE_PORT			123				// default port for serveNTP()
+#define NTP_BROADCAST_PORT		123				// default port for listenNTP()
+#define NTP_BROADCAST_DELAY		2				// milliseconds a broadcast is assumed to take until measured ...
+#define NTP_CALIBRATE_INTERVAL	21600			// ... which is done again after this many seconds
+#define NTP_PRECISION			25				// milliseconds an NTP update is taken to be good to, against time sources
 #define NTP_STALE_AFTER			3602				// If update due for this many seconds, set timeStatus to timeNeedsSync
 
 #define TIMEZONED_REMOTE_HOST	"timezoned.rop.nl"
 #define TIMEZONED_REMOTE_PORT	2342
 #define TIMEZONED_LOCAL_PORT	2342
 #define TIMEZONED_TIMEOUT		2000			// milliseconds
+#define TIMEZONED_MIN_GAP		3100			// milliseconds between background lookups, server ignores faster ones
+#define MAX_LOOKUPS				10				// background lookups waiting, and locations per setLocations()
+#define TIMEZONED_QUERY_SUFFIX	"#B1"			// asks for binary replies in format 1, "" for text replies
+#define TIMEZONED_BINARY_MARK	0xEB			// first byte of a binary reply, never starts a text one
+#define TIMEZONED_BINARY_VERSION	1
 
 #define EEPROM_CACHE_LEN		50
-#define MAX_CACHE_PAYLOAD		((EEPROM_CACHE_LEN - 3) / 3) * 4 + ( (EEPROM_CACHE_LEN - 3) % 3)	// 2 bytes for len and date, then 4 to 3 (6-bit) compression on rest 
+#define MAX_CACHE_PAYLOAD		((EEPROM_CACHE_LEN - 3) / 3) * 4 + ( (EEPROM_CACHE_LEN - 3) % 3)	// old text format: 2 bytes for len and date, then 4 to 3 (6-bit) compression on rest 
+#define EEPROM_CACHE_BINARY		0xB1			// where the text format had its length: binary rule and packed Olson name, format 1
 #define MAX_CACHE_AGE_MONTHS	6
+#define EEPROM_SLOT_LEN			(EEPROM_CACHE_LEN + 4)		// in the shared region, with 2 bytes key and 2 bytes sequence number
+#define EEPROM_CACHE_SLOTS		8				// slots used at most in the region given to setCacheRegion()
 
 // Various date-time formats
 #define ATOM 				"Y-m-d\\TH:i:sP"
@@ -175,9 +419,14 @@ typedef struct {
 #define ISO8601_YWD			"X-\\WW-N"
 #define DEFAULT_TIMEFORMAT	COOKIE
 
+#include "ezTimeCalendar.h"		// makeTime(), makeOrdinalTime(), compileTime() and EZT_ZONE(), all constexpr
+
+class Timezone;
+
 namespace ezt {
+	bool addTimeSource(ezTimeSource &source);
 	void breakTime(const time_t time, tmElements_t &tm);
-	time_t compileTime(const String compile_date = __DATE__, const String compile_time = __TIME__);
+	time_t compileTime(const String compile_date, const String compile_time = __TIME__);
 	String dayShortStr(const uint8_t month);
 	String dayStr(const uint8_t month);
 	void deleteEvent(const uint8_t event_handle);
@@ -185,23 +434,32 @@ namespace ezt {
 	ezError_t error(const bool reset = false);
 	String errorString(const ezError_t err = LAST_ERROR);
 	void events();
-	time_t makeOrdinalTime(const uint8_t hour, const uint8_t minute, const uint8_t second, uint8_t ordinal, const uint8_t wday, const uint8_t month, uint16_t year);
-	time_t makeTime(const uint8_t hour, const uint8_t minute, const uint8_t second, const uint8_t day, const uint8_t month, const uint16_t year);
+	time_t localTimes(Timezone *zones[], ezLocalTime_t times[], const uint8_t count, time_t t = TIME_NOW);
 	time_t makeTime(tmElements_t &tm);
 	bool minuteChanged();
 	String monthShortStr(const uint8_t month);
 	String monthStr(const uint8_t month);
+	void removeTimeSource(ezTimeSource &source);
 	bool secondChanged();
 	void setDebug(const ezDebugLevel_t level);
 	void setDebug(const ezDebugLevel_t level, Print &device);
+	bool restoreTime(const ezTimeState_t &state, const uint32_t slept_ms = RESTORE_UNKNOWN);
+	bool saveTime(ezTimeState_t &state);
 	timeStatus_t timeStatus();
 	String urlEncode(const String str);
 	String zeropad(const uint32_t number, const uint8_t length);
 
 	#ifdef EZTIME_NETWORK_ENABLE
+		bool listenNTP(const uint16_t port = NTP_BROADCAST_PORT);
 		bool queryNTP(const String server, time_t &t, unsigned long &measured_at);
+		bool serveNTP(const uint16_t port = NTP_SERVE_PORT);
 		void setInterval(const uint16_t seconds = 0);
+		#ifdef EZTIME_CACHE_EEPROM
+			bool setCacheRegion(const int16_t address, const uint16_t length);
+		#endif
 		void setServer(const String ntp_server = NTP_SERVER);
+		void setTimezoneServer(const String host = TIMEZONED_REMOTE_HOST, const uint16_t port = TIMEZONED_REMOTE_PORT);
+		bool setLocations(Timezone *zones[], const String locations[], const uint8_t count);
 		void updateNTP();
 		bool waitForSync(const uint16_t timeout = 0);
 		time_t lastNtpUpdateTime();
@@ -216,19 +474,27 @@ class Timezone {
 
 	public:
 		Timezone(const bool locked_to_UTC = false);
+		~Timezone();
 		String dateTime(const String format = DEFAULT_TIMEFORMAT);
 		String dateTime(time_t t, const String format = DEFAULT_TIMEFORMAT);
 		String dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const String format = DEFAULT_TIMEFORMAT);
+		size_t dateTime(char *buffer, const size_t size, const char *format = DEFAULT_TIMEFORMAT);
+		size_t dateTime(char *buffer, const size_t size, time_t t, const char *format = DEFAULT_TIMEFORMAT);
+		size_t dateTime(char *buffer, const size_t size, time_t t, const ezLocalOrUTC_t local_or_utc, const char *format = DEFAULT_TIMEFORMAT);
+		String dateTime(const ezLocalTime_t &local, const String format = DEFAULT_TIMEFORMAT);
+		size_t dateTime(char *buffer, const size_t size, const ezLocalTime_t &local, const char *format = DEFAULT_TIMEFORMAT);
 		uint8_t day(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint16_t dayOfYear(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		int16_t getOffset(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		String getPosix();
+		size_t getPosix(char *buffer, const size_t size);
 		String getTimezoneName(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint8_t hour(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint8_t hourFormat12(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		bool isAM(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		bool isDST(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		bool isPM(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);		
+		void localBuckets(const time_t utc[], time_t keys[], const size_t count, const ezBucket_t bucket);
 		String militaryTZ(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint8_t minute(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint8_t month(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);	
@@ -239,42 +505,99 @@ class Timezone {
 		uint8_t setEvent(void (*function)(), const uint8_t hr, const uint8_t min, const uint8_t sec, const uint8_t day, const uint8_t mnth, uint16_t yr);
 		uint8_t setEvent(void (*function)(), time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		bool setPosix(const String posix);
+		bool setPosix(const char *posix);
+		bool setPosix(const ezZone_t &zone);
 		void setTime(const time_t t, const uint16_t ms = 0);
 		void setTime(const uint8_t hr, const uint8_t min, const uint8_t sec, const uint8_t day, const uint8_t mnth, uint16_t yr);
 		time_t tzTime(time_t t = TIME_NOW, ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		time_t tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset);		
+		time_t tzTime(time_t t, ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset);
+		time_t tzTime(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset, time_t &valid_until);
+		time_t nextTransition(time_t t = TIME_NOW, ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
+		time_t nextTransition(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset);
+		time_t prevTransition(time_t t = TIME_NOW, ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
+		time_t prevTransition(time_t t, ezLocalOrUTC_t local_or_utc, String &tzname, bool &is_dst, int16_t &offset);
+		bool setTransitions(const ezTransitions_t &transitions);
+		bool setTZif(const uint8_t *tzif, const size_t len);
+		void clearTransitions();
+		const ezTransitions_t *getTransitions();
+		const ezRule_t & getRule();
 		uint8_t weekISO(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint8_t weekday(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 		uint16_t year(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);	
 		uint16_t yearISO(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	private:
-		String _posix, _olson;
+		#ifdef EZTIME_FIXED_STRINGS
+			ezFixedString<MAX_OLSON_LEN> _olson;
+		#else
+			String _olson;
+		#endif
+		ezSharedRule _rule;
 		bool _locked_to_UTC;
+		const ezTransitions_t *_transitions;
+		uint16_t _last_transition;
+		ezSharedBlock _tzif;
+		bool setRule(const char *posix, const ezRule_t *parsed = NULL);
+		bool setRule(const ezRule_t &rule);
+		time_t convert(time_t t, ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset);
+		bool transitionOffset(const time_t t, const ezLocalOrUTC_t local_or_utc, const char *&tzname, bool &is_dst, int16_t &offset);
+		int32_t findTransition(const time_t t);
+		time_t transitionAfter(const time_t t);
+		time_t transitionAtOrBefore(const time_t t);
+		time_t findChange(time_t t, ezLocalOrUTC_t local_or_utc, const bool forward, String &tzname, bool &is_dst, int16_t &offset);
+		char militaryLetter(time_t t, const ezLocalOrUTC_t local_or_utc);
+		friend time_t ezt::localTimes(Timezone *zones[], ezLocalTime_t times[], const uint8_t count, time_t t);
  		
-	#ifdef EZTIME_NETWORK_ENABLE
+	#if defined(EZTIME_NETWORK_ENABLE) || defined(EZTIME_TZDB)
 		public:
 			bool setLocation(const String location = "GeoIP");
 			String getOlson();
+			size_t getOlson(char *buffer, const size_t size);
 			String getOlsen();
+	#endif
+	#ifdef EZTIME_TZDB
+		private:
+			bool setLocationFromDB(const String &location);
+	#endif
+	#ifdef EZTIME_NETWORK_ENABLE
+		public:
+			bool setLocationAsync(const String location = "GeoIP", void (*callback)(Timezone &tz, const bool success) = NULL);
+			ezLookupStatus_t lookupStatus();
+		private:
+			ezLookupStatus_t _lookup_status;
+			bool applyLocationReply(String &recv);
+			bool applyLocationReply(const uint8_t *&p, const uint8_t *end, const bool binary);
+			bool locationFound();
+			static void lookupEvents();
+			static void waitForLookupGap();
+			static void lookupSent();
+			friend void ezt::events();
+			friend bool ezt::setLocations(Timezone *zones[], const String locations[], const uint8_t count);
 		#ifdef EZTIME_CACHE_EEPROM
 			public:
 				bool setCache(const int16_t address);
+				bool setCache(const String key);
 			private:
 				int16_t _eeprom_address;
+				uint16_t _cache_key;			// in the shared region, 0 if not there
 		#endif
 		#ifdef EZTIME_CACHE_NVS
 			public:
 				bool setCache(const String name, const String key);
 			private:
-				String _nvs_name, _nvs_key;
+				#ifdef EZTIME_FIXED_STRINGS
+					ezFixedString<15> _nvs_name, _nvs_key;		// NVS takes 15 characters at most
+				#else
+					String _nvs_name, _nvs_key;
+				#endif
 		#endif
  		#if defined(EZTIME_CACHE_EEPROM) || defined(EZTIME_CACHE_NVS)
  			public:
 				void clearCache(const bool delete_section = false);
  			private:
  				bool setCache();
-  				bool writeCache(String &str);
- 				bool readCache(String &olson, String &posix, uint8_t &months_since_jan_2018);
+  				bool writeCache();
+ 				bool readCache(String &olson, ezRule_t &rule, uint8_t &months_since_jan_2018);
  				uint8_t _cache_month;
 		#endif
 	#endif	
@@ -289,6 +612,9 @@ namespace ezt {
 	String dateTime(const String format = DEFAULT_TIMEFORMAT);
 	String dateTime(time_t t, const String format = DEFAULT_TIMEFORMAT);
 	String dateTime(time_t t, const ezLocalOrUTC_t local_or_utc, const String format = DEFAULT_TIMEFORMAT);
+	size_t dateTime(char *buffer, const size_t size, const char *format = DEFAULT_TIMEFORMAT);
+	size_t dateTime(char *buffer, const size_t size, time_t t, const char *format = DEFAULT_TIMEFORMAT);
+	size_t dateTime(char *buffer, const size_t size, time_t t, const ezLocalOrUTC_t local_or_utc, const char *format = DEFAULT_TIMEFORMAT);
 	uint8_t day(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME); 
 	uint16_t dayOfYear(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	int16_t getOffset(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
@@ -302,7 +628,9 @@ namespace ezt {
 	uint8_t minute(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	uint8_t month(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME); 
 	uint16_t ms(time_t t = TIME_NOW);
+	time_t nextTransition(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	time_t now();
+	time_t prevTransition(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	uint8_t second(time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
 	uint8_t setEvent(void (*function)(), const uint8_t hr, const uint8_t min, const uint8_t sec, const uint8_t day, const uint8_t mnth, uint16_t yr);
 	uint8_t setEvent(void (*function)(), time_t t = TIME_NOW, const ezLocalOrUTC_t local_or_utc = LOCAL_TIME);
@@ -0,0 +1,227 @@
+/*
+ * Calendar arithmetic the compiler can do: makeTime(), makeOrdinalTime(), breakTime() and
+ * compileTime() as constexpr functions, and EZT_ZONE(), which parses a POSIX timezone string
+ * while compiling. Included by ezTime.h. It is all C++11, where a constexpr function is a
+ * single return statement, so it works with the compilers the Arduino cores come with.
+ */
+
+#ifndef _EZTIME_CALENDAR_H_
+#define _EZTIME_CALENDAR_H_
+
+// A POSIX string and the rule EZT_ZONE() parsed out of it, for Timezone::setPosix()
+typedef struct {
+	ezRule_t rule;
+	const char *posix;
+} ezZone_t;
+
+// Use it to initialise a constexpr ezZone_t, so the compiler does the parsing, and tells you if
+// it cannot make sense of the string
+#define EZT_ZONE(posix)		(ezZone_t{ ezCalendar::zoneRule(posix), posix })
+
+namespace ezCalendar {
+
+	//
+	// Day numbers: days since Jan 1st 1970, which may be negative. This is Howard Hinnant's
+	// days_from_civil and civil_from_days (http://howardhinnant.github.io/date_algorithms.html),
+	// which count years from March 1st so the leap day comes last, in eras of 400 years.
+	//
+
+	constexpr int32_t era(const int32_t year) { return (year >= 0 ? year : year - 399) / 400; }
+
+	constexpr int32_t dayOfMarchYear(const int32_t month, const int32_t day) { return (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; }
+
+	constexpr int32_t fromMarchYear(const int32_t year, const int32_t yoe, const int32_t doy) {
+		return era(year) * 146097L + yoe * 365L + yoe / 4 - yoe / 100 + doy - 719468L;
+	}
+
+	// Day number of a date. Days past the end of the month, and month 13, run on into the next.
+	constexpr int32_t days(const int32_t year, const int32_t month, const int32_t day) {
+		return fromMarchYear(year - (month <= 2), year - (month <= 2) - era(year - (month <= 2)) * 400, dayOfMarchYear(month, day));
+	}
+
+	constexpr int32_t eraOfDay(const int32_t z) { return (z >= 0 ? z : z - 146096L) / 146097L; }
+	constexpr uint32_t dayOfEra(const int32_t days) { return days + 719468L - eraOfDay(days + 719468L) * 146097L; }
+	constexpr uint32_t yearOfEra(const uint32_t doe) { return (doe - doe / 1460 + doe / 36524L - doe / 146096L) / 365; }
+	constexpr uint32_t marchDay(const uint32_t doe) { return doe - (365 * yearOfEra(doe) + yearOfEra(doe) / 4 - yearOfEra(doe) / 100); }
+	constexpr uint32_t marchMonth(const uint32_t doy) { return (5 * doy + 2) / 153; }		// 0 is March
+
+	// And the date of a day number
+	constexpr int16_t year(const int32_t days) {
+		return yearOfEra(dayOfEra(days)) + eraOfDay(days + 719468L) * 400 + (marchDay(dayOfEra(days)) >= 306);
+	}
+	constexpr uint8_t month(const int32_t days) {
+		return marchMonth(marchDay(dayOfEra(days))) < 10 ? marchMonth(marchDay(dayOfEra(days))) + 3 : marchMonth(marchDay(dayOfEra(days))) - 9;
+	}
+	constexpr uint8_t day(const int32_t days) {
+		return marchDay(dayOfEra(days)) - (153 * marchMonth(marchDay(dayOfEra(days))) + 2) / 5 + 1;
+	}
+	constexpr uint8_t weekday(const int32_t days) { return (days % 7 + 11) % 7 + 1; }	// 1 is Sunday: Jan 1st 1970 was a Thursday
+
+	// The 'ordinal' (FIRST to FOURTH, or LAST as 5 or 0) 'wday' of a month, as a day number
+	constexpr int32_t onOrAfter(const int32_t days, const uint8_t wday) { return days + (wday + 7 - weekday(days)) % 7; }
+	constexpr int32_t ordinalDay(const uint8_t ordinal, const uint8_t wday, const uint8_t month, const int32_t year) {
+		return (ordinal == 0 || ordinal == 5) ? onOrAfter(days(year, month + 1, 1), wday) - 7 : onOrAfter(days(year, month, 1), wday) + (ordinal - 1) * 7;
+	}
+
+#ifdef EZTIME_64BIT_TIME
+
+	// Seconds since 1970 in 64 bits, negative before it
+	constexpr time_t seconds(const int32_t days, const uint8_t hour, const uint8_t minute, const uint8_t second) {
+		return days * (time_t)SECS_PER_DAY + hour * 3600L + minute * 60L + second;
+	}
+
+	// The day number of a time, and how far into that day it is. Rounded down, also before 1970.
+	constexpr int32_t dayOf(const time_t t) { return (t >= 0 ? t : t - (time_t)SECS_PER_DAY + 1) / (time_t)SECS_PER_DAY; }
+	constexpr uint32_t secondOfDay(const time_t t) { return t - dayOf(t) * (time_t)SECS_PER_DAY; }
+
+#else
+
+	// 32 bits of seconds since 1970, wrapped around like the Time library always did
+	constexpr time_t seconds(const int32_t days, const uint8_t hour, const uint8_t minute, const uint8_t second) {
+		return (time_t)(uint32_t)(days * SECS_PER_DAY + hour * 3600UL + minute * 60UL + second);
+	}
+
+	constexpr int32_t dayOf(const time_t t) { return (uint32_t)t / SECS_PER_DAY; }
+	constexpr uint32_t secondOfDay(const time_t t) { return (uint32_t)t % SECS_PER_DAY; }
+
+#endif
+
+	// 'second' of the day, from secondOfDay()
+	constexpr tmElements_t broken(const uint32_t second, const int32_t days) {
+		return tmElements_t{ (uint8_t)(second % 60), (uint8_t)(second / 60 % 60), (uint8_t)(second / 3600), weekday(days), day(days), month(days),
+			(decltype(tmElements_t::Year))(year(days) - 1970) };
+	}
+
+	//
+	// __DATE__ ("Aug 25 2018", " 5" for single digits) and __TIME__ ("14:23:45")
+	//
+
+	constexpr uint8_t twoDigits(const char *p) { return (p[0] == ' ' ? 0 : (p[0] - '0') * 10) + p[1] - '0'; }
+
+	constexpr uint8_t monthNamed(const char *name, const uint8_t month = 1) {
+		return month > 12 ? 0 :
+			(name[0] == "JanFebMarAprMayJunJulAugSepOctNovDec"[month * 3 - 3] &&
+			 name[1] == "JanFebMarAprMayJunJulAugSepOctNovDec"[month * 3 - 2] &&
+			 name[2] == "JanFebMarAprMayJunJulAugSepOctNovDec"[month * 3 - 1]) ? month : monthNamed(name, month + 1);
+	}
+
+	//
+	// POSIX strings, read the same way as parsePosix() in ezTime.cpp does at runtime. A pointer
+	// into the string stands for how far the reading got.
+	//
+
+	constexpr bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+	constexpr bool isAlpha(const char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+	constexpr const char *digitsEnd(const char *p) { return isDigit(*p) ? digitsEnd(p + 1) : p; }
+	constexpr int16_t number(const char *p, const int16_t n = 0) { return isDigit(*p) ? number(p + 1, n * 10 + *p - '0') : n; }
+
+	// A name is letters, or anything between '<' and '>'
+	constexpr const char *alphaEnd(const char *p) { return isAlpha(*p) ? alphaEnd(p + 1) : p; }
+	constexpr const char *bracketEnd(const char *p) { return (*p && *p != '>') ? bracketEnd(p + 1) : p; }
+	constexpr const char *nameStart(const char *p) { return *p == '<' ? p + 1 : p; }
+	constexpr const char *nameStop(const char *p) { return *p == '<' ? bracketEnd(p + 1) : alphaEnd(p); }
+	constexpr const char *nameEnd(const char *p) { return (*p == '<' && *nameStop(p) == '>') ? nameStop(p) + 1 : nameStop(p); }
+	constexpr char nameChar(const char *p, const uint8_t n) { return (n < MAX_TZNAME_LEN && nameStart(p) + n < nameStop(p)) ? nameStart(p)[n] : 0; }
+	constexpr bool isUTC(const char *p) { return nameStop(p) == nameStart(p) + 3 && nameStart(p)[0] == 'U' && nameStart(p)[1] == 'T' && nameStart(p)[2] == 'C'; }
+
+	// [+|-]hh[:mm[:ss]], in minutes. Seconds are ignored.
+	constexpr const char *signEnd(const char *p) { return (*p == '+' || *p == '-') ? p + 1 : p; }
+	constexpr const char *colonEnd(const char *p) { return *p == ':' ? digitsEnd(p + 1) : p; }
+	constexpr const char *clockEnd(const char *p) { return colonEnd(colonEnd(digitsEnd(signEnd(p)))); }
+	constexpr int16_t clockMinutes(const char *p) { return number(p) * 60 + (*digitsEnd(p) == ':' ? number(digitsEnd(p) + 1) : 0); }
+	constexpr int16_t clock(const char *p) { return *p == '-' ? -clockMinutes(p + 1) : clockMinutes(signEnd(p)); }
+
+	// ",Mm.w.d[/time]". 'q' is where the month's digits end.
+	constexpr bool dateValid(const char *p, const char *q) {
+		return p[0] == ',' && p[1] == 'M' && q[0] == '.' && isDigit(q[1]) && q[2] == '.' && isDigit(q[3]) &&
+			number(p + 2) >= 1 && number(p + 2) <= 12 && q[1] >= '1' && q[1] <= '5' && q[3] <= '6';
+	}
+	constexpr bool dateValid(const char *p) { return p[0] == ',' && p[1] == 'M' && dateValid(p, digitsEnd(p + 2)); }
+	constexpr const char *dateEnd(const char *q) { return q[4] == '/' ? clockEnd(q + 5) : q + 4; }
+	constexpr const char *dateEnd(const char *p, const bool valid) { return valid ? dateEnd(digitsEnd(p + 2)) : p; }
+	constexpr int16_t dateTime(const char *q) { return q[4] == '/' ? clock(q + 5) : 120; }
+
+	// Where the parts of a rule start
+	constexpr const char *stdOffsetAt(const char *posix) { return nameEnd(posix); }
+	constexpr const char *dstNameAt(const char *posix) { return clockEnd(stdOffsetAt(posix)); }
+	constexpr bool hasDST(const char *posix) { return *dstNameAt(posix) && *dstNameAt(posix) != ','; }
+	constexpr const char *dstOffsetAt(const char *posix) { return nameEnd(dstNameAt(posix)); }
+	constexpr bool hasDSTOffset(const char *posix) { return *dstOffsetAt(posix) && *dstOffsetAt(posix) != ','; }
+	constexpr const char *startAt(const char *posix) { return hasDSTOffset(posix) ? clockEnd(dstOffsetAt(posix)) : dstOffsetAt(posix); }
+	constexpr const char *endAt(const char *posix) { return dateEnd(startAt(posix), dateValid(startAt(posix))); }
+	constexpr bool hasDates(const char *posix) { return hasDST(posix) && dateValid(startAt(posix)) && dateValid(endAt(posix)); }
+
+	constexpr int16_t stdOffset(const char *posix) { return clock(stdOffsetAt(posix)); }
+	constexpr int16_t dstOffset(const char *posix) { return (hasDST(posix) && hasDSTOffset(posix)) ? clock(dstOffsetAt(posix)) : stdOffset(posix) - 60; }
+	constexpr char stdChar(const char *posix, const uint8_t n) { return (isUTC(posix) && stdOffset(posix)) ? (n < 3 ? '?' : 0) : nameChar(posix, n); }
+	constexpr char dstChar(const char *posix, const uint8_t n) { return hasDST(posix) ? nameChar(dstNameAt(posix), n) : 0; }
+	// A field of a date that was read right, 0 otherwise
+	constexpr uint8_t dateMonth(const char *p, const bool valid) { return valid ? number(p + 2) : 0; }
+	constexpr uint8_t dateWeek(const char *p, const bool valid) { return valid ? digitsEnd(p + 2)[1] - '0' : 0; }
+	constexpr uint8_t dateDow(const char *p, const bool valid) { return valid ? digitsEnd(p + 2)[3] - '0' : 0; }
+	constexpr int16_t dateTime(const char *p, const bool valid) { return valid ? dateTime(digitsEnd(p + 2)) : 0; }
+
+	#if MAX_TZNAME_LEN != 7
+		#error "rule() below spells out the characters of the names, one for every MAX_TZNAME_LEN"
+	#endif
+
+	constexpr ezRule_t rule(const char *posix) {
+		return ezRule_t{
+			stdOffset(posix),
+			dstOffset(posix),
+			dateMonth(startAt(posix), hasDates(posix)),
+			dateWeek(startAt(posix), hasDates(posix)),
+			dateDow(startAt(posix), hasDates(posix)),
+			dateTime(startAt(posix), hasDates(posix)),
+			dateMonth(endAt(posix), hasDates(posix)),
+			dateWeek(endAt(posix), hasDates(posix)),
+			dateDow(endAt(posix), hasDates(posix)),
+			dateTime(endAt(posix), hasDates(posix)),
+			{ stdChar(posix, 0), stdChar(posix, 1), stdChar(posix, 2), stdChar(posix, 3), stdChar(posix, 4), stdChar(posix, 5), stdChar(posix, 6), 0 },
+			{ dstChar(posix, 0), dstChar(posix, 1), dstChar(posix, 2), dstChar(posix, 3), dstChar(posix, 4), dstChar(posix, 5), dstChar(posix, 6), 0 }
+		};
+	}
+
+	// A name and an offset with digits, and nothing after them, or a DST name, maybe an offset,
+	// two dates and nothing after those
+	constexpr bool usable(const char *posix) {
+		return nameStop(posix) > nameStart(posix) && digitsEnd(signEnd(stdOffsetAt(posix))) > signEnd(stdOffsetAt(posix)) &&
+			(hasDST(posix) ? (hasDates(posix) && !*dateEnd(endAt(posix), true)) : !*dstNameAt(posix));
+	}
+
+	// Not constexpr, on purpose: EZT_ZONE() of a string it cannot use ends up here, which stops
+	// the compiler with this name in the message. At runtime it parses the string the usual way.
+	ezRule_t notAValidPosixString(const char *posix);
+
+	constexpr ezRule_t zoneRule(const char *posix) { return usable(posix) ? rule(posix) : notAValidPosixString(posix); }
+
+}
+
+namespace ezt {
+
+	// Both take full years, or years since 1970 up to 68
+	constexpr time_t makeTime(const uint8_t hour, const uint8_t minute, const uint8_t second, const uint8_t day, const uint8_t month, const uint16_t year) {
+		return ezCalendar::seconds(ezCalendar::days(year > 68 ? year : year + 1970, month, day), hour, minute, second);
+	}
+
+	// makeOrdinalTime allows you to resolve "second thursday in September in 2018" into a number of seconds since 1970
+	// (Very useful for the timezone calculations that ezTime does internally)
+	// If ordinal is 0 or 5 it is taken to mean "the last $wday in $month"
+	constexpr time_t makeOrdinalTime(const uint8_t hour, const uint8_t minute, const uint8_t second, const uint8_t ordinal, const uint8_t wday, const uint8_t month, const uint16_t year) {
+		return ezCalendar::seconds(ezCalendar::ordinalDay(ordinal, wday, month, year > 68 ? year : year + 1970), hour, minute, second);
+	}
+
+	constexpr tmElements_t breakTime(const time_t t) { return ezCalendar::broken(ezCalendar::secondOfDay(t), ezCalendar::dayOf(t)); }
+
+	// When this file was compiled, in the time of the computer that did it. 0 if the date makes
+	// no sense.
+	constexpr time_t compileTime(const char *compile_date = __DATE__, const char *compile_time = __TIME__) {
+		return ezCalendar::monthNamed(compile_date) ?
+			makeTime(ezCalendar::twoDigits(compile_time), ezCalendar::twoDigits(compile_time + 3), ezCalendar::twoDigits(compile_time + 6),
+				ezCalendar::twoDigits(compile_date + 4), ezCalendar::monthNamed(compile_date),
+				ezCalendar::twoDigits(compile_date + 7) * 100 + ezCalendar::twoDigits(compile_date + 9)) : 0;
+	}
+
+}
+
+#endif //_EZTIME_CALENDAR_H_
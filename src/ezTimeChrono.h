@@ -0,0 +1,40 @@
+/*
+ * ezt::clock, a std::chrono clock that reads the time ezTime keeps (NTP, time sources,
+ * setTime()), for code written against <chrono>. Not included by ezTime.h, as most Arduino
+ * cores have no <chrono>: include it yourself after ezTime.h where there is one.
+ */
+
+#ifndef _EZTIME_CHRONO_H_
+#define _EZTIME_CHRONO_H_
+
+#include <chrono>
+#include "ezTime.h"
+
+namespace ezt {
+
+	// Milliseconds since 1970 UTC. Not steady: NTP updates and setTime() move it.
+	struct clock {
+		typedef std::chrono::milliseconds duration;
+		typedef duration::rep rep;
+		typedef duration::period period;
+		typedef std::chrono::time_point<clock> time_point;
+		static constexpr bool is_steady = false;
+
+		// The second and its milliseconds from the same reading of the clock
+		static time_point now() {
+			const time_t t = UTC.now();
+			return time_point(duration((rep)t * 1000 + UTC.ms(LAST_READ)));
+		}
+
+		// Rounded down to the second, also before 1970
+		static time_t to_time_t(const time_point &t) {
+			const rep ms = t.time_since_epoch().count();
+			return (time_t)((ms >= 0 ? ms : ms - 999) / 1000);
+		}
+
+		static time_point from_time_t(const time_t t) { return time_point(duration((rep)t * 1000)); }
+	};
+
+}
+
+#endif //_EZTIME_CHRONO_H_
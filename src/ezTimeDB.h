@@ -0,0 +1,1217 @@
+/*
+ * Compiled-in timezone database, used by setLocation() when EZTIME_TZDB is defined in
+ * ezTime.h. Generated by extras/host/tools/mktzdb from tzdata 2025b, do not edit.
+ *
+ * 553 zones, 93 distinct rules, 12395 bytes of flash.
+ */
+
+#define TZDB_ZONES		553
+
+// Every distinct POSIX rule once
+const char _tzdb_rules[] PROGMEM =
+	"GMT0\0"
+	"EAT-3\0"
+	"CET-1\0"
+	"WAT-1\0"
+	"CAT-2\0"
+	"EET-2EEST,M4.5.5/0,M10.5.4/24\0"
+	"<+01>-1\0"
+	"CET-1CEST,M3.5.0,M10.5.0/3\0"
+	"SAST-2\0"
+	"EET-2\0"
+	"HST10HDT,M3.2.0,M11.1.0\0"
+	"AKST9AKDT,M3.2.0,M11.1.0\0"
+	"AST4\0"
+	"<-03>3\0"
+	"EST5\0"
+	"CST6\0"
+	"<-04>4\0"
+	"<-05>5\0"
+	"MST7MDT,M3.2.0,M11.1.0\0"
+	"CST6CDT,M3.2.0,M11.1.0\0"
+	"MST7\0"
+	"EST5EDT,M3.2.0,M11.1.0\0"
+	"PST8PDT,M3.2.0,M11.1.0\0"
+	"AST4ADT,M3.2.0,M11.1.0\0"
+	"<-02>2<-01>,M3.5.0/-1,M10.5.0/0\0"
+	"CST5CDT,M3.2.0/0,M11.1.0/1\0"
+	"<-03>3<-02>,M3.2.0,M11.1.0\0"
+	"<-02>2\0"
+	"<-04>4<-03>,M9.1.6/24,M4.1.6/24\0"
+	"NST3:30NDT,M3.2.0,M11.1.0\0"
+	"<+08>-8\0"
+	"<+07>-7\0"
+	"<+10>-10\0"
+	"AEST-10AEDT,M10.1.0,M4.1.0/3\0"
+	"<+05>-5\0"
+	"NZST-12NZDT,M9.5.0,M4.1.0/3\0"
+	"<+03>-3\0"
+	"<+00>0<+02>-2,M3.5.0/1,M10.5.0/3\0"
+	"<+12>-12\0"
+	"<+04>-4\0"
+	"EET-2EEST,M3.5.0/0,M10.5.0/0\0"
+	"<+06>-6\0"
+	"IST-5:30\0"
+	"<+09>-9\0"
+	"CST-8\0"
+	"<+0530>-5:30\0"
+	"EET-2EEST,M3.5.0/3,M10.5.0/4\0"
+	"EET-2EEST,M3.4.4/50,M10.4.4/50\0"
+	"HKT-8\0"
+	"WIB-7\0"
+	"WIT-9\0"
+	"IST-2IDT,M3.4.4/26,M10.5.0\0"
+	"<+0430>-4:30\0"
+	"PKT-5\0"
+	"<+0545>-5:45\0"
+	"<+11>-11\0"
+	"WITA-8\0"
+	"PST-8\0"
+	"KST-9\0"
+	"<+0630>-6:30\0"
+	"<+0330>-3:30\0"
+	"JST-9\0"
+	"<-01>1<+00>,M3.5.0/0,M10.5.0/1\0"
+	"WET0WEST,M3.5.0/1,M10.5.0\0"
+	"<-01>1\0"
+	"ACST-9:30ACDT,M10.1.0,M4.1.0/3\0"
+	"AEST-10\0"
+	"ACST-9:30\0"
+	"<+0845>-8:45\0"
+	"<+1030>-10:30<+11>-11,M10.1.0,M4.1.0\0"
+	"AWST-8\0"
+	"<-06>6<-05>,M9.1.6/22,M4.1.6/22\0"
+	"<-10>10\0"
+	"<-11>11\0"
+	"<-12>12\0"
+	"<-06>6\0"
+	"<-07>7\0"
+	"<-08>8\0"
+	"<-09>9\0"
+	"<+13>-13\0"
+	"<+14>-14\0"
+	"<+02>-2\0"
+	"UTC0\0"
+	"GMT0BST,M3.5.0/1,M10.5.0\0"
+	"EET-2EEST,M3.5.0,M10.5.0/3\0"
+	"GMT0IST,M3.5.0/1,M10.5.0\0"
+	"MSK-3\0"
+	"<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45\0"
+	"ChST-10\0"
+	"HST10\0"
+	"<-0930>9:30\0"
+	"SST11\0"
+	"<+11>-11<+12>,M10.1.0,M4.1.0/3\0";
+
+// Zone names, sorted as uppercase with spaces as underscores
+const char _tzdb_names[] PROGMEM =
+	"Africa/Abidjan\0"
+	"Africa/Accra\0"
+	"Africa/Addis_Ababa\0"
+	"Africa/Algiers\0"
+	"Africa/Asmara\0"
+	"Africa/Asmera\0"
+	"Africa/Bamako\0"
+	"Africa/Bangui\0"
+	"Africa/Banjul\0"
+	"Africa/Bissau\0"
+	"Africa/Blantyre\0"
+	"Africa/Brazzaville\0"
+	"Africa/Bujumbura\0"
+	"Africa/Cairo\0"
+	"Africa/Casablanca\0"
+	"Africa/Ceuta\0"
+	"Africa/Conakry\0"
+	"Africa/Dakar\0"
+	"Africa/Dar_es_Salaam\0"
+	"Africa/Djibouti\0"
+	"Africa/Douala\0"
+	"Africa/El_Aaiun\0"
+	"Africa/Freetown\0"
+	"Africa/Gaborone\0"
+	"Africa/Harare\0"
+	"Africa/Johannesburg\0"
+	"Africa/Juba\0"
+	"Africa/Kampala\0"
+	"Africa/Khartoum\0"
+	"Africa/Kigali\0"
+	"Africa/Kinshasa\0"
+	"Africa/Lagos\0"
+	"Africa/Libreville\0"
+	"Africa/Lome\0"
+	"Africa/Luanda\0"
+	"Africa/Lubumbashi\0"
+	"Africa/Lusaka\0"
+	"Africa/Malabo\0"
+	"Africa/Maputo\0"
+	"Africa/Maseru\0"
+	"Africa/Mbabane\0"
+	"Africa/Mogadishu\0"
+	"Africa/Monrovia\0"
+	"Africa/Nairobi\0"
+	"Africa/Ndjamena\0"
+	"Africa/Niamey\0"
+	"Africa/Nouakchott\0"
+	"Africa/Ouagadougou\0"
+	"Africa/Porto-Novo\0"
+	"Africa/Sao_Tome\0"
+	"Africa/Timbuktu\0"
+	"Africa/Tripoli\0"
+	"Africa/Tunis\0"
+	"Africa/Windhoek\0"
+	"America/Adak\0"
+	"America/Anchorage\0"
+	"America/Anguilla\0"
+	"America/Antigua\0"
+	"America/Araguaina\0"
+	"America/Argentina/Buenos_Aires\0"
+	"America/Argentina/Catamarca\0"
+	"America/Argentina/ComodRivadavia\0"
+	"America/Argentina/Cordoba\0"
+	"America/Argentina/Jujuy\0"
+	"America/Argentina/La_Rioja\0"
+	"America/Argentina/Mendoza\0"
+	"America/Argentina/Rio_Gallegos\0"
+	"America/Argentina/Salta\0"
+	"America/Argentina/San_Juan\0"
+	"America/Argentina/San_Luis\0"
+	"America/Argentina/Tucuman\0"
+	"America/Argentina/Ushuaia\0"
+	"America/Aruba\0"
+	"America/Asuncion\0"
+	"America/Atikokan\0"
+	"America/Atka\0"
+	"America/Bahia\0"
+	"America/Bahia_Banderas\0"
+	"America/Barbados\0"
+	"America/Belem\0"
+	"America/Belize\0"
+	"America/Blanc-Sablon\0"
+	"America/Boa_Vista\0"
+	"America/Bogota\0"
+	"America/Boise\0"
+	"America/Buenos_Aires\0"
+	"America/Cambridge_Bay\0"
+	"America/Campo_Grande\0"
+	"America/Cancun\0"
+	"America/Caracas\0"
+	"America/Catamarca\0"
+	"America/Cayenne\0"
+	"America/Cayman\0"
+	"America/Chicago\0"
+	"America/Chihuahua\0"
+	"America/Ciudad_Juarez\0"
+	"America/Coral_Harbour\0"
+	"America/Cordoba\0"
+	"America/Costa_Rica\0"
+	"America/Coyhaique\0"
+	"America/Creston\0"
+	"America/Cuiaba\0"
+	"America/Curacao\0"
+	"America/Danmarkshavn\0"
+	"America/Dawson\0"
+	"America/Dawson_Creek\0"
+	"America/Denver\0"
+	"America/Detroit\0"
+	"America/Dominica\0"
+	"America/Edmonton\0"
+	"America/Eirunepe\0"
+	"America/El_Salvador\0"
+	"America/Ensenada\0"
+	"America/Fortaleza\0"
+	"America/Fort_Nelson\0"
+	"America/Fort_Wayne\0"
+	"America/Glace_Bay\0"
+	"America/Godthab\0"
+	"America/Goose_Bay\0"
+	"America/Grand_Turk\0"
+	"America/Grenada\0"
+	"America/Guadeloupe\0"
+	"America/Guatemala\0"
+	"America/Guayaquil\0"
+	"America/Guyana\0"
+	"America/Halifax\0"
+	"America/Havana\0"
+	"America/Hermosillo\0"
+	"America/Indiana/Indianapolis\0"
+	"America/Indiana/Knox\0"
+	"America/Indiana/Marengo\0"
+	"America/Indiana/Petersburg\0"
+	"America/Indiana/Tell_City\0"
+	"America/Indiana/Vevay\0"
+	"America/Indiana/Vincennes\0"
+	"America/Indiana/Winamac\0"
+	"America/Indianapolis\0"
+	"America/Inuvik\0"
+	"America/Iqaluit\0"
+	"America/Jamaica\0"
+	"America/Jujuy\0"
+	"America/Juneau\0"
+	"America/Kentucky/Louisville\0"
+	"America/Kentucky/Monticello\0"
+	"America/Knox_IN\0"
+	"America/Kralendijk\0"
+	"America/La_Paz\0"
+	"America/Lima\0"
+	"America/Los_Angeles\0"
+	"America/Louisville\0"
+	"America/Lower_Princes\0"
+	"America/Maceio\0"
+	"America/Managua\0"
+	"America/Manaus\0"
+	"America/Marigot\0"
+	"America/Martinique\0"
+	"America/Matamoros\0"
+	"America/Mazatlan\0"
+	"America/Mendoza\0"
+	"America/Menominee\0"
+	"America/Merida\0"
+	"America/Metlakatla\0"
+	"America/Mexico_City\0"
+	"America/Miquelon\0"
+	"America/Moncton\0"
+	"America/Monterrey\0"
+	"America/Montevideo\0"
+	"America/Montreal\0"
+	"America/Montserrat\0"
+	"America/Nassau\0"
+	"America/New_York\0"
+	"America/Nipigon\0"
+	"America/Nome\0"
+	"America/Noronha\0"
+	"America/North_Dakota/Beulah\0"
+	"America/North_Dakota/Center\0"
+	"America/North_Dakota/New_Salem\0"
+	"America/Nuuk\0"
+	"America/Ojinaga\0"
+	"America/Panama\0"
+	"America/Pangnirtung\0"
+	"America/Paramaribo\0"
+	"America/Phoenix\0"
+	"America/Port-au-Prince\0"
+	"America/Porto_Acre\0"
+	"America/Porto_Velho\0"
+	"America/Port_of_Spain\0"
+	"America/Puerto_Rico\0"
+	"America/Punta_Arenas\0"
+	"America/Rainy_River\0"
+	"America/Rankin_Inlet\0"
+	"America/Recife\0"
+	"America/Regina\0"
+	"America/Resolute\0"
+	"America/Rio_Branco\0"
+	"America/Rosario\0"
+	"America/Santarem\0"
+	"America/Santa_Isabel\0"
+	"America/Santiago\0"
+	"America/Santo_Domingo\0"
+	"America/Sao_Paulo\0"
+	"America/Scoresbysund\0"
+	"America/Shiprock\0"
+	"America/Sitka\0"
+	"America/St_Barthelemy\0"
+	"America/St_Johns\0"
+	"America/St_Kitts\0"
+	"America/St_Lucia\0"
+	"America/St_Thomas\0"
+	"America/St_Vincent\0"
+	"America/Swift_Current\0"
+	"America/Tegucigalpa\0"
+	"America/Thule\0"
+	"America/Thunder_Bay\0"
+	"America/Tijuana\0"
+	"America/Toronto\0"
+	"America/Tortola\0"
+	"America/Vancouver\0"
+	"America/Virgin\0"
+	"America/Whitehorse\0"
+	"America/Winnipeg\0"
+	"America/Yakutat\0"
+	"America/Yellowknife\0"
+	"Antarctica/Casey\0"
+	"Antarctica/Davis\0"
+	"Antarctica/DumontDUrville\0"
+	"Antarctica/Macquarie\0"
+	"Antarctica/Mawson\0"
+	"Antarctica/McMurdo\0"
+	"Antarctica/Palmer\0"
+	"Antarctica/Rothera\0"
+	"Antarctica/South_Pole\0"
+	"Antarctica/Syowa\0"
+	"Antarctica/Troll\0"
+	"Antarctica/Vostok\0"
+	"Arctic/Longyearbyen\0"
+	"Asia/Aden\0"
+	"Asia/Almaty\0"
+	"Asia/Amman\0"
+	"Asia/Anadyr\0"
+	"Asia/Aqtau\0"
+	"Asia/Aqtobe\0"
+	"Asia/Ashgabat\0"
+	"Asia/Ashkhabad\0"
+	"Asia/Atyrau\0"
+	"Asia/Baghdad\0"
+	"Asia/Bahrain\0"
+	"Asia/Baku\0"
+	"Asia/Bangkok\0"
+	"Asia/Barnaul\0"
+	"Asia/Beirut\0"
+	"Asia/Bishkek\0"
+	"Asia/Brunei\0"
+	"Asia/Calcutta\0"
+	"Asia/Chita\0"
+	"Asia/Choibalsan\0"
+	"Asia/Chongqing\0"
+	"Asia/Chungking\0"
+	"Asia/Colombo\0"
+	"Asia/Dacca\0"
+	"Asia/Damascus\0"
+	"Asia/Dhaka\0"
+	"Asia/Dili\0"
+	"Asia/Dubai\0"
+	"Asia/Dushanbe\0"
+	"Asia/Famagusta\0"
+	"Asia/Gaza\0"
+	"Asia/Harbin\0"
+	"Asia/Hebron\0"
+	"Asia/Hong_Kong\0"
+	"Asia/Hovd\0"
+	"Asia/Ho_Chi_Minh\0"
+	"Asia/Irkutsk\0"
+	"Asia/Istanbul\0"
+	"Asia/Jakarta\0"
+	"Asia/Jayapura\0"
+	"Asia/Jerusalem\0"
+	"Asia/Kabul\0"
+	"Asia/Kamchatka\0"
+	"Asia/Karachi\0"
+	"Asia/Kashgar\0"
+	"Asia/Kathmandu\0"
+	"Asia/Katmandu\0"
+	"Asia/Khandyga\0"
+	"Asia/Kolkata\0"
+	"Asia/Krasnoyarsk\0"
+	"Asia/Kuala_Lumpur\0"
+	"Asia/Kuching\0"
+	"Asia/Kuwait\0"
+	"Asia/Macao\0"
+	"Asia/Macau\0"
+	"Asia/Magadan\0"
+	"Asia/Makassar\0"
+	"Asia/Manila\0"
+	"Asia/Muscat\0"
+	"Asia/Nicosia\0"
+	"Asia/Novokuznetsk\0"
+	"Asia/Novosibirsk\0"
+	"Asia/Omsk\0"
+	"Asia/Oral\0"
+	"Asia/Phnom_Penh\0"
+	"Asia/Pontianak\0"
+	"Asia/Pyongyang\0"
+	"Asia/Qatar\0"
+	"Asia/Qostanay\0"
+	"Asia/Qyzylorda\0"
+	"Asia/Rangoon\0"
+	"Asia/Riyadh\0"
+	"Asia/Saigon\0"
+	"Asia/Sakhalin\0"
+	"Asia/Samarkand\0"
+	"Asia/Seoul\0"
+	"Asia/Shanghai\0"
+	"Asia/Singapore\0"
+	"Asia/Srednekolymsk\0"
+	"Asia/Taipei\0"
+	"Asia/Tashkent\0"
+	"Asia/Tbilisi\0"
+	"Asia/Tehran\0"
+	"Asia/Tel_Aviv\0"
+	"Asia/Thimbu\0"
+	"Asia/Thimphu\0"
+	"Asia/Tokyo\0"
+	"Asia/Tomsk\0"
+	"Asia/Ujung_Pandang\0"
+	"Asia/Ulaanbaatar\0"
+	"Asia/Ulan_Bator\0"
+	"Asia/Urumqi\0"
+	"Asia/Ust-Nera\0"
+	"Asia/Vientiane\0"
+	"Asia/Vladivostok\0"
+	"Asia/Yakutsk\0"
+	"Asia/Yangon\0"
+	"Asia/Yekaterinburg\0"
+	"Asia/Yerevan\0"
+	"Atlantic/Azores\0"
+	"Atlantic/Bermuda\0"
+	"Atlantic/Canary\0"
+	"Atlantic/Cape_Verde\0"
+	"Atlantic/Faeroe\0"
+	"Atlantic/Faroe\0"
+	"Atlantic/Jan_Mayen\0"
+	"Atlantic/Madeira\0"
+	"Atlantic/Reykjavik\0"
+	"Atlantic/South_Georgia\0"
+	"Atlantic/Stanley\0"
+	"Atlantic/St_Helena\0"
+	"Australia/ACT\0"
+	"Australia/Adelaide\0"
+	"Australia/Brisbane\0"
+	"Australia/Broken_Hill\0"
+	"Australia/Canberra\0"
+	"Australia/Currie\0"
+	"Australia/Darwin\0"
+	"Australia/Eucla\0"
+	"Australia/Hobart\0"
+	"Australia/LHI\0"
+	"Australia/Lindeman\0"
+	"Australia/Lord_Howe\0"
+	"Australia/Melbourne\0"
+	"Australia/North\0"
+	"Australia/NSW\0"
+	"Australia/Perth\0"
+	"Australia/Queensland\0"
+	"Australia/South\0"
+	"Australia/Sydney\0"
+	"Australia/Tasmania\0"
+	"Australia/Victoria\0"
+	"Australia/West\0"
+	"Australia/Yancowinna\0"
+	"Brazil/Acre\0"
+	"Brazil/DeNoronha\0"
+	"Brazil/East\0"
+	"Brazil/West\0"
+	"Canada/Atlantic\0"
+	"Canada/Central\0"
+	"Canada/Eastern\0"
+	"Canada/Mountain\0"
+	"Canada/Newfoundland\0"
+	"Canada/Pacific\0"
+	"Canada/Saskatchewan\0"
+	"Canada/Yukon\0"
+	"Chile/Continental\0"
+	"Chile/EasterIsland\0"
+	"Etc/GMT\0"
+	"Etc/GMT+0\0"
+	"Etc/GMT+1\0"
+	"Etc/GMT+10\0"
+	"Etc/GMT+11\0"
+	"Etc/GMT+12\0"
+	"Etc/GMT+2\0"
+	"Etc/GMT+3\0"
+	"Etc/GMT+4\0"
+	"Etc/GMT+5\0"
+	"Etc/GMT+6\0"
+	"Etc/GMT+7\0"
+	"Etc/GMT+8\0"
+	"Etc/GMT+9\0"
+	"Etc/GMT-0\0"
+	"Etc/GMT-1\0"
+	"Etc/GMT-10\0"
+	"Etc/GMT-11\0"
+	"Etc/GMT-12\0"
+	"Etc/GMT-13\0"
+	"Etc/GMT-14\0"
+	"Etc/GMT-2\0"
+	"Etc/GMT-3\0"
+	"Etc/GMT-4\0"
+	"Etc/GMT-5\0"
+	"Etc/GMT-6\0"
+	"Etc/GMT-7\0"
+	"Etc/GMT-8\0"
+	"Etc/GMT-9\0"
+	"Etc/GMT0\0"
+	"Etc/Greenwich\0"
+	"Etc/UCT\0"
+	"Etc/Universal\0"
+	"Etc/UTC\0"
+	"Etc/Zulu\0"
+	"Europe/Amsterdam\0"
+	"Europe/Andorra\0"
+	"Europe/Astrakhan\0"
+	"Europe/Athens\0"
+	"Europe/Belfast\0"
+	"Europe/Belgrade\0"
+	"Europe/Berlin\0"
+	"Europe/Bratislava\0"
+	"Europe/Brussels\0"
+	"Europe/Bucharest\0"
+	"Europe/Budapest\0"
+	"Europe/Busingen\0"
+	"Europe/Chisinau\0"
+	"Europe/Copenhagen\0"
+	"Europe/Dublin\0"
+	"Europe/Gibraltar\0"
+	"Europe/Guernsey\0"
+	"Europe/Helsinki\0"
+	"Europe/Isle_of_Man\0"
+	"Europe/Istanbul\0"
+	"Europe/Jersey\0"
+	"Europe/Kaliningrad\0"
+	"Europe/Kiev\0"
+	"Europe/Kirov\0"
+	"Europe/Kyiv\0"
+	"Europe/Lisbon\0"
+	"Europe/Ljubljana\0"
+	"Europe/London\0"
+	"Europe/Luxembourg\0"
+	"Europe/Madrid\0"
+	"Europe/Malta\0"
+	"Europe/Mariehamn\0"
+	"Europe/Minsk\0"
+	"Europe/Monaco\0"
+	"Europe/Moscow\0"
+	"Europe/Nicosia\0"
+	"Europe/Oslo\0"
+	"Europe/Paris\0"
+	"Europe/Podgorica\0"
+	"Europe/Prague\0"
+	"Europe/Riga\0"
+	"Europe/Rome\0"
+	"Europe/Samara\0"
+	"Europe/San_Marino\0"
+	"Europe/Sarajevo\0"
+	"Europe/Saratov\0"
+	"Europe/Simferopol\0"
+	"Europe/Skopje\0"
+	"Europe/Sofia\0"
+	"Europe/Stockholm\0"
+	"Europe/Tallinn\0"
+	"Europe/Tirane\0"
+	"Europe/Tiraspol\0"
+	"Europe/Ulyanovsk\0"
+	"Europe/Uzhgorod\0"
+	"Europe/Vaduz\0"
+	"Europe/Vatican\0"
+	"Europe/Vienna\0"
+	"Europe/Vilnius\0"
+	"Europe/Volgograd\0"
+	"Europe/Warsaw\0"
+	"Europe/Zagreb\0"
+	"Europe/Zaporozhye\0"
+	"Europe/Zurich\0"
+	"Indian/Antananarivo\0"
+	"Indian/Chagos\0"
+	"Indian/Christmas\0"
+	"Indian/Cocos\0"
+	"Indian/Comoro\0"
+	"Indian/Kerguelen\0"
+	"Indian/Mahe\0"
+	"Indian/Maldives\0"
+	"Indian/Mauritius\0"
+	"Indian/Mayotte\0"
+	"Indian/Reunion\0"
+	"Mexico/BajaNorte\0"
+	"Mexico/BajaSur\0"
+	"Mexico/General\0"
+	"Pacific/Apia\0"
+	"Pacific/Auckland\0"
+	"Pacific/Bougainville\0"
+	"Pacific/Chatham\0"
+	"Pacific/Chuuk\0"
+	"Pacific/Easter\0"
+	"Pacific/Efate\0"
+	"Pacific/Enderbury\0"
+	"Pacific/Fakaofo\0"
+	"Pacific/Fiji\0"
+	"Pacific/Funafuti\0"
+	"Pacific/Galapagos\0"
+	"Pacific/Gambier\0"
+	"Pacific/Guadalcanal\0"
+	"Pacific/Guam\0"
+	"Pacific/Honolulu\0"
+	"Pacific/Johnston\0"
+	"Pacific/Kanton\0"
+	"Pacific/Kiritimati\0"
+	"Pacific/Kosrae\0"
+	"Pacific/Kwajalein\0"
+	"Pacific/Majuro\0"
+	"Pacific/Marquesas\0"
+	"Pacific/Midway\0"
+	"Pacific/Nauru\0"
+	"Pacific/Niue\0"
+	"Pacific/Norfolk\0"
+	"Pacific/Noumea\0"
+	"Pacific/Pago_Pago\0"
+	"Pacific/Palau\0"
+	"Pacific/Pitcairn\0"
+	"Pacific/Pohnpei\0"
+	"Pacific/Ponape\0"
+	"Pacific/Port_Moresby\0"
+	"Pacific/Rarotonga\0"
+	"Pacific/Saipan\0"
+	"Pacific/Samoa\0"
+	"Pacific/Tahiti\0"
+	"Pacific/Tarawa\0"
+	"Pacific/Tongatapu\0"
+	"Pacific/Truk\0"
+	"Pacific/Wake\0"
+	"Pacific/Wallis\0"
+	"Pacific/Yap\0"
+	"US/Alaska\0"
+	"US/Aleutian\0"
+	"US/Arizona\0"
+	"US/Central\0"
+	"US/East-Indiana\0"
+	"US/Eastern\0"
+	"US/Hawaii\0"
+	"US/Indiana-Starke\0"
+	"US/Michigan\0"
+	"US/Mountain\0"
+	"US/Pacific\0"
+	"US/Samoa\0";
+
+// For every zone: offset of its name in _tzdb_names and of its rule in _tzdb_rules
+const uint16_t _tzdb_index[TZDB_ZONES][2] PROGMEM = {
+	{     0,    0 },
+	{    15,    0 },
+	{    28,    5 },
+	{    47,   11 },
+	{    62,    5 },
+	{    76,    5 },
+	{    90,    0 },
+	{   104,   17 },
+	{   118,    0 },
+	{   132,    0 },
+	{   146,   23 },
+	{   162,   17 },
+	{   181,   23 },
+	{   198,   29 },
+	{   211,   59 },
+	{   229,   67 },
+	{   242,    0 },
+	{   257,    0 },
+	{   270,    5 },
+	{   291,    5 },
+	{   307,   17 },
+	{   321,   59 },
+	{   337,    0 },
+	{   353,   23 },
+	{   369,   23 },
+	{   383,   94 },
+	{   403,   23 },
+	{   415,    5 },
+	{   430,   23 },
+	{   446,   23 },
+	{   460,   17 },
+	{   476,   17 },
+	{   489,   17 },
+	{   507,    0 },
+	{   519,   17 },
+	{   533,   23 },
+	{   551,   23 },
+	{   565,   17 },
+	{   579,   23 },
+	{   593,   94 },
+	{   607,   94 },
+	{   622,    5 },
+	{   639,    0 },
+	{   655,    5 },
+	{   670,   17 },
+	{   686,   17 },
+	{   700,    0 },
+	{   718,    0 },
+	{   737,   17 },
+	{   755,    0 },
+	{   771,    0 },
+	{   787,  101 },
+	{   802,   11 },
+	{   815,   23 },
+	{   831,  107 },
+	{   844,  131 },
+	{   862,  156 },
+	{   879,  156 },
+	{   895,  161 },
+	{   913,  161 },
+	{   944,  161 },
+	{   972,  161 },
+	{  1005,  161 },
+	{  1031,  161 },
+	{  1055,  161 },
+	{  1082,  161 },
+	{  1108,  161 },
+	{  1139,  161 },
+	{  1163,  161 },
+	{  1190,  161 },
+	{  1217,  161 },
+	{  1243,  161 },
+	{  1269,  156 },
+	{  1283,  161 },
+	{  1300,  168 },
+	{  1317,  107 },
+	{  1330,  161 },
+	{  1344,  173 },
+	{  1367,  156 },
+	{  1384,  161 },
+	{  1398,  173 },
+	{  1413,  156 },
+	{  1434,  178 },
+	{  1452,  185 },
+	{  1467,  192 },
+	{  1481,  161 },
+	{  1502,  192 },
+	{  1524,  178 },
+	{  1545,  168 },
+	{  1560,  178 },
+	{  1576,  161 },
+	{  1594,  161 },
+	{  1610,  168 },
+	{  1625,  215 },
+	{  1641,  173 },
+	{  1659,  192 },
+	{  1681,  168 },
+	{  1703,  161 },
+	{  1719,  173 },
+	{  1738,  161 },
+	{  1756,  238 },
+	{  1772,  178 },
+	{  1787,  156 },
+	{  1803,    0 },
+	{  1824,  238 },
+	{  1839,  238 },
+	{  1860,  192 },
+	{  1875,  243 },
+	{  1891,  156 },
+	{  1908,  192 },
+	{  1925,  185 },
+	{  1942,  173 },
+	{  1962,  266 },
+	{  1979,  161 },
+	{  1997,  238 },
+	{  2017,  243 },
+	{  2036,  289 },
+	{  2054,  312 },
+	{  2070,  289 },
+	{  2088,  243 },
+	{  2107,  156 },
+	{  2123,  156 },
+	{  2142,  173 },
+	{  2160,  185 },
+	{  2178,  178 },
+	{  2193,  289 },
+	{  2209,  344 },
+	{  2224,  238 },
+	{  2243,  243 },
+	{  2272,  215 },
+	{  2293,  243 },
+	{  2317,  243 },
+	{  2344,  215 },
+	{  2370,  243 },
+	{  2392,  243 },
+	{  2418,  243 },
+	{  2442,  243 },
+	{  2463,  192 },
+	{  2478,  243 },
+	{  2494,  168 },
+	{  2510,  161 },
+	{  2524,  131 },
+	{  2539,  243 },
+	{  2567,  243 },
+	{  2595,  215 },
+	{  2611,  156 },
+	{  2630,  178 },
+	{  2645,  185 },
+	{  2658,  266 },
+	{  2678,  243 },
+	{  2697,  156 },
+	{  2719,  161 },
+	{  2734,  173 },
+	{  2750,  178 },
+	{  2765,  156 },
+	{  2781,  156 },
+	{  2800,  215 },
+	{  2818,  238 },
+	{  2835,  161 },
+	{  2851,  215 },
+	{  2869,  173 },
+	{  2884,  131 },
+	{  2903,  173 },
+	{  2923,  371 },
+	{  2940,  289 },
+	{  2956,  173 },
+	{  2974,  161 },
+	{  2993,  243 },
+	{  3010,  156 },
+	{  3029,  243 },
+	{  3044,  243 },
+	{  3061,  243 },
+	{  3077,  131 },
+	{  3090,  398 },
+	{  3106,  215 },
+	{  3134,  215 },
+	{  3162,  215 },
+	{  3193,  312 },
+	{  3206,  215 },
+	{  3222,  168 },
+	{  3237,  243 },
+	{  3257,  161 },
+	{  3276,  238 },
+	{  3292,  243 },
+	{  3315,  185 },
+	{  3334,  178 },
+	{  3354,  156 },
+	{  3376,  156 },
+	{  3396,  161 },
+	{  3417,  215 },
+	{  3437,  215 },
+	{  3458,  161 },
+	{  3473,  173 },
+	{  3488,  215 },
+	{  3505,  185 },
+	{  3524,  161 },
+	{  3540,  161 },
+	{  3557,  266 },
+	{  3578,  405 },
+	{  3595,  156 },
+	{  3617,  161 },
+	{  3635,  312 },
+	{  3656,  192 },
+	{  3673,  131 },
+	{  3687,  156 },
+	{  3709,  437 },
+	{  3726,  156 },
+	{  3743,  156 },
+	{  3760,  156 },
+	{  3778,  156 },
+	{  3797,  173 },
+	{  3819,  173 },
+	{  3839,  289 },
+	{  3853,  243 },
+	{  3873,  266 },
+	{  3889,  243 },
+	{  3905,  156 },
+	{  3921,  266 },
+	{  3939,  156 },
+	{  3954,  238 },
+	{  3973,  215 },
+	{  3990,  131 },
+	{  4006,  192 },
+	{  4026,  463 },
+	{  4043,  471 },
+	{  4060,  479 },
+	{  4086,  488 },
+	{  4107,  517 },
+	{  4125,  525 },
+	{  4144,  161 },
+	{  4162,  161 },
+	{  4181,  525 },
+	{  4203,  553 },
+	{  4220,  561 },
+	{  4237,  517 },
+	{  4255,   67 },
+	{  4275,  553 },
+	{  4285,  517 },
+	{  4297,  553 },
+	{  4308,  594 },
+	{  4320,  517 },
+	{  4331,  517 },
+	{  4343,  517 },
+	{  4357,  517 },
+	{  4372,  517 },
+	{  4384,  553 },
+	{  4397,  553 },
+	{  4410,  603 },
+	{  4420,  471 },
+	{  4433,  471 },
+	{  4446,  611 },
+	{  4458,  640 },
+	{  4471,  463 },
+	{  4483,  648 },
+	{  4497,  657 },
+	{  4508,  463 },
+	{  4524,  665 },
+	{  4539,  665 },
+	{  4554,  671 },
+	{  4567,  640 },
+	{  4578,  553 },
+	{  4592,  640 },
+	{  4603,  657 },
+	{  4613,  603 },
+	{  4624,  517 },
+	{  4638,  684 },
+	{  4653,  713 },
+	{  4663,  665 },
+	{  4675,  713 },
+	{  4687,  744 },
+	{  4702,  471 },
+	{  4712,  471 },
+	{  4729,  463 },
+	{  4742,  553 },
+	{  4756,  750 },
+	{  4769,  756 },
+	{  4783,  762 },
+	{  4798,  789 },
+	{  4809,  594 },
+	{  4824,  802 },
+	{  4837,  640 },
+	{  4850,  808 },
+	{  4865,  808 },
+	{  4879,  657 },
+	{  4893,  648 },
+	{  4906,  471 },
+	{  4923,  463 },
+	{  4941,  463 },
+	{  4954,  553 },
+	{  4966,  665 },
+	{  4977,  665 },
+	{  4988,  821 },
+	{  5001,  830 },
+	{  5015,  837 },
+	{  5027,  603 },
+	{  5039,  684 },
+	{  5052,  471 },
+	{  5070,  471 },
+	{  5087,  640 },
+	{  5097,  517 },
+	{  5107,  471 },
+	{  5123,  750 },
+	{  5138,  843 },
+	{  5153,  553 },
+	{  5164,  517 },
+	{  5178,  517 },
+	{  5193,  849 },
+	{  5206,  553 },
+	{  5218,  471 },
+	{  5230,  821 },
+	{  5244,  517 },
+	{  5259,  843 },
+	{  5270,  665 },
+	{  5284,  463 },
+	{  5299,  821 },
+	{  5318,  665 },
+	{  5330,  517 },
+	{  5344,  603 },
+	{  5357,  862 },
+	{  5369,  762 },
+	{  5383,  640 },
+	{  5395,  640 },
+	{  5408,  875 },
+	{  5419,  471 },
+	{  5430,  830 },
+	{  5449,  463 },
+	{  5466,  463 },
+	{  5482,  640 },
+	{  5494,  479 },
+	{  5508,  471 },
+	{  5523,  479 },
+	{  5540,  657 },
+	{  5553,  849 },
+	{  5565,  517 },
+	{  5584,  603 },
+	{  5597,  881 },
+	{  5613,  289 },
+	{  5630,  912 },
+	{  5646,  938 },
+	{  5666,  912 },
+	{  5682,  912 },
+	{  5697,   67 },
+	{  5716,  912 },
+	{  5733,    0 },
+	{  5752,  398 },
+	{  5775,  161 },
+	{  5792,    0 },
+	{  5811,  488 },
+	{  5825,  945 },
+	{  5844,  976 },
+	{  5863,  945 },
+	{  5885,  488 },
+	{  5904,  488 },
+	{  5921,  984 },
+	{  5938,  994 },
+	{  5954,  488 },
+	{  5971, 1007 },
+	{  5985,  976 },
+	{  6004, 1007 },
+	{  6024,  488 },
+	{  6044,  984 },
+	{  6060,  488 },
+	{  6074, 1044 },
+	{  6090,  976 },
+	{  6111,  945 },
+	{  6127,  488 },
+	{  6144,  488 },
+	{  6163,  488 },
+	{  6182, 1044 },
+	{  6197,  945 },
+	{  6218,  185 },
+	{  6230,  398 },
+	{  6247,  161 },
+	{  6259,  178 },
+	{  6271,  289 },
+	{  6287,  215 },
+	{  6302,  243 },
+	{  6317,  192 },
+	{  6333,  437 },
+	{  6353,  266 },
+	{  6368,  173 },
+	{  6388,  238 },
+	{  6401,  405 },
+	{  6419, 1051 },
+	{  6438,    0 },
+	{  6446,    0 },
+	{  6456,  938 },
+	{  6466, 1083 },
+	{  6477, 1091 },
+	{  6488, 1099 },
+	{  6499,  398 },
+	{  6509,  161 },
+	{  6519,  178 },
+	{  6529,  185 },
+	{  6539, 1107 },
+	{  6549, 1114 },
+	{  6559, 1121 },
+	{  6569, 1128 },
+	{  6579,    0 },
+	{  6589,   59 },
+	{  6599,  479 },
+	{  6610,  821 },
+	{  6621,  594 },
+	{  6632, 1135 },
+	{  6643, 1144 },
+	{  6654, 1153 },
+	{  6664,  553 },
+	{  6674,  603 },
+	{  6684,  517 },
+	{  6694,  640 },
+	{  6704,  471 },
+	{  6714,  463 },
+	{  6724,  657 },
+	{  6734,    0 },
+	{  6743,    0 },
+	{  6757, 1161 },
+	{  6765, 1161 },
+	{  6779, 1161 },
+	{  6787, 1161 },
+	{  6796,   67 },
+	{  6813,   67 },
+	{  6828,  603 },
+	{  6845,  684 },
+	{  6859, 1166 },
+	{  6874,   67 },
+	{  6890,   67 },
+	{  6904,   67 },
+	{  6922,   67 },
+	{  6938,  684 },
+	{  6955,   67 },
+	{  6971,   67 },
+	{  6987, 1191 },
+	{  7003,   67 },
+	{  7021, 1218 },
+	{  7035,   67 },
+	{  7052, 1166 },
+	{  7068,  684 },
+	{  7084, 1166 },
+	{  7103,  553 },
+	{  7119, 1166 },
+	{  7133,  101 },
+	{  7152,  684 },
+	{  7164, 1243 },
+	{  7177,  684 },
+	{  7189,  912 },
+	{  7203,   67 },
+	{  7220, 1166 },
+	{  7234,   67 },
+	{  7252,   67 },
+	{  7266,   67 },
+	{  7279,  684 },
+	{  7296,  553 },
+	{  7309,   67 },
+	{  7323, 1243 },
+	{  7337,  684 },
+	{  7352,   67 },
+	{  7364,   67 },
+	{  7377,   67 },
+	{  7394,   67 },
+	{  7408,  684 },
+	{  7420,   67 },
+	{  7432,  603 },
+	{  7446,   67 },
+	{  7464,   67 },
+	{  7480,  603 },
+	{  7495, 1243 },
+	{  7513,   67 },
+	{  7527,  684 },
+	{  7540,   67 },
+	{  7557,  684 },
+	{  7572,   67 },
+	{  7586, 1191 },
+	{  7602,  603 },
+	{  7619,  684 },
+	{  7635,   67 },
+	{  7648,   67 },
+	{  7663,   67 },
+	{  7677,  684 },
+	{  7692, 1243 },
+	{  7709,   67 },
+	{  7723,   67 },
+	{  7737,  684 },
+	{  7755,   67 },
+	{  7769,    5 },
+	{  7789,  640 },
+	{  7803,  471 },
+	{  7820,  849 },
+	{  7833,    5 },
+	{  7847,  517 },
+	{  7864,  603 },
+	{  7876,  517 },
+	{  7892,  603 },
+	{  7909,    5 },
+	{  7924,  603 },
+	{  7939,  266 },
+	{  7956,  238 },
+	{  7971,  173 },
+	{  7986, 1135 },
+	{  7999,  525 },
+	{  8016,  821 },
+	{  8037, 1249 },
+	{  8053,  479 },
+	{  8067, 1051 },
+	{  8082,  821 },
+	{  8096, 1135 },
+	{  8114, 1135 },
+	{  8130,  594 },
+	{  8143,  594 },
+	{  8160, 1107 },
+	{  8178, 1128 },
+	{  8194,  821 },
+	{  8214, 1294 },
+	{  8227, 1302 },
+	{  8244, 1302 },
+	{  8261, 1135 },
+	{  8276, 1144 },
+	{  8295,  821 },
+	{  8310,  594 },
+	{  8328,  594 },
+	{  8343, 1308 },
+	{  8361, 1320 },
+	{  8376,  594 },
+	{  8390, 1091 },
+	{  8403, 1326 },
+	{  8419,  821 },
+	{  8434, 1320 },
+	{  8452,  657 },
+	{  8466, 1121 },
+	{  8483,  821 },
+	{  8499,  821 },
+	{  8514,  479 },
+	{  8535, 1083 },
+	{  8553, 1294 },
+	{  8568, 1320 },
+	{  8582, 1083 },
+	{  8597,  594 },
+	{  8612, 1135 },
+	{  8630,  479 },
+	{  8643,  594 },
+	{  8656,  594 },
+	{  8671,  479 },
+	{  8683,  131 },
+	{  8693,  107 },
+	{  8705,  238 },
+	{  8716,  215 },
+	{  8727,  243 },
+	{  8743,  243 },
+	{  8754, 1302 },
+	{  8764,  215 },
+	{  8782,  243 },
+	{  8794,  192 },
+	{  8806,  266 },
+	{  8817, 1320 }
+};